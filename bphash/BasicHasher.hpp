@@ -0,0 +1,133 @@
+/*! \file
+ * \brief A class that hashes objects with a compile-time algorithm
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hasher.hpp"
+
+namespace bphash {
+
+
+/*! \brief Class that is used to hash objects with a fixed algorithm
+ *
+ * This works like Hasher, except that the hash algorithm is
+ * given as a template parameter and stored by value. Since there
+ * is no virtual dispatch, the algorithm can be inlined into
+ * the hashing of each object.
+ *
+ * The result is the same as a Hasher using the same algorithm
+ * (for example, `BasicHasher<detail::MurmurHash3_128_x64>` and
+ * `Hasher(HashType::Hash128)`).
+ *
+ * Objects whose `hash()` member function or `hash_object()` free
+ * function accept a BasicHasher (usually by making the hasher
+ * type a template parameter) are hashed directly. Objects that
+ * only accept a Hasher are still supported, but are passed a
+ * Hasher that wraps the algorithm stored in this object.
+ *
+ * \tparam Algorithm The hash implementation to use (derived from detail::HashImpl)
+ */
+template<typename Algorithm>
+class BasicHasher : public detail::HasherBase<BasicHasher<Algorithm>>
+{
+    public:
+        BasicHasher(void) = default;
+
+        // Copying includes all the data added so far (if
+        // the algorithm is copyable)
+        BasicHasher(const BasicHasher &)             = default;
+        BasicHasher & operator=(const BasicHasher &) = default;
+        BasicHasher(BasicHasher &&)                  = default;
+        BasicHasher & operator=(BasicHasher &&)      = default;
+
+
+        /*! \brief Create an independent copy of this hasher
+         *
+         * \copydetails Hasher::clone
+         */
+        BasicHasher clone(void) const
+        {
+            return BasicHasher(*this);
+        }
+
+
+        /*! \brief Obtain the hash of all the data added so far
+         *
+         * This does not change the state of the hash, so more data
+         * may be added afterwards.
+         */
+        HashValue peek(void) const
+        {
+            return algo_.Algorithm::finalize();
+        }
+
+
+        /*! \brief Obtain the hash of all the data added so far, as a fixed-size digest
+         *
+         * This does not change the state of the hash, so more data
+         * may be added afterwards.
+         */
+        typename Algorithm::digest_type peek_digest(void) const
+        {
+            BPHASH_INSTRUMENT_FINALIZE();
+            typename Algorithm::digest_type ret;
+            algo_.Algorithm::finalize_into(ret.data());
+            return ret;
+        }
+
+
+        /*! \brief Perform any remaining steps and return the hash
+         *
+         * This is the same as peek(). The hasher may still be used afterwards.
+         */
+        HashValue finalize(void)
+        {
+            return peek();
+        }
+
+
+        /*! \brief Perform any remaining steps and return the hash as a fixed-size digest
+         *
+         * This is the same as peek_digest(). The hasher may still be used afterwards.
+         */
+        typename Algorithm::digest_type finalize_digest(void)
+        {
+            return peek_digest();
+        }
+
+
+    private:
+        friend class detail::HasherBase<BasicHasher<Algorithm>>;
+
+        //! The hash algorithm being used
+        Algorithm algo_;
+
+
+        /*! \brief Add raw data to the hash
+         *
+         * The call is qualified so that it is never dispatched
+         * through the vtable.
+         */
+        void update_raw_(void const * data, size_t nbytes)
+        {
+            BPHASH_INSTRUMENT_IMPL_UPDATE(nbytes);
+            algo_.Algorithm::update(data, nbytes);
+        }
+
+
+        /*! \brief Obtain a Hasher that feeds into our hash algorithm */
+        Hasher make_adapter_(void)
+        {
+            return Hasher(algo_);
+        }
+};
+
+
+} // close namespace bphash
+
@@ -0,0 +1,106 @@
+/*! \file
+ * \brief Detection of CPU features (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/CPUFeatures.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace bphash {
+namespace detail {
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+static ISALevel select_isa_level_(void)
+{
+    ISALevel level = detect_isa_level();
+
+    ISALevel requested;
+    const char * env = std::getenv("BPHASH_ISA");
+
+    if(env != nullptr && parse_isa_level(env, requested) && requested < level)
+        level = requested;
+
+    return level;
+}
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+const char * isa_level_name(ISALevel level)
+{
+    switch(level)
+    {
+        case ISALevel::Generic:
+            return "generic";
+        case ISALevel::SSE2:
+            return "sse2";
+        case ISALevel::SSE42:
+            return "sse4.2";
+        case ISALevel::AVX2:
+            return "avx2";
+    }
+
+    return "unknown";
+}
+
+
+bool parse_isa_level(const char * str, ISALevel & level)
+{
+    const ISALevel all[] = { ISALevel::Generic, ISALevel::SSE2,
+                             ISALevel::SSE42, ISALevel::AVX2 };
+
+    for(ISALevel l : all)
+    {
+        if(std::strcmp(str, isa_level_name(l)) == 0)
+        {
+            level = l;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+ISALevel detect_isa_level(void)
+{
+#if defined(BPHASH_HAVE_X86_64) && defined(__GNUC__)
+    // Also checks that the OS saves the AVX registers
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2"))
+        return ISALevel::AVX2;
+    if(__builtin_cpu_supports("sse4.2"))
+        return ISALevel::SSE42;
+    return ISALevel::SSE2;
+#elif defined(BPHASH_HAVE_X86_64)
+    // Part of the x86-64 baseline
+    return ISALevel::SSE2;
+#else
+    return ISALevel::Generic;
+#endif
+}
+
+
+ISALevel isa_level(void)
+{
+    static const ISALevel level = select_isa_level_();
+    return level;
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,81 @@
+/*! \file
+ * \brief Detection of CPU features (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BPHASH_HAVE_X86_64
+#endif
+
+// Allows for compiling individual kernels for an instruction set
+// without enabling it for the rest of the library
+#if defined(__GNUC__)
+#define BPHASH_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define BPHASH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BPHASH_TARGET_SSE42
+#define BPHASH_TARGET_AVX2
+#endif
+
+namespace bphash {
+namespace detail {
+
+/*! \brief Levels of instruction set support that kernels are compiled for
+ *
+ * These are in increasing order, and each level implies
+ * all of the lower ones.
+ */
+enum class ISALevel
+{
+    Generic, //!< Portable C++ only
+    SSE2,    //!< SSE2 (all x86-64 CPUs)
+    SSE42,   //!< SSE4.2 (including the crc32 instruction)
+    AVX2     //!< AVX2
+};
+
+
+/*! \brief Obtain a printable name of an ISA level
+ *
+ * The names are the same as those accepted by the BPHASH_ISA
+ * environment variable.
+ */
+const char * isa_level_name(ISALevel level);
+
+
+/*! \brief Parse the name of an ISA level
+ *
+ * \return True if \p str was a valid name (which is stored in \p level)
+ */
+bool parse_isa_level(const char * str, ISALevel & level);
+
+
+/*! \brief Determine the highest ISA level supported by this CPU
+ *
+ * This does not take into account the BPHASH_ISA environment variable
+ */
+ISALevel detect_isa_level(void);
+
+
+/*! \brief The highest ISA level kernels are allowed to use
+ *
+ * This is the level supported by the CPU, unless lowered
+ * by setting the BPHASH_ISA environment variable to the
+ * name of a lower level (`generic`, `sse2`, `sse4.2`, or `avx2`).
+ * A level higher than that supported by the CPU is ignored,
+ * as are unknown names.
+ *
+ * This is determined the first time it is called, and
+ * does not change afterwards.
+ */
+ISALevel isa_level(void);
+
+
+} // close namespace detail
+} // close namespace bphash
+
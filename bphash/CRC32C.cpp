@@ -0,0 +1,369 @@
+/*! \file
+ * \brief CRC32C checksum (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* The hardware kernel (three interleaved streams, combined by
+ * shifting with precomputed tables) follows crc32c.c by Mark Adler,
+ * released under the zlib license. */
+
+#include "bphash/CRC32C.hpp"
+
+#include <cstring>
+
+#ifdef BPHASH_CRC32C_HAVE_SSE42_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace bphash {
+namespace detail {
+
+
+////////////////////////////////
+// Lookup tables
+////////////////////////////////
+
+//! The CRC32C polynomial (reversed)
+static const uint32_t crc32c_poly = 0x82F63B78;
+
+//! Size of the blocks of each stream in the hardware kernel
+static const size_t crc32c_long = 8192;
+static const size_t crc32c_short = 256;
+
+
+/* Multiply a 32x32 GF(2) matrix by a vector */
+static uint32_t gf2_matrix_times(uint32_t const * mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+
+    for(; vec != 0; vec >>= 1, mat++)
+    {
+        if(vec & 1)
+            sum ^= *mat;
+    }
+
+    return sum;
+}
+
+
+/* Square a 32x32 GF(2) matrix */
+static void gf2_matrix_square(uint32_t * square, uint32_t const * mat)
+{
+    for(size_t n = 0; n < 32; n++)
+        square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+
+/*! \brief Tables used by the CRC32C kernels
+ *
+ * These are computed once, on first use.
+ */
+struct CRC32CTables
+{
+    //! For the slicing-by-8 table kernel
+    uint32_t slice[8][256];
+
+    //! For shifting a CRC by crc32c_long zero bytes
+    uint32_t zeros_long[4][256];
+
+    //! For shifting a CRC by crc32c_short zero bytes
+    uint32_t zeros_short[4][256];
+
+
+    CRC32CTables(void)
+    {
+        for(uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t crc = n;
+            for(int k = 0; k < 8; k++)
+                crc = (crc & 1) ? (crc >> 1) ^ crc32c_poly : (crc >> 1);
+            slice[0][n] = crc;
+        }
+
+        for(uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t crc = slice[0][n];
+            for(int k = 1; k < 8; k++)
+            {
+                crc = slice[0][crc & 0xff] ^ (crc >> 8);
+                slice[k][n] = crc;
+            }
+        }
+
+        make_zeros_(zeros_long, crc32c_long);
+        make_zeros_(zeros_short, crc32c_short);
+    }
+
+
+    /*! \brief Compute the operator that appends \p len zero bytes to a CRC */
+    static void make_zeros_op_(uint32_t * even, size_t len)
+    {
+        uint32_t odd[32];
+
+        // operator for one zero bit in odd
+        odd[0] = crc32c_poly;
+        uint32_t row = 1;
+        for(size_t n = 1; n < 32; n++)
+        {
+            odd[n] = row;
+            row <<= 1;
+        }
+
+        // two zero bits in even, then four zero bits in odd
+        gf2_matrix_square(even, odd);
+        gf2_matrix_square(odd, even);
+
+        // The first square puts the operator for one zero byte (eight
+        // zero bits) in even. Each following square doubles the number of
+        // zero bytes, alternating between odd and even
+        do
+        {
+            gf2_matrix_square(even, odd);
+            len >>= 1;
+            if(len == 0)
+                return;
+
+            gf2_matrix_square(odd, even);
+            len >>= 1;
+        } while(len);
+
+        std::memcpy(even, odd, sizeof(odd));
+    }
+
+
+    /*! \brief Build tables for quickly applying the zeros operator, a byte at a time */
+    static void make_zeros_(uint32_t zeros[][256], size_t len)
+    {
+        uint32_t op[32];
+        make_zeros_op_(op, len);
+
+        for(uint32_t n = 0; n < 256; n++)
+        {
+            zeros[0][n] = gf2_matrix_times(op, n);
+            zeros[1][n] = gf2_matrix_times(op, n << 8);
+            zeros[2][n] = gf2_matrix_times(op, n << 16);
+            zeros[3][n] = gf2_matrix_times(op, n << 24);
+        }
+    }
+};
+
+
+static const CRC32CTables & crc32c_tables(void)
+{
+    static const CRC32CTables tables;
+    return tables;
+}
+
+
+/* Apply a zeros operator to a CRC */
+static inline uint32_t crc32c_shift(const uint32_t zeros[][256], uint32_t crc)
+{
+    return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^
+           zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+
+
+////////////////////////////////
+// Table kernel
+////////////////////////////////
+
+static uint32_t update_table(uint32_t crc, uint8_t const * data, size_t nbytes)
+{
+    const CRC32CTables & t = crc32c_tables();
+
+    // Bytes until the data is aligned
+    while(nbytes > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0)
+    {
+        crc = t.slice[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+        nbytes--;
+    }
+
+    while(nbytes >= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        word ^= crc;
+
+        crc = t.slice[7][ word        & 0xff] ^ t.slice[6][(word >>  8) & 0xff] ^
+              t.slice[5][(word >> 16) & 0xff] ^ t.slice[4][(word >> 24) & 0xff] ^
+              t.slice[3][(word >> 32) & 0xff] ^ t.slice[2][(word >> 40) & 0xff] ^
+              t.slice[1][(word >> 48) & 0xff] ^ t.slice[0][ word >> 56        ];
+
+        data += 8;
+        nbytes -= 8;
+    }
+
+    while(nbytes > 0)
+    {
+        crc = t.slice[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+        nbytes--;
+    }
+
+    return crc;
+}
+
+
+const CRC32CKernel crc32c_kernel_table = { "table", update_table };
+
+
+
+#ifdef BPHASH_CRC32C_HAVE_SSE42_KERNEL
+
+////////////////////////////////
+// SSE4.2 kernel
+////////////////////////////////
+
+/* Hash nblocks*3 bytes as three independent streams, then combine them.
+ * The crc32 instruction has a latency of 3 cycles but a throughput of one
+ * per cycle, so this keeps the unit busy. */
+BPHASH_TARGET_SSE42
+static inline uint64_t crc32c_3way_sse42(uint64_t crc0, uint8_t const * data, size_t blocksize,
+                                         const uint32_t zeros[][256])
+{
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+
+    for(size_t i = 0; i < blocksize; i += 8)
+    {
+        uint64_t w0, w1, w2;
+        std::memcpy(&w0, data + i, 8);
+        std::memcpy(&w1, data + i + blocksize, 8);
+        std::memcpy(&w2, data + i + 2*blocksize, 8);
+
+        crc0 = _mm_crc32_u64(crc0, w0);
+        crc1 = _mm_crc32_u64(crc1, w1);
+        crc2 = _mm_crc32_u64(crc2, w2);
+    }
+
+    crc0 = crc32c_shift(zeros, static_cast<uint32_t>(crc0)) ^ crc1;
+    crc0 = crc32c_shift(zeros, static_cast<uint32_t>(crc0)) ^ crc2;
+    return crc0;
+}
+
+
+BPHASH_TARGET_SSE42
+static uint32_t update_sse42(uint32_t crc, uint8_t const * data, size_t nbytes)
+{
+    uint64_t crc0 = crc;
+
+    // Bytes until the data is aligned
+    while(nbytes > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0)
+    {
+        crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+        nbytes--;
+    }
+
+    if(nbytes >= 3*crc32c_short)
+    {
+        const CRC32CTables & t = crc32c_tables();
+
+        while(nbytes >= 3*crc32c_long)
+        {
+            crc0 = crc32c_3way_sse42(crc0, data, crc32c_long, t.zeros_long);
+            data += 3*crc32c_long;
+            nbytes -= 3*crc32c_long;
+        }
+
+        while(nbytes >= 3*crc32c_short)
+        {
+            crc0 = crc32c_3way_sse42(crc0, data, crc32c_short, t.zeros_short);
+            data += 3*crc32c_short;
+            nbytes -= 3*crc32c_short;
+        }
+    }
+
+    while(nbytes >= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc0 = _mm_crc32_u64(crc0, word);
+        data += 8;
+        nbytes -= 8;
+    }
+
+    while(nbytes > 0)
+    {
+        crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+        nbytes--;
+    }
+
+    return static_cast<uint32_t>(crc0);
+}
+
+
+const CRC32CKernel crc32c_kernel_sse42 = { "sse4.2", update_sse42 };
+
+#endif // BPHASH_CRC32C_HAVE_SSE42_KERNEL
+
+
+static const CRC32CKernel & select_crc32c_kernel_(void)
+{
+#ifdef BPHASH_CRC32C_HAVE_SSE42_KERNEL
+    if(isa_level() >= ISALevel::SSE42)
+        return crc32c_kernel_sse42;
+#endif
+
+    return crc32c_kernel_table;
+}
+
+
+const CRC32CKernel & crc32c_default_kernel(void)
+{
+    static const CRC32CKernel & kernel = select_crc32c_kernel_();
+    return kernel;
+}
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+CRC32C::CRC32C(void)
+    : CRC32C(crc32c_default_kernel())
+{ }
+
+
+CRC32C::CRC32C(const CRC32CKernel & kernel)
+    : kernel_(&kernel)
+{
+    reset();
+}
+
+
+size_t CRC32C::hash_size(void) const
+{
+    return 4;
+}
+
+
+void CRC32C::reset(void)
+{
+    crc_ = 0xFFFFFFFF;
+}
+
+
+std::unique_ptr<HashImpl> CRC32C::clone(void) const
+{
+    return std::unique_ptr<HashImpl>(new CRC32C(*this));
+}
+
+
+void CRC32C::finalize_into(uint8_t * out) const
+{
+    const uint32_t crc = ~crc_;
+
+    // Big-endian, so that it reads as the usual hex value
+    for(size_t i = 0; i < 4; i++)
+        out[i] = static_cast<uint8_t>(crc >> (24 - i*8));
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,128 @@
+/*! \file
+ * \brief CRC32C checksum (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/HashImpl.hpp"
+#include "bphash/CPUFeatures.hpp"
+
+namespace bphash {
+namespace detail {
+
+/*! \brief A kernel that updates a CRC32C register with some data
+ *
+ * All kernels give identical results.
+ */
+struct CRC32CKernel
+{
+    //! Name of the kernel (for diagnostics)
+    const char * name;
+
+    /*! \brief Add data to the CRC register
+     *
+     * The register is the CRC before the final inversion (ie, it starts at 0xFFFFFFFF).
+     */
+    uint32_t (*update)(uint32_t crc, uint8_t const * data, size_t nbytes);
+};
+
+
+//! Portable kernel, using lookup tables (slicing-by-8)
+extern const CRC32CKernel crc32c_kernel_table;
+
+#ifdef BPHASH_HAVE_X86_64
+#define BPHASH_CRC32C_HAVE_SSE42_KERNEL
+
+/*! \brief Kernel using the SSE4.2 crc32 instruction
+ *
+ * Must only be used if the CPU supports SSE4.2
+ */
+extern const CRC32CKernel crc32c_kernel_sse42;
+#endif
+
+
+/*! \brief The kernel used by default
+ *
+ * This is the best kernel supported by the CPU, chosen the
+ * first time this is called (see isa_level()).
+ */
+const CRC32CKernel & crc32c_default_kernel(void);
+
+
+
+/*! \brief Implementation of the CRC32C (Castagnoli) checksum
+ *
+ * This is the CRC used by iSCSI, SCTP, ext4, and many storage
+ * formats (reflected polynomial 0x82F63B78, initial value and
+ * final XOR of 0xFFFFFFFF). It is not a good general-purpose hash, but
+ * is useful when the same bytes would otherwise need to be checksummed
+ * in a separate pass.
+ *
+ * The checksum is written in big-endian byte order, so that hash_to_string
+ * gives the usual hexadecimal form of the CRC (for example, "e3069283" for
+ * the string "123456789").
+ */
+class CRC32C : public HashImpl
+{
+    public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest32 digest_type;
+
+        /*! \brief Construct, using the default kernel */
+        CRC32C(void);
+
+        /*! \brief Construct, using a specific kernel
+         *
+         * The kernel must be supported by the CPU.
+         */
+        explicit CRC32C(const CRC32CKernel & kernel);
+
+        ~CRC32C(void) = default;
+
+        CRC32C(const CRC32C &) = default;
+        CRC32C & operator=(const CRC32C &) = default;
+        CRC32C(CRC32C &&) = default;
+        CRC32C & operator=(CRC32C &&) = default;
+
+        /////////////////////////////////
+        // Virtual functions of HashImpl
+        /////////////////////////////////
+
+        virtual void update(void const * data, size_t nbytes);
+
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
+
+        virtual void reset(void);
+
+
+    private:
+        const CRC32CKernel * kernel_;   //!< Kernel doing the actual work
+        uint32_t crc_;                  //!< The CRC register
+};
+
+
+////////////////////////////////////////////
+// Inline functions
+//
+// These are kept in the header so that they
+// can be inlined when the algorithm type is known
+// at compile time (see BasicHasher)
+////////////////////////////////////////////
+inline void CRC32C::update(void const * data, size_t nbytes)
+{
+    crc_ = kernel_->update(crc_, static_cast<uint8_t const *>(data), nbytes);
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,204 @@
+/*! \file
+ * \brief Wrapper that stores the hash of an object
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hasher.hpp"
+
+#include <atomic>
+#include <mutex>
+
+namespace bphash {
+
+
+/*! \brief Wraps an object and stores its hash once computed
+ *
+ * The 128-bit hash (HashType::Hash128) of the wrapped object is
+ * computed the first time it is needed, and then kept. When a
+ * CachedHash is hashed as part of something else, only the stored
+ * digest is added to the hash. This avoids repeatedly hashing large
+ * objects that rarely change.
+ *
+ * Therefore, hashing a `CachedHash<T>` gives a different result than
+ * hashing the `T` it contains.
+ *
+ * The digest may be computed by several threads at once (it is only
+ * computed by one of them). Modifying the object, via modify() or
+ * invalidate(), must not happen at the same time as any other use.
+ *
+ * \tparam T The type of object to wrap. Must be hashable
+ */
+template<typename T>
+class CachedHash
+{
+    public:
+        /*! \brief Construct with a default-constructed object */
+        CachedHash(void)
+            : value_(), valid_(false)
+        { }
+
+
+        /*! \brief Construct by copying or moving an object */
+        explicit CachedHash(T value)
+            : value_(std::move(value)), valid_(false)
+        { }
+
+
+        /*! \brief Copy, including the digest if it has been computed */
+        CachedHash(const CachedHash & rhs)
+            : value_(rhs.value_), valid_(false)
+        {
+            copy_digest_(rhs);
+        }
+
+
+        /*! \brief Move, including the digest if it has been computed */
+        CachedHash(CachedHash && rhs)
+            : value_(std::move(rhs.value_)), valid_(false)
+        {
+            copy_digest_(rhs);
+            rhs.invalidate();
+        }
+
+
+        CachedHash & operator=(const CachedHash & rhs)
+        {
+            if(this != &rhs)
+            {
+                value_ = rhs.value_;
+                copy_digest_(rhs);
+            }
+            return *this;
+        }
+
+
+        CachedHash & operator=(CachedHash && rhs)
+        {
+            if(this != &rhs)
+            {
+                value_ = std::move(rhs.value_);
+                copy_digest_(rhs);
+                rhs.invalidate();
+            }
+            return *this;
+        }
+
+
+        /*! \brief Obtain the wrapped object */
+        const T & get(void) const { return value_; }
+
+        const T & operator*(void) const { return value_; }
+
+        const T * operator->(void) const { return &value_; }
+
+
+        /*! \brief Obtain the wrapped object for modification
+         *
+         * The stored digest is discarded, and will be recomputed
+         * when next needed. The returned reference must not be used
+         * to modify the object after the digest is obtained again.
+         */
+        T & modify(void)
+        {
+            invalidate();
+            return value_;
+        }
+
+
+        /*! \brief Discard the stored digest
+         *
+         * It will be recomputed when next needed.
+         */
+        void invalidate(void)
+        {
+            valid_.store(false, std::memory_order_release);
+        }
+
+
+        /*! \brief Whether the digest has been computed and stored */
+        bool has_digest(void) const
+        {
+            return valid_.load(std::memory_order_acquire);
+        }
+
+
+        /*! \brief Obtain the 128-bit hash of the wrapped object
+         *
+         * This is computed on the first call (after construction or
+         * invalidation) and stored.
+         */
+        Digest128 digest(void) const
+        {
+            if(valid_.load(std::memory_order_acquire))
+                return digest_;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // May have been computed while we were waiting
+            if(!valid_.load(std::memory_order_relaxed))
+            {
+                Hasher h(HashType::Hash128);
+                h(value_);
+                digest_ = h.peek_digest<16>();
+                valid_.store(true, std::memory_order_release);
+            }
+
+            return digest_;
+        }
+
+
+        /*! \brief Compare two wrapped objects
+         *
+         * If the digests differ, the objects are different and are
+         * not compared further. Otherwise, the objects are compared
+         * with their `==` operator.
+         */
+        friend bool operator==(const CachedHash & lhs, const CachedHash & rhs)
+        {
+            if(&lhs == &rhs)
+                return true;
+
+            return lhs.digest() == rhs.digest() && lhs.value_ == rhs.value_;
+        }
+
+
+        /*! \brief Compare two wrapped objects
+         *
+         * \copydetails operator==(const CachedHash &, const CachedHash &)
+         */
+        friend bool operator!=(const CachedHash & lhs, const CachedHash & rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+
+    private:
+        T value_;   //!< The wrapped object
+
+        mutable Digest128 digest_;          //!< The stored digest (if valid_)
+        mutable std::atomic<bool> valid_;   //!< Whether digest_ has been computed
+        mutable std::mutex mutex_;          //!< Serializes computing the digest
+
+
+        /*! \brief Take the digest of another object (if it has one) */
+        void copy_digest_(const CachedHash & rhs)
+        {
+            if(rhs.has_digest())
+            {
+                digest_ = rhs.digest_;
+                valid_.store(true, std::memory_order_release);
+            }
+            else
+                invalidate();
+        }
+};
+
+
+} // close namespace bphash
+
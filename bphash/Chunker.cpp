@@ -0,0 +1,323 @@
+/*! \file
+ * \brief Rolling hash and content-defined chunking (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/Chunker.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace bphash {
+namespace detail {
+
+/* These must never change, since they determine where chunks end.
+ * They are the output of splitmix64, starting from 0x6a09e667f3bcc908 */
+const uint64_t gear_table[256] = {
+    0x1ac046dda8e86e2aLLU, 0xbe2c3b00b1d348c8LLU, 0x9b1a66a95412ff75LLU, 0xc448c2b1f05f7e4cLLU,
+    0xc111ca6b8f6e73c4LLU, 0xb54861920d05b01dLLU, 0x8d61500f4a7bbe16LLU, 0x5e0c25471f89e02eLLU,
+    0x48105a3d28f0e221LLU, 0x2169f8846b637746LLU, 0x3d628782e0c0d863LLU, 0xa5ddb2216078aa40LLU,
+    0xc8119d17f0571101LLU, 0x98e2e2eb8f33280fLLU, 0x8cd1e28860679cc4LLU, 0x9dca6189c923aef3LLU,
+    0x9d8d3071ba4f04c4LLU, 0x5d395ada34220c26LLU, 0xe6de42a441a1e28eLLU, 0x308fbf68cc864f59LLU,
+    0x216a3c81332862f9LLU, 0xbaceca0a77f3132eLLU, 0xdf2a2215339ca69cLLU, 0x3e4c11a103a5d859LLU,
+    0x6d0f173ffec5f603LLU, 0x0bf4bc630d193bb6LLU, 0x5f76c4ad104b57fdLLU, 0x99ca459f4e93f651LLU,
+    0x4751799d68cf88a0LLU, 0xa6b1639e3b42b61cLLU, 0x278b01031924ea35LLU, 0x430253eb7e993605LLU,
+    0x5f4e14147961f2e8LLU, 0x52aead5ef08ac45fLLU, 0x583dca09af910274LLU, 0x4a8b9d4b576480cbLLU,
+    0xbee913dc4ef28b44LLU, 0x7de79c7a57af8587LLU, 0x1ecf42b9e34cd874LLU, 0x38adac4ab1f3aad1LLU,
+    0x80ff3025878a34b8LLU, 0xf10a8816c7ac2d95LLU, 0xeff8dc4b1fa1c5d4LLU, 0x0b0ebe1144fe022fLLU,
+    0x4d46a271e58e80a2LLU, 0x09cd31f10075274fLLU, 0xa82f74eaa55bc441LLU, 0x497f6541631d47a4LLU,
+    0x888b7ede7346db17LLU, 0x256147dc71c784e0LLU, 0x8a5d6ed77045cd6cLLU, 0xa9fc0986de332f0bLLU,
+    0x2f597787e8c75c47LLU, 0x3648fb06e09eefe8LLU, 0xceac1655a16aee55LLU, 0x614c72624b61148dLLU,
+    0x4cbdd6aec064c0f0LLU, 0x6620e70990008130LLU, 0x0f7c12bf3c7e6fc3LLU, 0x33a8b131d6275b9bLLU,
+    0xfa11bd2037c759caLLU, 0x720ddad5e616729aLLU, 0xf7d65a62aa36f6cdLLU, 0x79c452ac75db451dLLU,
+    0xb67b17d3a1221ec5LLU, 0xa121663523494b41LLU, 0xb0299b3ec41c4cedLLU, 0x6fc29450adcad869LLU,
+    0x47e9b8ec3fc8cbb7LLU, 0x62fdc189d1af50f0LLU, 0xe2a4894d230c71c5LLU, 0x2b29e84f96f10a17LLU,
+    0x6a06d8f31cc8127bLLU, 0xd2cff0ec00d51e42LLU, 0x53a34f9751fa14dbLLU, 0x5527bdf3764839bdLLU,
+    0x5b2b498aa588f2d2LLU, 0x036c60fb15914351LLU, 0x796dff2c504ae68cLLU, 0xa0b68b3deb4a26eeLLU,
+    0x538d384072828564LLU, 0x5c8365c92d8e618eLLU, 0xadcbd6468938043eLLU, 0xa62e0a7bfd3c7a87LLU,
+    0xf94882172a2802d2LLU, 0xe1460d5af30b3df4LLU, 0x875af97cf2a77a1eLLU, 0xcd4ced68dc5d03feLLU,
+    0x34b85bbb2ed2cbb8LLU, 0x14382eba487c2a39LLU, 0x1bf2b642ec0d725eLLU, 0x3180c22f85fd4a6eLLU,
+    0x6287e68c688b0a6aLLU, 0xc781dbd269c1579bLLU, 0x967fba740d8851eeLLU, 0x8bcb6289f451eab1LLU,
+    0xb00af395b957706aLLU, 0xd66f731a7ebc0d9aLLU, 0x0753e0b1e260c0ffLLU, 0x9123b3fc244c22f0LLU,
+    0xea18df1333df68c7LLU, 0x9eec6b6e47ee4d7fLLU, 0xfb67ca727d5a7eecLLU, 0xff8b16c00c21c99eLLU,
+    0x358784cdb4cb66ecLLU, 0x03216b3236e1a9f0LLU, 0xb04c2b63efd0ff13LLU, 0x7c706fdd841f7fdeLLU,
+    0x7d73537d5868a02aLLU, 0x79d2f0856b8f869bLLU, 0x3ed8cd3a1f18f1dcLLU, 0xa63e972135a79123LLU,
+    0xbae6b248ea01376fLLU, 0xc6a62efd6e07e935LLU, 0x95bd020eb8287729LLU, 0xddc64b8aa63f411bLLU,
+    0xe3b876db230a4b8cLLU, 0xfc2662a03a990c51LLU, 0xc4164ab8549560b2LLU, 0x03661ab91fdc46cfLLU,
+    0x407d681d863d005eLLU, 0x748cad2bdea25f24LLU, 0xa6af3a8fbbe02591LLU, 0x4fe003a7ae850547LLU,
+    0x016d512803fe9519LLU, 0xd3c80ba79b797d64LLU, 0x519a33023219d39fLLU, 0xa9b8738fd7958fcaLLU,
+    0xb068afbcd3e6cfacLLU, 0x12d82d1c233b6a89LLU, 0x52ff395050d637efLLU, 0x0b9289abd111c12bLLU,
+    0x280a50d348204e9dLLU, 0xc3e4bfbbb3b183f7LLU, 0x460ac41c779fb804LLU, 0x50a570f9e185ec4bLLU,
+    0x3f4da17a82d062a7LLU, 0xd09ec8514e2854b2LLU, 0xd693ad5620641415LLU, 0xa7b39dbe6975c0caLLU,
+    0xa0d0f63f4d9aef1aLLU, 0x15af0cbc4969c7d5LLU, 0x278011eaab5c3f0eLLU, 0x5e1cf19380ce0c38LLU,
+    0xb1ba4d9029a2956dLLU, 0x73f08e7440c16206LLU, 0x6f9b01ffb859822eLLU, 0x5a11189a2b6728e2LLU,
+    0xa8558b99a4170496LLU, 0x7f2f938318e74c32LLU, 0xbea616a7fd5e3bc4LLU, 0xdbfeafdd8425000dLLU,
+    0x38c230df150c847fLLU, 0x17ec72a519accd61LLU, 0x036fa2fbc835b4f6LLU, 0x3f4902d125ddcaeeLLU,
+    0xc9dc1fec3a0ac22fLLU, 0x4fc8d70c9ee4d990LLU, 0xaae8a531b1c93da2LLU, 0xe1fa0e077e0cec8cLLU,
+    0x90356a76ca9c574bLLU, 0x2a26cc7a2879d838LLU, 0xcf4ed251a2ae162bLLU, 0x098b973c62c609eaLLU,
+    0x1be77277ef4b9126LLU, 0x2acb7cac64d26155LLU, 0xd876dbe01e1e90acLLU, 0x51ad90e39ff2711dLLU,
+    0x56c2dbc758d198b0LLU, 0x1f4e0301f8842f44LLU, 0x708969745130b1a1LLU, 0x9a4311b95a6a991dLLU,
+    0x9afcede497e4ddb6LLU, 0xcf3169e617e9ca2dLLU, 0x1b4ecbbf8e54cf3dLLU, 0x5e9ce5d535be41b4LLU,
+    0xe7faa5baf8248ea5LLU, 0x3675637ace70bdceLLU, 0xd980d9032ec07c88LLU, 0xec6e37a873ecf8b1LLU,
+    0xf9d4074f810c18dbLLU, 0xb60a4b86daa6ef2aLLU, 0x4e899a8f297395dbLLU, 0x7165c4bd2470cda3LLU,
+    0x8253b43083c02137LLU, 0x3e025a61ee7fd941LLU, 0x322e76006c21fe35LLU, 0x0ad2377d2e13ed73LLU,
+    0x46c5cca798eb198eLLU, 0x0f73c7b0b88be5a0LLU, 0x9bdbeb2841204b09LLU, 0x4d196436aae8e99bLLU,
+    0x7f3bba1f8a36d062LLU, 0xe65247c253ec319fLLU, 0x536ec5f02d4e4335LLU, 0x13a17a653a4e29abLLU,
+    0x6eb9f62ff9e69bcdLLU, 0x9be0c43eee73606bLLU, 0x42aa9b137474a26aLLU, 0x38d992c2b7969b10LLU,
+    0x00584830af6dcb06LLU, 0x21fbd546ca9dc7b4LLU, 0x613143aef10f037eLLU, 0x249018dd3524b6ebLLU,
+    0x625f5025eb78a5dbLLU, 0x89dffc140591ea45LLU, 0xeabe2cb345bb7fa9LLU, 0xb3d74fdd70015b81LLU,
+    0xd31bf6ac6e6eff00LLU, 0xffa32024d7e7a05eLLU, 0x32675789370b11c1LLU, 0x26cf04b6940262d0LLU,
+    0x7016e72357d61660LLU, 0x25818a6720cebd3fLLU, 0xdb731160b31e0635LLU, 0x380407a507c37907LLU,
+    0xcadf246dd50299f4LLU, 0xbf8f0f184d6c4a16LLU, 0x38119a0902b7a6d0LLU, 0x06ac8fe2ec3606b2LLU,
+    0x7abc00c02cc859ccLLU, 0xf93819575bbf449eLLU, 0x2d9dc57e43f28641LLU, 0xea5df4a5436eaf2fLLU,
+    0xcab3b92f92d36e8bLLU, 0x211bcfa592b9e1bfLLU, 0x67ae1da4c7d43427LLU, 0xad700ad7ccaea894LLU,
+    0x2b107d3d815d86d8LLU, 0x0010b23e14c8bef3LLU, 0x2b1d0f1d75d26f7bLLU, 0x3b4ff56c622e7f43LLU,
+    0x6cacaa7ec6e2f69eLLU, 0xf134b52034eb99ddLLU, 0x9a2f4c1d1b73a531LLU, 0xf3e4ad23b672706dLLU,
+    0x5c39b33babb430d6LLU, 0xb3c783a4732b3fd5LLU, 0xefd45192ceb437adLLU, 0x7d16c00ff3817bc1LLU,
+    0xf69003865fca895eLLU, 0xbd83805faee0202eLLU, 0x398c44e739df0decLLU, 0x7b190c1260f2583eLLU,
+    0xf33479f42bf6780cLLU, 0x1e4b54e22fbe719dLLU, 0x03d1f2ee77632020LLU, 0x2a7414b98717fdc8LLU,
+    0x8534a1646babf432LLU, 0x55af162af065b106LLU, 0x47cdbd2911f272e8LLU, 0x7d9f49a5d5fce2e7LLU,
+    0x0196fe50064dbca7LLU, 0x69c325a23ab5755fLLU, 0xb9cabfd1de7de997LLU, 0x869756f713a06d5eLLU
+};
+
+} // close namespace detail
+
+
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+// Ranges shorter than twice this are scanned in a single lane
+static const size_t gear_lane_min = 256;
+
+
+/* First size in [first, last) for which the hash of the 64 bytes before
+ * the end of the chunk has none of the bits of the mask set (or last, if none).
+ *
+ * The chunk starts at p, and first must be at least GearHash::window_size */
+static size_t find_end_scalar_(uint8_t const * p, size_t first, size_t last, uint64_t mask)
+{
+    // Hash the window before the first size to be tested
+    uint64_t h = 0;
+    for(size_t i = first - GearHash::window_size; i < first - 1; i++)
+        h = (h << 1) + detail::gear_table[p[i]];
+
+    for(size_t size = first; size < last; size++)
+    {
+        h = (h << 1) + detail::gear_table[p[size - 1]];
+        if(!(h & mask))
+            return size;
+    }
+
+    return last;
+}
+
+
+/* As find_end_scalar_, but the two halves of the range are scanned at
+ * the same time. Since the hash only depends on the last 64 bytes, the second
+ * half can be started anywhere, and the two lanes don't depend on each other. */
+static size_t find_end_lanes_(uint8_t const * p, size_t first, size_t last, uint64_t mask)
+{
+    const size_t n = (last - first) / 2;
+    if(n < gear_lane_min)
+        return find_end_scalar_(p, first, last, mask);
+
+    const size_t mid = first + n;
+    uint8_t const * pa = p + first - GearHash::window_size;
+    uint8_t const * pb = p + mid - GearHash::window_size;
+
+    uint64_t ha = 0;
+    uint64_t hb = 0;
+    for(size_t i = 0; i < GearHash::window_size - 1; i++)
+    {
+        ha = (ha << 1) + detail::gear_table[pa[i]];
+        hb = (hb << 1) + detail::gear_table[pb[i]];
+    }
+
+    pa += GearHash::window_size - 1;
+    pb += GearHash::window_size - 1;
+
+    size_t i = 0;
+    for(; i < n; i++)
+    {
+        ha = (ha << 1) + detail::gear_table[pa[i]];
+        hb = (hb << 1) + detail::gear_table[pb[i]];
+        if(!(ha & mask) | !(hb & mask))
+            break;
+    }
+
+    // Neither lane found an end. There may be one size left over.
+    if(i == n)
+        return find_end_scalar_(p, mid + n, last, mask);
+
+    if(!(ha & mask))
+        return first + i;
+
+    // Only the second lane found an end, so the rest of the first
+    // lane must be checked for an earlier one
+    const size_t size = find_end_scalar_(p, first + i + 1, mid, mask);
+    return size < mid ? size : mid + i;
+}
+
+
+size_t Chunker::find_end_(uint8_t const * p, size_t nbytes, size_t & from) const
+{
+    if(nbytes < min_)
+        return 0;
+
+    // Sizes up to nbytes can be tested
+    const size_t limit = nbytes + 1;
+
+    if(from < avg_)
+    {
+        const size_t last = std::min(avg_, limit);
+        const size_t size = find_end_lanes_(p, from, last, mask_small_);
+        if(size < last)
+            return size;
+
+        from = last;
+        if(from < avg_)
+            return 0;
+    }
+
+    const size_t last = std::min(max_, limit);
+    const size_t size = find_end_scalar_(p, from, last, mask_large_);
+    if(size < last)
+        return size;
+
+    from = last;
+    return nbytes >= max_ ? max_ : 0;
+}
+
+
+void Chunker::emit_(uint8_t const * p, size_t size, std::vector<Chunk> & chunks)
+{
+    Chunk c;
+    c.offset = offset_;
+    c.size = size;
+    c.digest.resize(impl_->hash_size());
+
+    impl_->reset();
+    impl_->update(p, size);
+    impl_->finalize_into(c.digest.data());
+
+    chunks.push_back(std::move(c));
+    offset_ += size;
+}
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+Chunker::Chunker(HashType type)
+    : Chunker(default_min_size, default_avg_size, default_max_size, type)
+{ }
+
+
+Chunker::Chunker(size_t min_size, size_t avg_size, size_t max_size, HashType type)
+    : min_(min_size), max_(max_size), impl_(detail::make_hash_impl(type)),
+      scan_pos_(min_size), offset_(0)
+{
+    if(min_size < GearHash::window_size)
+        throw std::invalid_argument("Minimum chunk size is smaller than the window of the rolling hash");
+    if(avg_size < min_size || max_size < avg_size)
+        throw std::invalid_argument("Chunk sizes must be given in increasing order");
+
+    // Number of bits for the average size (rounded down to a power of two)
+    size_t bits = 0;
+    while((size_t(2) << bits) <= avg_size)
+        bits++;
+
+    avg_ = std::max(size_t(1) << bits, min_size);
+
+    // The highest bits of the hash are used, since they depend on the entire window
+    mask_small_ = ~uint64_t(0) << (64 - (bits + 2));
+    mask_large_ = ~uint64_t(0) << (64 - (bits - 2));
+}
+
+
+size_t Chunker::update(void const * data, size_t nbytes, std::vector<Chunk> & chunks)
+{
+    const size_t nbefore = chunks.size();
+    uint8_t const * p = static_cast<uint8_t const *>(data);
+
+    // Finish a chunk started by earlier data. Bytes are only
+    // copied up to the maximum size of the chunk.
+    if(!pending_.empty())
+    {
+        const size_t ncopy = std::min(nbytes, max_ - pending_.size());
+        pending_.insert(pending_.end(), p, p + ncopy);
+
+        const size_t size = find_end_(pending_.data(), pending_.size(), scan_pos_);
+        if(size == 0)
+            return 0;   // All of the data was copied
+
+        emit_(pending_.data(), size, chunks);
+
+        // Copied bytes after the end of the chunk are used from the data instead
+        const size_t nused = ncopy - (pending_.size() - size);
+        p += nused;
+        nbytes -= nused;
+        pending_.clear();
+    }
+
+    // Chunks that end within the data are hashed in place
+    size_t from = min_;
+    while(true)
+    {
+        from = min_;
+        const size_t size = find_end_(p, nbytes, from);
+        if(size == 0)
+            break;
+
+        emit_(p, size, chunks);
+        p += size;
+        nbytes -= size;
+    }
+
+    pending_.assign(p, p + nbytes);
+    scan_pos_ = from;
+    return chunks.size() - nbefore;
+}
+
+
+size_t Chunker::finish(std::vector<Chunk> & chunks)
+{
+    size_t n = 0;
+    if(!pending_.empty())
+    {
+        emit_(pending_.data(), pending_.size(), chunks);
+        n = 1;
+    }
+
+    reset();
+    return n;
+}
+
+
+std::vector<Chunker::Chunk> Chunker::chunk(void const * data, size_t nbytes)
+{
+    std::vector<Chunk> chunks;
+    reset();
+    update(data, nbytes, chunks);
+    finish(chunks);
+    return chunks;
+}
+
+
+void Chunker::reset(void)
+{
+    pending_.clear();
+    scan_pos_ = min_;
+    offset_ = 0;
+}
+
+
+} // close namespace bphash
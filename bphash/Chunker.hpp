@@ -0,0 +1,224 @@
+/*! \file
+ * \brief Rolling hash and content-defined chunking (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hash.hpp"
+#include "bphash/Hasher.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace bphash {
+namespace detail {
+
+//! Random values for each byte, used by the Gear hash
+extern const uint64_t gear_table[256];
+
+} // close namespace detail
+
+
+/*! \brief The Gear rolling hash
+ *
+ * Each byte shifts the hash left by one bit and adds a random
+ * value for that byte. Since the contributions of older bytes are shifted
+ * out, the hash depends only on the last 64 bytes (and its highest bits
+ * depend on all of them, while its lowest bits depend only on the
+ * last few bytes).
+ */
+class GearHash
+{
+    public:
+        //! Number of bytes that the hash depends on
+        static const size_t window_size = 64;
+
+
+        GearHash(void) : hash_(0) { }
+
+
+        /*! \brief Add a byte to the hash
+         *
+         * \return The new value of the hash
+         */
+        uint64_t roll(uint8_t byte)
+        {
+            hash_ = (hash_ << 1) + detail::gear_table[byte];
+            return hash_;
+        }
+
+
+        /*! \brief Add many bytes to the hash
+         *
+         * \return The new value of the hash
+         */
+        uint64_t roll(void const * data, size_t nbytes)
+        {
+            uint8_t const * p = static_cast<uint8_t const *>(data);
+            for(size_t i = 0; i < nbytes; i++)
+                roll(p[i]);
+            return hash_;
+        }
+
+
+        /*! \brief The current value of the hash */
+        uint64_t value(void) const { return hash_; }
+
+
+        /*! \brief Start over, as if no bytes had been added */
+        void reset(void) { hash_ = 0; }
+
+
+    private:
+        uint64_t hash_;
+};
+
+
+
+/*! \brief Splits data into chunks at points determined by its content
+ *
+ * A chunk ends after a byte where the Gear hash of the previous 64 bytes
+ * has its highest bits all zero. Since this depends only on nearby
+ * content, inserting or removing bytes changes only the chunks around the
+ * change, and identical data in different files or at different offsets
+ * is split into identical chunks. This makes the chunks suitable for
+ * deduplication (see ContentStore) and for finding differences between files.
+ *
+ * Chunk sizes are kept between a minimum and maximum, and are
+ * normalized towards the average size (as in FastCDC): more bits must be zero
+ * before the average size is reached, and fewer afterwards. The first bytes
+ * of each chunk (up to the minimum size) are skipped rather than scanned.
+ * Before the average size, where a chunk rarely ends, two parts of the data
+ * are scanned at the same time in interleaved lanes.
+ *
+ * Each chunk is hashed with the given hash type as soon as its end is found
+ * (while it is still in cache), so that the data is only read from memory once.
+ * The digests are those of the raw bytes, as with ContentStore::digest().
+ *
+ * Data may be given all at once with chunk(), or in pieces of any size
+ * with update() and finish(). The chunks are the same either way.
+ */
+class Chunker
+{
+    public:
+        /*! \brief A chunk of the data */
+        struct Chunk
+        {
+            uint64_t offset;    //!< Offset of the chunk from the start of the data
+            size_t size;        //!< Size of the chunk (in bytes)
+            HashValue digest;   //!< Hash of the bytes of the chunk
+        };
+
+        //! Default minimum size of a chunk
+        static const size_t default_min_size = 2048;
+
+        //! Default average size of a chunk
+        static const size_t default_avg_size = 8192;
+
+        //! Default maximum size of a chunk
+        static const size_t default_max_size = 65536;
+
+
+        /*! \brief Construct, using the default chunk sizes
+         *
+         * \param [in] type Hash used for the digest of each chunk
+         */
+        explicit Chunker(HashType type = HashType::Hash128);
+
+
+        /*! \brief Construct, with the given chunk sizes
+         *
+         * The average size is rounded down to a power of two. Only the last chunk
+         * may be smaller than the minimum.
+         *
+         * \throw std::invalid_argument if \p min_size is less than GearHash::window_size,
+         *        or the sizes are not in increasing order
+         *
+         * \param [in] min_size Minimum size of a chunk (in bytes)
+         * \param [in] avg_size Average size of a chunk (in bytes)
+         * \param [in] max_size Maximum size of a chunk (in bytes)
+         * \param [in] type Hash used for the digest of each chunk
+         */
+        Chunker(size_t min_size, size_t avg_size, size_t max_size,
+                HashType type = HashType::Hash128);
+
+        Chunker(const Chunker &)             = delete;
+        Chunker & operator=(const Chunker &) = delete;
+
+
+        /*! \brief Split more data into chunks
+         *
+         * Chunks that end within this data are appended to \p chunks. Bytes after
+         * the last of them are kept until more data is given (at most \p max_size
+         * bytes are copied).
+         *
+         * \param [in] data The data to add
+         * \param [in] nbytes Size of the data (in bytes)
+         * \param [inout] chunks Where to append the chunks that were found
+         * \return The number of chunks appended
+         */
+        size_t update(void const * data, size_t nbytes, std::vector<Chunk> & chunks);
+
+
+        /*! \brief Finish the data, appending the remaining bytes as the last chunk
+         *
+         * The chunker is then reset, and may be used for new data.
+         *
+         * \return The number of chunks appended (zero or one)
+         */
+        size_t finish(std::vector<Chunk> & chunks);
+
+
+        /*! \brief Split data into chunks all at once
+         *
+         * Any data given earlier to update() is discarded.
+         */
+        std::vector<Chunk> chunk(void const * data, size_t nbytes);
+
+
+        /*! \brief Discard any data given to update(), and start over */
+        void reset(void);
+
+
+        size_t min_size(void) const { return min_; }
+        size_t avg_size(void) const { return avg_; }
+        size_t max_size(void) const { return max_; }
+
+
+        /*! \brief Number of bytes given to update() since the start (or reset) */
+        uint64_t offset(void) const { return offset_ + pending_.size(); }
+
+
+    private:
+        size_t min_;
+        size_t avg_;
+        size_t max_;
+        uint64_t mask_small_;   // Bits that must be zero before the average size
+        uint64_t mask_large_;   // Bits that must be zero after the average size
+
+        std::unique_ptr<detail::HashImpl> impl_;
+
+        std::vector<uint8_t> pending_;   // Start of a chunk whose end has not been found
+        size_t scan_pos_;                // Next size of the pending chunk to be tested
+        uint64_t offset_;                // Offset of the start of the pending chunk
+
+
+        /*! \brief Find the end of the chunk starting at \p p
+         *
+         * Sizes from \p from are tested. If more data is needed, zero is
+         * returned and \p from is set to the next size to test.
+         */
+        size_t find_end_(uint8_t const * p, size_t nbytes, size_t & from) const;
+
+
+        /*! \brief Hash a chunk and append it */
+        void emit_(uint8_t const * p, size_t size, std::vector<Chunk> & chunks);
+};
+
+} // close namespace bphash
+
@@ -0,0 +1,289 @@
+/*! \file
+ * \brief A hash map that may be used by many threads at once
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/FlatMap.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace bphash {
+
+/*! \brief A hash map split into shards, each with its own lock
+ *
+ * The highest bits of the hash of a key choose its shard, and the rest are
+ * used within the shard (a flat_map). Threads working with keys in different
+ * shards do not contend for the same lock, so there is much less contention
+ * than with a single map behind a single mutex.
+ *
+ * Each key is hashed before its shard is locked. The hash may also be computed
+ * once with hash() and passed to the functions taking a precomputed hash,
+ * so that a key used several times is only hashed once. The shards
+ * store the hash of each key, so keys are never hashed while a lock
+ * is held (including when a shard grows).
+ *
+ * References to elements can't be returned, since they could be changed
+ * or moved by another thread. Values are copied out instead, or may be
+ * accessed with visit() while the shard is locked.
+ *
+ * \tparam Key Type of the keys
+ * \tparam T Type of the mapped values
+ * \tparam Hash Function object giving the hash of a key (as `size_t`)
+ * \tparam KeyEqual Function object comparing keys
+ */
+template<typename Key, typename T,
+         typename Hash = StdHash<Key>,
+         typename KeyEqual = std::equal_to<Key>>
+class concurrent_map
+{
+    public:
+        typedef Key key_type;
+        typedef T mapped_type;
+        typedef flat_map<Key, T, Hash, KeyEqual, true> shard_map;
+
+
+        /*! \brief Construct an empty map
+         *
+         * \param [in] nshards Number of shards. Rounded up to a power of two.
+         *                     If zero, four times the number of hardware
+         *                     threads (but at least 16) is used.
+         */
+        explicit concurrent_map(size_t nshards = 0, const Hash & hash = Hash())
+            : hash_(hash)
+        {
+            if(nshards == 0)
+                nshards = std::max<size_t>(16, 4 * std::thread::hardware_concurrency());
+
+            size_t bits = 0;
+            while((size_t(1) << bits) < nshards)
+                bits++;
+
+            nshards_ = size_t(1) << bits;
+            shift_ = 8 * sizeof(size_t) - bits;
+            shards_.reset(new Shard[nshards_]);
+        }
+
+
+        concurrent_map(const concurrent_map &)             = delete;
+        concurrent_map & operator=(const concurrent_map &) = delete;
+
+
+        /*! \brief Number of shards */
+        size_t nshards(void) const { return nshards_; }
+
+
+        /*! \brief Compute the hash of a key, for use with the other functions */
+        uint64_t hash(const Key & key) const
+        {
+            return static_cast<uint64_t>(hash_(key));
+        }
+
+
+        /*! \brief Insert a key and value, if the key is not already in the map
+         *
+         * \return True if the element was inserted
+         */
+        bool insert(const Key & key, const T & value)
+        {
+            return insert(key, hash(key), value);
+        }
+
+        bool insert(const Key & key, uint64_t hash, const T & value)
+        {
+            Shard & s = shard_(hash);
+            std::lock_guard<std::mutex> l(s.mutex);
+            return s.map.try_emplace_prehashed(hash, key, value).second;
+        }
+
+
+        /*! \brief Insert a key and value, or replace the value if the key exists
+         *
+         * \return True if the element was inserted, false if it was replaced
+         */
+        bool insert_or_assign(const Key & key, const T & value)
+        {
+            return insert_or_assign(key, hash(key), value);
+        }
+
+        bool insert_or_assign(const Key & key, uint64_t hash, const T & value)
+        {
+            Shard & s = shard_(hash);
+            std::lock_guard<std::mutex> l(s.mutex);
+            auto ret = s.map.try_emplace_prehashed(hash, key, value);
+            if(!ret.second)
+                ret.first->second = value;
+            return ret.second;
+        }
+
+
+        /*! \brief Find a key and copy its value
+         *
+         * \param [out] value The value of the element, if found
+         * \return True if the key was found
+         */
+        bool find(const Key & key, T & value) const
+        {
+            return find(key, hash(key), value);
+        }
+
+        bool find(const Key & key, uint64_t hash, T & value) const
+        {
+            const Shard & s = shard_(hash);
+            std::lock_guard<std::mutex> l(s.mutex);
+            auto it = s.map.find_prehashed(key, hash);
+            if(it == s.map.end())
+                return false;
+
+            value = it->second;
+            return true;
+        }
+
+
+        bool contains(const Key & key) const
+        {
+            return contains(key, hash(key));
+        }
+
+        bool contains(const Key & key, uint64_t hash) const
+        {
+            const Shard & s = shard_(hash);
+            std::lock_guard<std::mutex> l(s.mutex);
+            return s.map.find_prehashed(key, hash) != s.map.end();
+        }
+
+
+        /*! \brief Call a function with the value of a key, with its shard locked
+         *
+         * The function is given a reference to the value, which it may change.
+         * It must not use this map.
+         *
+         * \return True if the key was found (and the function called)
+         */
+        template<typename Func>
+        bool visit(const Key & key, Func && func)
+        {
+            return visit(key, hash(key), std::forward<Func>(func));
+        }
+
+        template<typename Func>
+        bool visit(const Key & key, uint64_t hash, Func && func)
+        {
+            Shard & s = shard_(hash);
+            std::lock_guard<std::mutex> l(s.mutex);
+            auto it = s.map.find_prehashed(key, hash);
+            if(it == s.map.end())
+                return false;
+
+            func(it->second);
+            return true;
+        }
+
+
+        /*! \brief Remove a key
+         *
+         * \return True if the key was found and removed
+         */
+        bool erase(const Key & key)
+        {
+            return erase(key, hash(key));
+        }
+
+        bool erase(const Key & key, uint64_t hash)
+        {
+            Shard & s = shard_(hash);
+            std::lock_guard<std::mutex> l(s.mutex);
+            return s.map.erase_prehashed(key, hash) != 0;
+        }
+
+
+        /*! \brief Total number of elements
+         *
+         * The shards are counted one at a time, so this may not
+         * be exact if other threads are changing the map.
+         */
+        size_t size(void) const
+        {
+            size_t n = 0;
+            for(size_t i = 0; i < nshards_; i++)
+            {
+                std::lock_guard<std::mutex> l(shards_[i].mutex);
+                n += shards_[i].map.size();
+            }
+            return n;
+        }
+
+
+        bool empty(void) const
+        {
+            return size() == 0;
+        }
+
+
+        /*! \brief Remove all elements */
+        void clear(void)
+        {
+            for(size_t i = 0; i < nshards_; i++)
+            {
+                std::lock_guard<std::mutex> l(shards_[i].mutex);
+                shards_[i].map.clear();
+            }
+        }
+
+
+        /*! \brief Call a function for every element
+         *
+         * Each shard is locked while its elements are visited. The function
+         * is given the key and a reference to the value, and must not
+         * use this map.
+         */
+        template<typename Func>
+        void for_each(Func && func)
+        {
+            for(size_t i = 0; i < nshards_; i++)
+            {
+                std::lock_guard<std::mutex> l(shards_[i].mutex);
+                for(auto & v : shards_[i].map)
+                    func(v.first, v.second);
+            }
+        }
+
+
+    private:
+        /* One shard. The padding keeps the locks of
+         * neighboring shards in different cache lines. */
+        struct Shard
+        {
+            mutable std::mutex mutex;
+            shard_map map;
+            char padding[64];
+        };
+
+        Hash hash_;
+        std::unique_ptr<Shard[]> shards_;
+        size_t nshards_;
+        size_t shift_;   // Shift that leaves the bits choosing the shard
+
+
+        // A shift by the full width is undefined, so a single shard is handled separately
+        Shard & shard_(uint64_t hash)
+        {
+            return shards_[nshards_ == 1 ? 0 : static_cast<size_t>(hash) >> shift_];
+        }
+
+        const Shard & shard_(uint64_t hash) const
+        {
+            return shards_[nshards_ == 1 ? 0 : static_cast<size_t>(hash) >> shift_];
+        }
+};
+
+} // close namespace bphash
+
@@ -0,0 +1,292 @@
+/*! \file
+ * \brief MurmurHash3 that may be computed at compile time
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bphash {
+namespace detail {
+
+/* These are the same steps as in MurmurHash3_32_x32 and MurmurHash3_128_x64,
+ * written as C++11 constexpr functions (a single return statement each,
+ * with recursion in place of loops). Blocks are read as little endian,
+ * which is what the runtime versions do on little-endian machines. */
+
+////////////////////////////////////////////
+// Common pieces
+////////////////////////////////////////////
+
+constexpr uint32_t cx_rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+
+constexpr uint64_t cx_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+
+constexpr uint32_t cx_xorshift32(uint32_t k, int s)
+{
+    return k ^ (k >> s);
+}
+
+
+constexpr uint64_t cx_xorshift64(uint64_t k, int s)
+{
+    return k ^ (k >> s);
+}
+
+
+constexpr uint32_t cx_fmix32(uint32_t k)
+{
+    return cx_xorshift32(cx_xorshift32(cx_xorshift32(k, 16) * UINT32_C(0x85ebca6b), 13)
+                         * UINT32_C(0xc2b2ae35), 16);
+}
+
+
+constexpr uint64_t cx_fmix64(uint64_t k)
+{
+    return cx_xorshift64(cx_xorshift64(cx_xorshift64(k, 33) * UINT64_C(0xff51afd7ed558ccd), 33)
+                         * UINT64_C(0xc4ceb9fe1a85ec53), 33);
+}
+
+
+/*! \brief Read \p n bytes (at most 8) as a little-endian integer */
+constexpr uint64_t cx_load_le(const char * p, size_t n)
+{
+    return n == 0 ? 0 : static_cast<uint64_t>(static_cast<uint8_t>(p[0])) | (cx_load_le(p + 1, n - 1) << 8);
+}
+
+
+
+////////////////////////////////////////////
+// MurmurHash3 x86 32-bit
+////////////////////////////////////////////
+
+constexpr uint32_t cx_mix_k32(uint32_t k)
+{
+    return cx_rotl32(k * UINT32_C(0xcc9e2d51), 15) * UINT32_C(0x1b873593);
+}
+
+
+constexpr uint32_t cx_body32(const char * p, size_t nblocks, uint32_t h)
+{
+    return nblocks == 0 ? h :
+           cx_body32(p + 4, nblocks - 1,
+                     cx_rotl32(h ^ cx_mix_k32(static_cast<uint32_t>(cx_load_le(p, 4))), 13)
+                     * 5 + UINT32_C(0xe6546b64));
+}
+
+
+constexpr uint32_t cx_tail32(uint32_t h, const char * tail, size_t ntail)
+{
+    return ntail == 0 ? h : h ^ cx_mix_k32(static_cast<uint32_t>(cx_load_le(tail, ntail)));
+}
+
+
+constexpr Digest32 cx_digest32(uint32_t h)
+{
+    return Digest32{{static_cast<uint8_t>(h),       static_cast<uint8_t>(h >> 8),
+                     static_cast<uint8_t>(h >> 16), static_cast<uint8_t>(h >> 24)}};
+}
+
+
+
+////////////////////////////////////////////
+// MurmurHash3 x64 128-bit
+////////////////////////////////////////////
+
+/*! \brief The two halves of the 128-bit state */
+struct CxState128
+{
+    uint64_t h1;
+    uint64_t h2;
+
+    constexpr CxState128(uint64_t a, uint64_t b) : h1(a), h2(b) { }
+};
+
+
+constexpr uint64_t cx_mix_k1(uint64_t k)
+{
+    return cx_rotl64(k * UINT64_C(0x87c37b91114253d5), 31) * UINT64_C(0x4cf5ad432745937f);
+}
+
+
+constexpr uint64_t cx_mix_k2(uint64_t k)
+{
+    return cx_rotl64(k * UINT64_C(0x4cf5ad432745937f), 33) * UINT64_C(0x87c37b91114253d5);
+}
+
+
+// Second half of a block, given the new h1
+constexpr CxState128 cx_block128_h2(uint64_t h1, uint64_t h2, const char * p)
+{
+    return CxState128(h1, (cx_rotl64(h2 ^ cx_mix_k2(cx_load_le(p + 8, 8)), 31) + h1) * 5
+                          + UINT64_C(0x38495ab5));
+}
+
+
+constexpr CxState128 cx_block128(CxState128 s, const char * p)
+{
+    return cx_block128_h2((cx_rotl64(s.h1 ^ cx_mix_k1(cx_load_le(p, 8)), 27) + s.h2) * 5
+                          + UINT64_C(0x52dce729), s.h2, p);
+}
+
+
+constexpr CxState128 cx_body128(const char * p, size_t nblocks, CxState128 s)
+{
+    return nblocks == 0 ? s : cx_body128(p + 16, nblocks - 1, cx_block128(s, p));
+}
+
+
+constexpr CxState128 cx_tail128(CxState128 s, const char * tail, size_t ntail)
+{
+    return CxState128(ntail == 0 ? s.h1 : s.h1 ^ cx_mix_k1(cx_load_le(tail, ntail < 8 ? ntail : 8)),
+                      ntail <= 8 ? s.h2 : s.h2 ^ cx_mix_k2(cx_load_le(tail + 8, ntail - 8)));
+}
+
+
+// The last steps, split up where h1 or h2 is reassigned
+constexpr CxState128 cx_final128_c(uint64_t h1, uint64_t h2)
+{
+    return CxState128(h1 + h2, h2 + h1 + h2);
+}
+
+
+constexpr CxState128 cx_final128_b(uint64_t h1, uint64_t h2)
+{
+    return cx_final128_c(cx_fmix64(h1), cx_fmix64(h2 + h1));
+}
+
+
+constexpr CxState128 cx_final128(CxState128 s, uint64_t len)
+{
+    return cx_final128_b((s.h1 ^ len) + (s.h2 ^ len), s.h2 ^ len);
+}
+
+
+constexpr CxState128 cx_murmurhash3_128(const char * data, size_t len)
+{
+    return cx_final128(cx_tail128(cx_body128(data, len / 16, CxState128(0, 0)),
+                                  data + (len / 16) * 16, len % 16),
+                       static_cast<uint64_t>(len));
+}
+
+
+constexpr uint8_t cx_byte(CxState128 s, size_t i)
+{
+    return static_cast<uint8_t>(i < 8 ? s.h1 >> (8*i) : s.h2 >> (8*(i-8)));
+}
+
+
+constexpr Digest128 cx_digest128(CxState128 s)
+{
+    return Digest128{{cx_byte(s, 0),  cx_byte(s, 1),  cx_byte(s, 2),  cx_byte(s, 3),
+                      cx_byte(s, 4),  cx_byte(s, 5),  cx_byte(s, 6),  cx_byte(s, 7),
+                      cx_byte(s, 8),  cx_byte(s, 9),  cx_byte(s, 10), cx_byte(s, 11),
+                      cx_byte(s, 12), cx_byte(s, 13), cx_byte(s, 14), cx_byte(s, 15)}};
+}
+
+} // close namespace detail
+
+
+
+/*! \brief MurmurHash3 x86 32-bit hash of some bytes, usable at compile time
+ *
+ * The result is the same as from HashType::Hash32_x32 given the same bytes
+ * (through detail::MurmurHash3_32_x32 or BasicHasher::update_raw), on little-endian
+ * machines. Note that this is not the same as make_hash() of a string, which
+ * also hashes the sizes of the string and its characters.
+ *
+ * When computed at compile time, the length is limited by the compiler's maximum
+ * depth of constexpr recursion (one level for each 4 bytes; usually at least 512).
+ *
+ * \param [in] data The bytes to hash
+ * \param [in] len Number of bytes
+ */
+constexpr Digest32 murmurhash3_32_x32_constexpr(const char * data, size_t len)
+{
+    return detail::cx_digest32(detail::cx_fmix32(
+               detail::cx_tail32(detail::cx_body32(data, len / 4, 0), data + (len / 4) * 4, len % 4)
+               ^ static_cast<uint32_t>(len)));
+}
+
+
+/*! \brief MurmurHash3 x64 128-bit hash of some bytes, usable at compile time
+ *
+ * The result is the same as from HashType::Hash128_x64 given the same bytes,
+ * on little-endian machines. The first 4 and 8 bytes are the
+ * Hash32_x64 and Hash64_x64 hashes.
+ *
+ * When computed at compile time, the length is limited by the compiler's maximum
+ * depth of constexpr recursion (one level for each 16 bytes).
+ *
+ * \param [in] data The bytes to hash
+ * \param [in] len Number of bytes
+ */
+constexpr Digest128 murmurhash3_128_x64_constexpr(const char * data, size_t len)
+{
+    return detail::cx_digest128(detail::cx_murmurhash3_128(data, len));
+}
+
+
+/*! \brief 64-bit hash of the characters of a string
+ *
+ * This is `convert_hash<uint64_t>()` of the Hash64_x64 hash of the characters
+ * (without the terminating null). It may be used at compile time (for example,
+ * as a case label) and at run time (for the string being switched on).
+ *
+ * \code{.cpp}
+ * switch(bphash::hash_literal(name.data(), name.size()))
+ * {
+ *     case bphash::hash_literal("add"): ...
+ *     case bphash::hash_literal("remove"): ...
+ * }
+ * \endcode
+ */
+constexpr uint64_t hash_literal(const char * str, size_t len)
+{
+    return detail::cx_murmurhash3_128(str, len).h1;
+}
+
+
+/*! \brief 64-bit hash of the characters of a string literal
+ *
+ * \copydetails hash_literal(const char *, size_t)
+ */
+template<size_t N>
+constexpr uint64_t hash_literal(const char (&str)[N])
+{
+    return hash_literal(str, N - 1);
+}
+
+
+namespace literals {
+
+/*! \brief User-defined literal for hash_literal()
+ *
+ * `"name"_bphash` is the same as `bphash::hash_literal("name")`.
+ * This is made available with `using namespace bphash::literals`.
+ */
+constexpr uint64_t operator"" _bphash(const char * str, size_t len)
+{
+    return hash_literal(str, len);
+}
+
+} // close namespace literals
+
+} // close namespace bphash
+
@@ -0,0 +1,391 @@
+/*! \file
+ * \brief Deduplicated storage of data keyed by its hash (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/ContentStore.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace bphash {
+namespace detail {
+
+////////////////////////////////
+// ContentArena
+////////////////////////////////
+
+ContentArena::ContentArena(void)
+    : current_(0), reserved_(0)
+{
+    new_block_(content_arena_block_size);
+}
+
+
+uint32_t ContentArena::new_block_(size_t size)
+{
+    Block b;
+    b.mem.reset(new uint8_t[size]);
+    b.size = size;
+    b.used = 0;
+    b.live = 0;
+    reserved_ += size;
+
+    if(!unused_.empty())
+    {
+        const uint32_t idx = unused_.back();
+        unused_.pop_back();
+        blocks_[idx] = std::move(b);
+        return idx;
+    }
+
+    blocks_.push_back(std::move(b));
+    return static_cast<uint32_t>(blocks_.size() - 1);
+}
+
+
+std::pair<uint8_t *, uint32_t> ContentArena::allocate(size_t nbytes)
+{
+    // Empty allocations take no space, so that they can't be
+    // freed after their block is released
+    if(nbytes == 0)
+    {
+        static uint8_t empty;
+        return std::make_pair(&empty, content_arena_no_block);
+    }
+
+    // Keep allocations 8-byte aligned
+    const size_t n = (nbytes + 7) & ~size_t(7);
+
+    uint32_t idx;
+    if(n > content_arena_block_size / 4)
+        idx = new_block_(n);
+    else
+    {
+        if(blocks_[current_].size - blocks_[current_].used < n)
+        {
+            // Nothing live in the current block? Start it over
+            if(blocks_[current_].live == 0)
+                blocks_[current_].used = 0;
+            else
+                current_ = new_block_(content_arena_block_size);
+        }
+        idx = current_;
+    }
+
+    Block & b = blocks_[idx];
+    uint8_t * p = b.mem.get() + b.used;
+    b.used += n;
+    b.live += n;
+    return std::make_pair(p, idx);
+}
+
+
+void ContentArena::deallocate(uint32_t block, size_t nbytes)
+{
+    if(block == content_arena_no_block)
+        return;
+
+    Block & b = blocks_[block];
+    b.live -= (nbytes + 7) & ~size_t(7);
+
+    if(b.live != 0)
+        return;
+
+    if(block == current_)
+        b.used = 0;
+    else
+    {
+        reserved_ -= b.size;
+        b.mem.reset();
+        b.size = b.used = 0;
+        unused_.push_back(block);
+    }
+}
+
+
+void ContentArena::clear(void)
+{
+    blocks_.clear();
+    unused_.clear();
+    reserved_ = 0;
+    current_ = new_block_(content_arena_block_size);
+}
+
+} // close namespace detail
+
+
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+// Initial number of buckets in the index
+static const size_t content_store_min_buckets = 16;
+
+
+// Hash some data with an implementation, which is left reset
+static Digest128 digest_(detail::HashImpl & impl, void const * data, size_t nbytes)
+{
+    Digest128 d;
+    impl.update(data, nbytes);
+    impl.finalize_into(d.data());
+    impl.reset();
+    return d;
+}
+
+
+/* Bucket where the search for a digest starts
+ *
+ * The digest is already a good hash, so some of its bits are used directly */
+static size_t home_bucket_(const Digest128 & digest, size_t nbuckets)
+{
+    return convert_hash<size_t>(digest) & (nbuckets - 1);
+}
+
+
+ContentStore::Entry * ContentStore::find_(const Digest128 & digest) const
+{
+    size_t b = home_bucket_(digest, nbuckets_);
+
+    while(true)
+    {
+        const Bucket & bucket = buckets_[b];
+        for(size_t i = 0; i < bucket.count; i++)
+        {
+            if(bucket.digests[i] == digest)
+                return const_cast<Entry *>(&entries_[bucket.entries[i]]);
+        }
+
+        if(!bucket.overflowed)
+            return nullptr;
+
+        b = (b + 1) & (nbuckets_ - 1);
+    }
+}
+
+
+void ContentStore::add_to_index_(const Digest128 & digest, uint32_t entry)
+{
+    size_t b = home_bucket_(digest, nbuckets_);
+
+    while(buckets_[b].count == Bucket::nslots)
+    {
+        buckets_[b].overflowed = 1;
+        b = (b + 1) & (nbuckets_ - 1);
+    }
+
+    Bucket & bucket = buckets_[b];
+    bucket.digests[bucket.count] = digest;
+    bucket.entries[bucket.count] = entry;
+    bucket.count++;
+}
+
+
+void ContentStore::remove_from_index_(const Digest128 & digest)
+{
+    size_t b = home_bucket_(digest, nbuckets_);
+
+    while(true)
+    {
+        Bucket & bucket = buckets_[b];
+        for(size_t i = 0; i < bucket.count; i++)
+        {
+            if(bucket.digests[i] == digest)
+            {
+                // Move the last slot into this one. The overflow flag must stay,
+                // since later buckets may hold digests that started here.
+                bucket.count--;
+                bucket.digests[i] = bucket.digests[bucket.count];
+                bucket.entries[i] = bucket.entries[bucket.count];
+                nerased_++;
+                return;
+            }
+        }
+
+        b = (b + 1) & (nbuckets_ - 1);
+    }
+}
+
+
+void ContentStore::rebuild_index_(size_t nbuckets)
+{
+    // The buckets are aligned to cache lines
+    const size_t align = sizeof(Bucket);
+    bucket_mem_.reset(new uint8_t[nbuckets * sizeof(Bucket) + align]);
+
+    uintptr_t p = reinterpret_cast<uintptr_t>(bucket_mem_.get());
+    p = (p + align - 1) & ~uintptr_t(align - 1);
+    buckets_ = reinterpret_cast<Bucket *>(p);
+    std::memset(static_cast<void *>(buckets_), 0, nbuckets * sizeof(Bucket));
+
+    nbuckets_ = nbuckets;
+    nerased_ = 0;
+
+    for(size_t i = 0; i < entries_.size(); i++)
+    {
+        if(entries_[i].refcount != 0)
+            add_to_index_(entries_[i].digest, static_cast<uint32_t>(i));
+    }
+}
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+static_assert(sizeof(Digest128) == 16, "Digests must not be padded");
+
+
+ContentStore::ContentStore(HashType type)
+    : impl_(detail::make_hash_impl(type)), buckets_(nullptr), nbuckets_(0), nerased_(0),
+      size_(0), stored_bytes_(0), dedup_bytes_(0)
+{
+    static_assert(sizeof(Bucket) == 64, "A bucket must fill one cache line");
+
+    if(impl_->hash_size() != 16)
+        throw std::invalid_argument("ContentStore requires a 128-bit hash");
+
+    rebuild_index_(content_store_min_buckets);
+}
+
+
+Digest128 ContentStore::digest(void const * data, size_t nbytes) const
+{
+    // impl_ is not used directly, so that this may be called
+    // from several threads at once
+    return digest_(*impl_->clone(), data, nbytes);
+}
+
+
+std::pair<Digest128, bool> ContentStore::insert(void const * data, size_t nbytes)
+{
+    const Digest128 d = digest_(*impl_, data, nbytes);
+    return std::make_pair(d, insert(d, data, nbytes));
+}
+
+
+bool ContentStore::insert(const Digest128 & digest, void const * data, size_t nbytes)
+{
+    Entry * e = find_(digest);
+    if(e != nullptr)
+    {
+        e->refcount++;
+        dedup_bytes_ += nbytes;
+        return false;
+    }
+
+    // Grow at 3/4 full (or clean up if many entries have been erased)
+    const size_t max_entries = nbuckets_ * Bucket::nslots * 3 / 4;
+    if(size_ + 1 > max_entries)
+        rebuild_index_(nbuckets_ * 2);
+    else if(nerased_ > max_entries / 2)
+        rebuild_index_(nbuckets_);
+
+    uint32_t idx;
+    if(!free_entries_.empty())
+    {
+        idx = free_entries_.back();
+        free_entries_.pop_back();
+    }
+    else
+    {
+        idx = static_cast<uint32_t>(entries_.size());
+        entries_.push_back(Entry());
+    }
+
+    const auto mem = arena_.allocate(nbytes);
+    if(nbytes)
+        std::memcpy(mem.first, data, nbytes);
+
+    Entry & ne = entries_[idx];
+    ne.digest = digest;
+    ne.data = mem.first;
+    ne.size = nbytes;
+    ne.refcount = 1;
+    ne.block = mem.second;
+
+    add_to_index_(digest, idx);
+    size_++;
+    stored_bytes_ += nbytes;
+    return true;
+}
+
+
+bool ContentStore::contains(const Digest128 & digest) const
+{
+    return find_(digest) != nullptr;
+}
+
+
+ContentStore::Blob ContentStore::get(const Digest128 & digest) const
+{
+    const Entry * e = find_(digest);
+    if(e == nullptr)
+        return Blob{nullptr, 0};
+    return Blob{e->data, static_cast<size_t>(e->size)};
+}
+
+
+uint32_t ContentStore::refcount(const Digest128 & digest) const
+{
+    const Entry * e = find_(digest);
+    return e ? e->refcount : 0;
+}
+
+
+bool ContentStore::acquire(const Digest128 & digest)
+{
+    Entry * e = find_(digest);
+    if(e == nullptr)
+        return false;
+
+    e->refcount++;
+    return true;
+}
+
+
+bool ContentStore::release(const Digest128 & digest)
+{
+    Entry * e = find_(digest);
+    if(e == nullptr || --e->refcount != 0)
+        return false;
+
+    arena_.deallocate(e->block, e->size);
+    stored_bytes_ -= e->size;
+    size_--;
+
+    remove_from_index_(digest);
+    free_entries_.push_back(static_cast<uint32_t>(e - entries_.data()));
+    return true;
+}
+
+
+void ContentStore::clear(void)
+{
+    entries_.clear();
+    free_entries_.clear();
+    arena_.clear();
+    size_ = 0;
+    stored_bytes_ = 0;
+    dedup_bytes_ = 0;
+    rebuild_index_(content_store_min_buckets);
+}
+
+
+size_t ContentStore::memory_usage(void) const
+{
+    return nbuckets_ * sizeof(Bucket)
+         + entries_.capacity() * sizeof(Entry)
+         + free_entries_.capacity() * sizeof(uint32_t)
+         + arena_.memory_usage();
+}
+
+
+} // close namespace bphash
+
@@ -0,0 +1,251 @@
+/*! \file
+ * \brief Deduplicated storage of data keyed by its hash (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hash.hpp"
+#include "bphash/Hasher.hpp"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace bphash {
+namespace detail {
+
+//! Size of the blocks that a ContentArena allocates from
+static const size_t content_arena_block_size = 1024*1024;
+
+//! Block given for empty allocations, which are not taken from any block
+static const uint32_t content_arena_no_block = UINT32_MAX;
+
+
+/*! \brief Allocates memory for many blobs from large blocks
+ *
+ * Each allocation is taken from the end of the current block. Memory
+ * of a freed allocation is not reused directly, but a block is released
+ * once everything allocated from it has been freed.
+ *
+ * Allocations larger than a quarter of the block size get a block
+ * of their own.
+ */
+class ContentArena
+{
+    public:
+        ContentArena(void);
+
+        ContentArena(const ContentArena &)             = delete;
+        ContentArena & operator=(const ContentArena &) = delete;
+
+
+        /*! \brief Allocate memory
+         *
+         * \param [in] nbytes Size of the allocation. May be zero, in which
+         *            case no memory is used from any block.
+         * \return A pointer to the memory (never null), and the block
+         *         it was taken from (to be given to deallocate())
+         */
+        std::pair<uint8_t *, uint32_t> allocate(size_t nbytes);
+
+
+        /*! \brief Free memory obtained from allocate() */
+        void deallocate(uint32_t block, size_t nbytes);
+
+
+        /*! \brief Release all memory */
+        void clear(void);
+
+
+        /*! \brief Total memory held by the arena (in bytes) */
+        size_t memory_usage(void) const { return reserved_; }
+
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<uint8_t[]> mem;
+            size_t size;    // Size of the memory
+            size_t used;    // Bytes handed out (from the start)
+            size_t live;    // Bytes handed out and not yet freed
+        };
+
+        std::vector<Block> blocks_;
+        std::vector<uint32_t> unused_;  // Released blocks, whose slot may be reused
+        uint32_t current_;              // Block that small allocations are taken from
+        size_t reserved_;
+
+        uint32_t new_block_(size_t size);
+};
+
+} // close namespace detail
+
+
+/*! \brief Stores data, keeping only one copy of identical data
+ *
+ * Each blob of data is identified by the 128-bit hash of its raw bytes.
+ * Inserting a blob that is already stored only increases its
+ * reference count, and release() removes a blob once no references
+ * are left.
+ *
+ * The index is a table of 64-byte buckets, each holding three digests
+ * (with linear probing between buckets). A lookup usually reads one cache
+ * line, and the digests are stored in binary rather than as strings.
+ * The data itself is copied into large blocks (see detail::ContentArena),
+ * rather than allocated separately.
+ *
+ * Identical hashes are assumed to mean identical data. The data is
+ * never compared.
+ *
+ * This class is not thread safe. Pointers to stored data remain valid
+ * until the data is removed, even as more data is inserted.
+ */
+class ContentStore
+{
+    public:
+        /*! \brief A stored blob of data */
+        struct Blob
+        {
+            const uint8_t * data;   //!< The data (null if not found)
+            size_t size;            //!< Size of the data (in bytes)
+        };
+
+
+        /*! \brief Construct an empty store
+         *
+         * \throw std::invalid_argument if \p type is not a 128-bit hash
+         *
+         * \param [in] type Hash used to identify the data
+         */
+        explicit ContentStore(HashType type = HashType::Hash128);
+
+        ContentStore(const ContentStore &)             = delete;
+        ContentStore & operator=(const ContentStore &) = delete;
+
+
+        /*! \brief Store some data, or add a reference to it if it is already stored
+         *
+         * The data is hashed, then copied only if it is new.
+         *
+         * \param [in] data The data to store
+         * \param [in] nbytes Size of the data (in bytes)
+         * \return The digest identifying the data, and true if it was not already stored
+         */
+        std::pair<Digest128, bool> insert(void const * data, size_t nbytes);
+
+
+        /*! \brief Store some data, whose digest was computed earlier
+         *
+         * The digest is not checked. It may come from a different hash
+         * than the one given on construction, as long as it is used consistently.
+         *
+         * \return True if the data was not already stored
+         */
+        bool insert(const Digest128 & digest, void const * data, size_t nbytes);
+
+
+        /*! \brief Compute the digest of some data, without storing it */
+        Digest128 digest(void const * data, size_t nbytes) const;
+
+
+        /*! \brief Is data with this digest stored? */
+        bool contains(const Digest128 & digest) const;
+
+
+        /*! \brief Obtain the data with a digest
+         *
+         * \return The data, or a blob with a null pointer if not found
+         */
+        Blob get(const Digest128 & digest) const;
+
+
+        /*! \brief Number of references to the data with a digest (zero if not found) */
+        uint32_t refcount(const Digest128 & digest) const;
+
+
+        /*! \brief Add a reference to stored data
+         *
+         * \return False if the data was not found
+         */
+        bool acquire(const Digest128 & digest);
+
+
+        /*! \brief Remove a reference to stored data
+         *
+         * When no references are left, the data is removed.
+         *
+         * \return True if the data was removed
+         */
+        bool release(const Digest128 & digest);
+
+
+        /*! \brief Remove all data */
+        void clear(void);
+
+
+        /*! \brief Number of distinct blobs stored */
+        size_t size(void) const { return size_; }
+
+        bool empty(void) const { return size_ == 0; }
+
+        /*! \brief Total size of the distinct blobs stored (in bytes) */
+        uint64_t stored_bytes(void) const { return stored_bytes_; }
+
+        /*! \brief Total size of inserted data that was already stored (in bytes) */
+        uint64_t deduplicated_bytes(void) const { return dedup_bytes_; }
+
+        /*! \brief Memory used by the index and the data (in bytes) */
+        size_t memory_usage(void) const;
+
+
+    private:
+        /* Information about a stored blob */
+        struct Entry
+        {
+            Digest128 digest;
+            uint8_t * data;
+            uint64_t size;
+            uint32_t refcount;   // Zero if the entry is unused
+            uint32_t block;      // Arena block the data is in
+        };
+
+        /* One cache line of the index */
+        struct Bucket
+        {
+            static const size_t nslots = 3;
+
+            Digest128 digests[nslots];
+            uint32_t entries[nslots];   // Index into entries_
+            uint8_t count;              // Number of slots in use
+            uint8_t overflowed;         // Has an insertion continued past this bucket?
+            uint8_t padding[2];
+        };
+
+        std::unique_ptr<detail::HashImpl> impl_;   // Always left reset
+
+        std::unique_ptr<uint8_t[]> bucket_mem_;   // Unaligned memory for the buckets
+        Bucket * buckets_;
+        size_t nbuckets_;                         // A power of two
+        size_t nerased_;                          // Entries erased since the index was built
+
+        std::vector<Entry> entries_;
+        std::vector<uint32_t> free_entries_;
+        detail::ContentArena arena_;
+
+        size_t size_;
+        uint64_t stored_bytes_;
+        uint64_t dedup_bytes_;
+
+        Entry * find_(const Digest128 & digest) const;
+        void add_to_index_(const Digest128 & digest, uint32_t entry);
+        void remove_from_index_(const Digest128 & digest);
+        void rebuild_index_(size_t nbuckets);
+};
+
+} // close namespace bphash
+
@@ -11,6 +11,8 @@
 
 #include "bphash/Hasher_fwd.hpp"
 
+#include <type_traits>
+
 namespace bphash {
 
 
@@ -26,6 +28,34 @@ struct is_hashable;
 
 
 
+/*! \brief Trait class that determines if a type can be hashed via its raw bytes
+ *
+ * If true, arrays of this type (including std::vector, std::array, and
+ * wrapped pointers) are hashed as a single block of memory, rather than element
+ * by element. Objects of this type that do not have their own hashing function
+ * are hashed via their raw bytes as well.
+ *
+ * This is true for fundamental and enum types, and for some STL types
+ * made up of only these (such as std::pair and std::complex) when they do not
+ * contain any padding. It can be specialized to be true for other types,
+ * such as simple structures of fundamental types. Such types must not contain padding
+ * or pointers, and objects that compare equal must have identical bytes.
+ *
+ * \code{.cpp}
+ * namespace bphash {
+ * template<> struct is_contiguously_hashable<MyStruct> : public std::true_type { };
+ * }
+ * \endcode
+ */
+template<typename T>
+struct is_contiguously_hashable
+{
+    static constexpr bool value = std::is_fundamental<T>::value ||
+                                  std::is_enum<T>::value;
+};
+
+
+
 
 namespace detail {
 
@@ -87,6 +117,18 @@ struct detect_pointer_wrapper<PointerWrapper<T>>
 };
 
 
+/*! \brief Detects if a type is a CachedHash class (and contains a hashable type) */
+template<typename T>
+struct detect_cached_hash : public std::false_type { };
+
+
+template<typename T>
+struct detect_cached_hash<CachedHash<T>>
+{
+    static const bool value = is_hashable<T>::value;
+};
+
+
 } // close namespace detail
 
 
@@ -97,9 +139,11 @@ struct is_hashable<T>
 
     static constexpr bool value = std::is_fundamental<T>::value ||
                                   detail::detect_pointer_wrapper<my_type>::value ||
+                                  detail::detect_cached_hash<my_type>::value ||
                                   detail::detect_hash_member<my_type>::value ||
                                   detail::detect_hash_free_function<my_type>::value ||
-                                  std::is_enum<my_type>::value;
+                                  std::is_enum<my_type>::value ||
+                                  is_contiguously_hashable<my_type>::value;
 };
 
 
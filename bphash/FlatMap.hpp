@@ -0,0 +1,887 @@
+/*! \file
+ * \brief An open-addressing hash map using bphash hashes
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/StdHash.hpp"
+#include "bphash/CPUFeatures.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifdef BPHASH_HAVE_X86_64
+#include <emmintrin.h>
+#endif
+
+namespace bphash {
+namespace detail {
+
+////////////////////////////////////////////
+// Control bytes and groups of them
+////////////////////////////////////////////
+
+//! Control byte of a slot that has never held an element
+static const int8_t flat_ctrl_empty = -128;
+
+//! Control byte of a slot whose element was erased
+static const int8_t flat_ctrl_deleted = -2;
+
+// Control bytes of slots holding an element are the
+// lowest 7 bits of the element's hash (0 to 127)
+
+
+/*! \brief Index of the lowest set bit (mask must not be zero) */
+inline unsigned flat_lowest_bit(uint32_t mask)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned i = 0;
+    while(!(mask & 1u))
+    {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+
+/*! \brief Hint that memory will be read soon */
+inline void flat_prefetch(const void * p)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+
+/*! \brief A group of control bytes, which are checked together
+ *
+ * Each function returns a bit mask, where bit `i` is set if
+ * control byte `i` of the group matches.
+ */
+class FlatGroup
+{
+    public:
+        //! Number of control bytes in a group
+        static const size_t width = 16;
+
+#ifdef BPHASH_HAVE_X86_64
+        explicit FlatGroup(const int8_t * ctrl)
+            : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl)))
+        { }
+
+        uint32_t match(int8_t h2) const
+        {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+        }
+
+        uint32_t match_empty(void) const
+        {
+            return match(flat_ctrl_empty);
+        }
+
+        // Empty and deleted are the only values less than -1
+        uint32_t match_available(void) const
+        {
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl_)));
+        }
+
+    private:
+        __m128i ctrl_;
+#else
+        explicit FlatGroup(const int8_t * ctrl)
+        {
+            std::memcpy(ctrl_, ctrl, width);
+        }
+
+        uint32_t match(int8_t h2) const
+        {
+            uint32_t mask = 0;
+            for(size_t i = 0; i < width; i++)
+                mask |= static_cast<uint32_t>(ctrl_[i] == h2) << i;
+            return mask;
+        }
+
+        uint32_t match_empty(void) const
+        {
+            return match(flat_ctrl_empty);
+        }
+
+        uint32_t match_available(void) const
+        {
+            uint32_t mask = 0;
+            for(size_t i = 0; i < width; i++)
+                mask |= static_cast<uint32_t>(ctrl_[i] < -1) << i;
+            return mask;
+        }
+
+    private:
+        int8_t ctrl_[width];
+#endif
+};
+
+
+/*! \brief Storage for the hashes of each slot (if they are stored) */
+template<bool Store>
+class FlatDigests
+{
+    public:
+        void allocate(size_t n) { digests_.reset(new uint64_t[n]); }
+        void set(size_t i, uint64_t hash) { digests_[i] = hash; }
+        bool may_match(size_t i, uint64_t hash) const { return digests_[i] == hash; }
+
+        template<typename Func>
+        uint64_t get(size_t i, Func) const { return digests_[i]; }
+
+    private:
+        std::unique_ptr<uint64_t[]> digests_;
+};
+
+
+template<>
+class FlatDigests<false>
+{
+    public:
+        void allocate(size_t) { }
+        void set(size_t, uint64_t) { }
+        bool may_match(size_t, uint64_t) const { return true; }
+
+        // The hash must be computed again
+        template<typename Func>
+        uint64_t get(size_t, Func rehash) const { return rehash(); }
+};
+
+} // close namespace detail
+
+
+/*! \brief A hash map that stores its elements in a flat array
+ *
+ * This is an open-addressing ("Swiss table") map. Each slot has a one-byte
+ * control value, holding 7 bits of the hash of its key (or marking the
+ * slot as empty or deleted). Lookups compare a group of 16 control bytes at once
+ * (with SSE2 where available), and only compare keys for slots whose 7 bits
+ * match. The remaining bits of the hash choose where the search starts.
+ *
+ * Compared to `std::unordered_map`, there is no memory allocation per element,
+ * and a lookup usually touches only one cache line of control bytes
+ * and one element.
+ *
+ * By default, keys are hashed with StdHash, which does not construct
+ * a Hasher (or allocate memory) for each lookup.
+ *
+ * If \p StoreDigests is true, the full hash of each key is stored with its
+ * element (8 bytes per slot). The map then does not need to hash the keys again
+ * when it grows, and most comparisons of keys that don't match are avoided.
+ * This is worthwhile when keys are expensive to hash or compare (such as long strings).
+ *
+ * As with other open-addressing maps, inserting may move elements
+ * and invalidate all iterators, pointers, and references. Erasing
+ * only invalidates those to the erased element.
+ *
+ * \tparam Key Type of the keys
+ * \tparam T Type of the mapped values
+ * \tparam Hash Function object giving the hash of a key (as `size_t`)
+ * \tparam KeyEqual Function object comparing keys
+ * \tparam StoreDigests Store the hash of each key
+ */
+template<typename Key, typename T,
+         typename Hash = StdHash<Key>,
+         typename KeyEqual = std::equal_to<Key>,
+         bool StoreDigests = false>
+class flat_map
+{
+    public:
+        typedef Key key_type;
+        typedef T mapped_type;
+        typedef std::pair<const Key, T> value_type;
+        typedef size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Hash hasher;
+        typedef KeyEqual key_equal;
+        typedef value_type & reference;
+        typedef const value_type & const_reference;
+
+
+        /*! \brief Iterator over the elements of a flat_map */
+        template<bool Const>
+        class basic_iterator
+        {
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef typename flat_map::value_type value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef typename std::conditional<Const, const value_type *, value_type *>::type pointer;
+                typedef typename std::conditional<Const, const value_type &, value_type &>::type reference;
+
+                basic_iterator(void) : map_(nullptr), idx_(0) { }
+
+                // A non-const iterator converts to a const one
+                template<bool C, typename = typename std::enable_if<Const && !C>::type>
+                basic_iterator(const basic_iterator<C> & rhs)
+                    : map_(rhs.map_), idx_(rhs.idx_)
+                { }
+
+                reference operator*(void) const { return map_->slots_[idx_].value; }
+                pointer operator->(void) const { return &map_->slots_[idx_].value; }
+
+                basic_iterator & operator++(void)
+                {
+                    idx_ = map_->next_full_(idx_ + 1);
+                    return *this;
+                }
+
+                basic_iterator operator++(int)
+                {
+                    basic_iterator ret(*this);
+                    ++(*this);
+                    return ret;
+                }
+
+                bool operator==(const basic_iterator & rhs) const { return idx_ == rhs.idx_; }
+                bool operator!=(const basic_iterator & rhs) const { return idx_ != rhs.idx_; }
+
+            private:
+                friend class flat_map;
+                template<bool C> friend class basic_iterator;
+
+                typedef typename std::conditional<Const, const flat_map *, flat_map *>::type map_pointer;
+
+                basic_iterator(map_pointer map, size_t idx) : map_(map), idx_(idx) { }
+
+                map_pointer map_;
+                size_t idx_;
+        };
+
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+
+        /*! \brief Construct an empty map
+         *
+         * No memory is allocated until the first element is inserted
+         */
+        flat_map(void)
+            : ctrl_(nullptr), slots_(nullptr), capacity_(0), size_(0), growth_left_(0)
+        { }
+
+
+        /*! \brief Construct an empty map with room for at least \p n elements */
+        explicit flat_map(size_t n, const Hash & hash = Hash(), const KeyEqual & equal = KeyEqual())
+            : hash_(hash), equal_(equal),
+              ctrl_(nullptr), slots_(nullptr), capacity_(0), size_(0), growth_left_(0)
+        {
+            reserve(n);
+        }
+
+
+        /*! \brief Construct a map from a list of elements */
+        flat_map(std::initializer_list<value_type> init)
+            : flat_map(init.size())
+        {
+            for(const auto & v : init)
+                insert(v);
+        }
+
+
+        flat_map(const flat_map & rhs)
+            : hash_(rhs.hash_), equal_(rhs.equal_),
+              ctrl_(nullptr), slots_(nullptr), capacity_(0), size_(0), growth_left_(0)
+        {
+            reserve(rhs.size_);
+            for(const auto & v : rhs)
+                insert(v);
+        }
+
+
+        flat_map(flat_map && rhs)
+            : flat_map()
+        {
+            swap(rhs);
+        }
+
+
+        flat_map & operator=(const flat_map & rhs)
+        {
+            if(this != &rhs)
+            {
+                flat_map tmp(rhs);
+                swap(tmp);
+            }
+            return *this;
+        }
+
+
+        flat_map & operator=(flat_map && rhs)
+        {
+            flat_map tmp(std::move(rhs));
+            swap(tmp);
+            return *this;
+        }
+
+
+        ~flat_map(void)
+        {
+            destroy_();
+        }
+
+
+        void swap(flat_map & rhs)
+        {
+            using std::swap;
+            swap(hash_, rhs.hash_);
+            swap(equal_, rhs.equal_);
+            swap(ctrl_, rhs.ctrl_);
+            swap(slots_, rhs.slots_);
+            swap(digests_, rhs.digests_);
+            swap(capacity_, rhs.capacity_);
+            swap(size_, rhs.size_);
+            swap(growth_left_, rhs.growth_left_);
+        }
+
+
+        ////////////////////////////////
+        // Capacity
+        ////////////////////////////////
+
+        size_t size(void) const { return size_; }
+
+        bool empty(void) const { return size_ == 0; }
+
+        /*! \brief Number of slots (elements are stored in up to 7/8 of them) */
+        size_t capacity(void) const { return capacity_; }
+
+        float load_factor(void) const
+        {
+            return capacity_ ? static_cast<float>(size_) / static_cast<float>(capacity_) : 0.0f;
+        }
+
+        /*! \brief The map grows when more than this fraction of the slots are used */
+        float max_load_factor(void) const { return 0.875f; }
+
+        hasher hash_function(void) const { return hash_; }
+        key_equal key_eq(void) const { return equal_; }
+
+
+        /*! \brief Make room for at least \p n elements without growing */
+        void reserve(size_t n)
+        {
+            if(n > size_ + growth_left_)
+                rehash_(capacity_for_(n));
+        }
+
+
+        /*! \brief Remove all elements, keeping the memory */
+        void clear(void)
+        {
+            if(capacity_ == 0)
+                return;
+
+            destroy_elements_();
+            std::memset(ctrl_, detail::flat_ctrl_empty, capacity_ + detail::FlatGroup::width);
+            size_ = 0;
+            growth_left_ = max_size_for_(capacity_);
+        }
+
+
+        ////////////////////////////////
+        // Iteration
+        ////////////////////////////////
+
+        iterator begin(void) { return iterator(this, next_full_(0)); }
+        iterator end(void) { return iterator(this, capacity_); }
+        const_iterator begin(void) const { return const_iterator(this, next_full_(0)); }
+        const_iterator end(void) const { return const_iterator(this, capacity_); }
+        const_iterator cbegin(void) const { return begin(); }
+        const_iterator cend(void) const { return end(); }
+
+
+        ////////////////////////////////
+        // Lookup
+        ////////////////////////////////
+
+        iterator find(const Key & key)
+        {
+            return iterator(this, find_(key, hash_key_(key)));
+        }
+
+        const_iterator find(const Key & key) const
+        {
+            return const_iterator(this, find_(key, hash_key_(key)));
+        }
+
+        /*! \brief Find a key, using a hash of it computed earlier
+         *
+         * This allows the key to be hashed once, for example before taking
+         * a lock that protects the map. \p hash must be the result of
+         * the function returned by hash_function() for \p key.
+         */
+        iterator find_prehashed(const Key & key, uint64_t hash)
+        {
+            return iterator(this, find_(key, hash));
+        }
+
+        const_iterator find_prehashed(const Key & key, uint64_t hash) const
+        {
+            return const_iterator(this, find_(key, hash));
+        }
+
+        size_t count(const Key & key) const
+        {
+            return find(key) == end() ? 0 : 1;
+        }
+
+        bool contains(const Key & key) const
+        {
+            return find(key) != end();
+        }
+
+        T & at(const Key & key)
+        {
+            iterator it = find(key);
+            if(it == end())
+                throw std::out_of_range("Key not found in flat_map");
+            return it->second;
+        }
+
+        const T & at(const Key & key) const
+        {
+            const_iterator it = find(key);
+            if(it == end())
+                throw std::out_of_range("Key not found in flat_map");
+            return it->second;
+        }
+
+        T & operator[](const Key & key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        T & operator[](Key && key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+
+        /*! \brief Find many keys at once
+         *
+         * The keys are hashed in blocks, and the memory for each key in the
+         * block is prefetched before any of them are searched for. This
+         * hides much of the latency of the cache misses when the map is large.
+         *
+         * \param [in] keys The keys to look for
+         * \param [in] nkeys Number of keys
+         * \param [out] results For each key, an iterator to its element (or end()).
+         *                      Must have room for \p nkeys iterators.
+         */
+        void find_batch(const Key * keys, size_t nkeys, iterator * results)
+        {
+            find_batch_(this, keys, nkeys, results);
+        }
+
+        void find_batch(const Key * keys, size_t nkeys, const_iterator * results) const
+        {
+            find_batch_(this, keys, nkeys, results);
+        }
+
+
+        ////////////////////////////////
+        // Modifiers
+        ////////////////////////////////
+
+        /*! \brief Insert an element with a key, if the key is not already in the map
+         *
+         * The mapped value is constructed from \p args only if it is inserted.
+         *
+         * \return An iterator to the element with this key, and whether it was inserted
+         */
+        template<typename K, typename... Args>
+        std::pair<iterator, bool> try_emplace(K && key, Args &&... args)
+        {
+            const uint64_t hash = hash_key_(key);
+            return try_emplace_prehashed(hash, std::forward<K>(key), std::forward<Args>(args)...);
+        }
+
+
+        /*! \brief Insert an element, using a hash of the key computed earlier
+         *
+         * \p hash must be the value returned by the hash function of this map
+         * for \p key (see find_prehashed).
+         */
+        template<typename K, typename... Args>
+        std::pair<iterator, bool> try_emplace_prehashed(uint64_t hash, K && key, Args &&... args)
+        {
+            size_t idx = find_(key, hash);
+            if(idx != capacity_)
+                return std::make_pair(iterator(this, idx), false);
+
+            // The slot is only marked as used once the element is constructed,
+            // so the map is unchanged if a constructor throws
+            idx = prepare_insert_(hash);
+            new(&slots_[idx].value) value_type(std::piecewise_construct,
+                                              std::forward_as_tuple(std::forward<K>(key)),
+                                              std::forward_as_tuple(std::forward<Args>(args)...));
+            commit_insert_(idx, hash);
+            return std::make_pair(iterator(this, idx), true);
+        }
+
+
+        std::pair<iterator, bool> insert(const value_type & value)
+        {
+            return try_emplace(value.first, value.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type && value)
+        {
+            return try_emplace(std::move(const_cast<Key &>(value.first)), std::move(value.second));
+        }
+
+        template<typename K, typename V>
+        std::pair<iterator, bool> emplace(K && key, V && value)
+        {
+            return try_emplace(std::forward<K>(key), std::forward<V>(value));
+        }
+
+
+        /*! \brief Insert or replace the value of a key */
+        template<typename K, typename V>
+        std::pair<iterator, bool> insert_or_assign(K && key, V && value)
+        {
+            auto ret = try_emplace(std::forward<K>(key), std::forward<V>(value));
+            if(!ret.second)
+                ret.first->second = std::forward<V>(value);
+            return ret;
+        }
+
+
+        /*! \brief Remove the element with a key
+         *
+         * \return The number of elements removed (0 or 1)
+         */
+        size_t erase(const Key & key)
+        {
+            return erase_prehashed(key, hash_key_(key));
+        }
+
+
+        /*! \brief Remove the element with a key, using a hash computed earlier */
+        size_t erase_prehashed(const Key & key, uint64_t hash)
+        {
+            const size_t idx = find_(key, hash);
+            if(idx == capacity_)
+                return 0;
+
+            erase_at_(idx);
+            return 1;
+        }
+
+
+        /*! \brief Remove an element
+         *
+         * \return An iterator to the next element
+         */
+        iterator erase(const_iterator pos)
+        {
+            erase_at_(pos.idx_);
+            return iterator(this, next_full_(pos.idx_ + 1));
+        }
+
+        iterator erase(iterator pos)
+        {
+            return erase(const_iterator(pos));
+        }
+
+
+    private:
+        /* Storage for one element, which is constructed and destroyed explicitly */
+        union Slot
+        {
+            value_type value;
+            Slot(void) { }
+            ~Slot(void) { }
+        };
+
+        static const size_t width = detail::FlatGroup::width;
+
+        Hash hash_;
+        KeyEqual equal_;
+
+        int8_t * ctrl_;         // capacity_ control bytes, then a copy of the first group
+        Slot * slots_;
+        detail::FlatDigests<StoreDigests> digests_;
+
+        size_t capacity_;       // Number of slots (0 or a power of two, at least the group width)
+        size_t size_;           // Number of elements
+        size_t growth_left_;    // Elements that can be inserted before growing
+
+
+        /* Maximum number of elements for a number of slots */
+        static size_t max_size_for_(size_t capacity)
+        {
+            return capacity - capacity / 8;
+        }
+
+
+        static size_t capacity_for_(size_t n)
+        {
+            size_t cap = width;
+            while(max_size_for_(cap) < n)
+                cap *= 2;
+            return cap;
+        }
+
+
+        template<typename K>
+        uint64_t hash_key_(const K & key) const
+        {
+            return static_cast<uint64_t>(hash_(key));
+        }
+
+
+        // The top bits choose where to start, the lowest 7 are stored in the control byte
+        static size_t h1_(uint64_t hash) { return static_cast<size_t>(hash >> 7); }
+        static int8_t h2_(uint64_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+
+        /* Set a control byte, along with its copy after the end */
+        void set_ctrl_(size_t idx, int8_t c)
+        {
+            ctrl_[idx] = c;
+            if(idx < width)
+                ctrl_[capacity_ + idx] = c;
+        }
+
+
+        /* Index of the first full slot at or after idx (or capacity_) */
+        size_t next_full_(size_t idx) const
+        {
+            while(idx < capacity_ && ctrl_[idx] < 0)
+                idx++;
+            return idx;
+        }
+
+
+        /* Index of the slot with this key (or capacity_ if not found)
+         *
+         * Groups are probed in a triangular sequence, which visits
+         * every group when the capacity is a power of two. */
+        template<typename K>
+        size_t find_(const K & key, uint64_t hash) const
+        {
+            if(capacity_ == 0)
+                return 0;
+
+            const size_t mask = capacity_ - 1;
+            const int8_t h2 = h2_(hash);
+            size_t pos = h1_(hash) & mask;
+            size_t step = 0;
+
+            while(true)
+            {
+                detail::FlatGroup g(ctrl_ + pos);
+
+                for(uint32_t m = g.match(h2); m != 0; m &= m - 1)
+                {
+                    const size_t idx = (pos + detail::flat_lowest_bit(m)) & mask;
+                    if(digests_.may_match(idx, hash) && equal_(slots_[idx].value.first, key))
+                        return idx;
+                }
+
+                if(g.match_empty())
+                    return capacity_;
+
+                step += width;
+                pos = (pos + step) & mask;
+            }
+        }
+
+
+        /* Index of the first empty or deleted slot for a hash
+         * (the table must have at least one) */
+        size_t find_available_(uint64_t hash) const
+        {
+            const size_t mask = capacity_ - 1;
+            size_t pos = h1_(hash) & mask;
+            size_t step = 0;
+
+            while(true)
+            {
+                detail::FlatGroup g(ctrl_ + pos);
+                const uint32_t m = g.match_available();
+                if(m != 0)
+                    return (pos + detail::flat_lowest_bit(m)) & mask;
+
+                step += width;
+                pos = (pos + step) & mask;
+            }
+        }
+
+
+        /* Find a slot for a new element with this hash, growing if needed.
+         * The caller constructs the element in the slot, then calls commit_insert_ */
+        size_t prepare_insert_(uint64_t hash)
+        {
+            size_t idx = capacity_ ? find_available_(hash) : 0;
+
+            // Reusing a deleted slot doesn't use up any growth
+            if(capacity_ == 0)
+            {
+                rehash_(capacity_for_(1));
+                idx = find_available_(hash);
+            }
+            else if(growth_left_ == 0 && ctrl_[idx] != detail::flat_ctrl_deleted)
+            {
+                // If many of the used slots are deleted, clean them up
+                // without growing. Otherwise, double the capacity.
+                if(size_ * 32 <= capacity_ * 25)
+                    rehash_(capacity_);
+                else
+                    rehash_(capacity_ * 2);
+                idx = find_available_(hash);
+            }
+
+            return idx;
+        }
+
+
+        /* Mark a slot found by prepare_insert_ as holding a new element */
+        void commit_insert_(size_t idx, uint64_t hash)
+        {
+            if(ctrl_[idx] == detail::flat_ctrl_empty)
+                growth_left_--;
+
+            set_ctrl_(idx, h2_(hash));
+            digests_.set(idx, hash);
+            size_++;
+        }
+
+
+        void erase_at_(size_t idx)
+        {
+            slots_[idx].value.~value_type();
+            set_ctrl_(idx, detail::flat_ctrl_deleted);
+            size_--;
+        }
+
+
+        /* Move all elements to a new table with the given number of slots */
+        void rehash_(size_t new_capacity)
+        {
+            int8_t * old_ctrl = ctrl_;
+            Slot * old_slots = slots_;
+            detail::FlatDigests<StoreDigests> old_digests(std::move(digests_));
+            const size_t old_capacity = capacity_;
+
+            ctrl_ = new int8_t[new_capacity + width];
+            std::memset(ctrl_, detail::flat_ctrl_empty, new_capacity + width);
+            slots_ = static_cast<Slot *>(::operator new(new_capacity * sizeof(Slot)));
+            digests_.allocate(new_capacity);
+            capacity_ = new_capacity;
+            growth_left_ = max_size_for_(new_capacity) - size_;
+
+            for(size_t i = 0; i < old_capacity; i++)
+            {
+                if(old_ctrl[i] < 0)
+                    continue;
+
+                value_type & v = old_slots[i].value;
+                const uint64_t hash = old_digests.get(i, [&]{ return hash_key_(v.first); });
+
+                const size_t idx = find_available_(hash);
+                set_ctrl_(idx, h2_(hash));
+                digests_.set(idx, hash);
+
+                // The old element is destroyed right away, so its key may be moved from
+                new(&slots_[idx].value) value_type(std::move(const_cast<Key &>(v.first)), std::move(v.second));
+                v.~value_type();
+            }
+
+            delete [] old_ctrl;
+            ::operator delete(old_slots);
+        }
+
+
+        template<typename Map, typename It>
+        static void find_batch_(Map * map, const Key * keys, size_t nkeys, It * results)
+        {
+            // Number of keys that are hashed and prefetched together
+            const size_t block = 16;
+            uint64_t hashes[block];
+
+            if(map->capacity_ == 0)
+            {
+                std::fill(results, results + nkeys, map->end());
+                return;
+            }
+
+            const size_t mask = map->capacity_ - 1;
+
+            for(size_t start = 0; start < nkeys; start += block)
+            {
+                const size_t n = std::min(block, nkeys - start);
+
+                for(size_t i = 0; i < n; i++)
+                {
+                    hashes[i] = map->hash_key_(keys[start + i]);
+                    const size_t pos = h1_(hashes[i]) & mask;
+                    detail::flat_prefetch(map->ctrl_ + pos);
+                    detail::flat_prefetch(map->slots_ + pos);
+                }
+
+                for(size_t i = 0; i < n; i++)
+                    results[start + i] = It(map, map->find_(keys[start + i], hashes[i]));
+            }
+        }
+
+
+        void destroy_elements_(void)
+        {
+            for(size_t i = 0; i < capacity_; i++)
+            {
+                if(ctrl_[i] >= 0)
+                    slots_[i].value.~value_type();
+            }
+        }
+
+
+        void destroy_(void)
+        {
+            if(capacity_ == 0)
+                return;
+
+            destroy_elements_();
+            delete [] ctrl_;
+            ::operator delete(slots_);
+        }
+};
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual, bool StoreDigests>
+void swap(flat_map<Key, T, Hash, KeyEqual, StoreDigests> & lhs,
+          flat_map<Key, T, Hash, KeyEqual, StoreDigests> & rhs)
+{
+    lhs.swap(rhs);
+}
+
+
+} // close namespace bphash
+
@@ -16,19 +16,10 @@ namespace bphash {
 
 std::string hash_to_string(const HashValue & hash)
 {
-    std::string hashstr;
-
-    char buf[3] = { '\0', '\0', '\0' };
-
-    for(uint8_t v : hash)
-    {
-        snprintf(buf, 3, "%02x", v); // max size is 2 + null
-        hashstr += buf;
-    }
-
-    return hashstr;
+    return detail::bytes_to_string(hash.data(), hash.size());
 }
 
+
 HashValue truncate_hash(const HashValue & hash, size_t nbytes)
 {
     /*
@@ -44,5 +35,25 @@ HashValue truncate_hash(const HashValue & hash, size_t nbytes)
 }
 
 
+namespace detail {
+
+std::string bytes_to_string(const uint8_t * data, size_t nbytes)
+{
+    std::string hashstr;
+
+    char buf[3] = { '\0', '\0', '\0' };
+
+    for(size_t i = 0; i < nbytes; i++)
+    {
+        snprintf(buf, 3, "%02x", data[i]); // max size is 2 + null
+        hashstr += buf;
+    }
+
+    return hashstr;
+}
+
+} // close namespace detail
+
+
 } // close namespace bphash
 
@@ -10,8 +10,12 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
 
 namespace bphash {
 
@@ -52,17 +56,15 @@ T convert_hash(const HashValue & hash)
     static_assert(std::is_integral<T>::value,
                   "Type to convert to must be an integral type");
 
-    const size_t wantedbytes = sizeof(T);
-
-    // will may pad with zero if needed
-    HashValue tmphash = truncate_hash(hash, wantedbytes);
+    // will pad with zero if needed
+    const size_t nbytes = std::min(sizeof(T), hash.size());
 
     T ret = static_cast<T>(0);
 
     // i = number of bytes, so i*8 is
     //     the number of bits to shift
-    for(size_t i = 0; i < wantedbytes; i++)
-        ret |= static_cast<T>(tmphash[i]) << (i*8);
+    for(size_t i = 0; i < nbytes; i++)
+        ret |= static_cast<T>(hash[i]) << (i*8);
 
     return ret;
 }
@@ -80,5 +82,202 @@ T convert_hash(const HashValue & hash)
 std::string hash_to_string(const HashValue & hash);
 
 
+
+/*! \brief Stores the value of a hash with a size fixed at compile time
+ *
+ * Unlike HashValue, this does not allocate any memory and is trivially
+ * copyable, so it is better suited for storing large numbers of hashes.
+ * Comparisons give the same ordering as comparing the equivalent HashValue.
+ *
+ * \tparam N Size of the hash (in bytes)
+ */
+template<size_t N>
+struct Digest
+{
+    uint8_t bytes[N];  //!< The raw bytes of the hash
+
+
+    /*! \brief Size of the hash (in bytes) */
+    static constexpr size_t size(void) { return N; }
+
+    /*! \brief Pointer to the raw bytes of the hash */
+    uint8_t * data(void) { return bytes; }
+
+    /*! \brief Pointer to the raw bytes of the hash */
+    const uint8_t * data(void) const { return bytes; }
+
+    /*! \brief Iterator to the first byte of the hash */
+    const uint8_t * begin(void) const { return bytes; }
+
+    /*! \brief Iterator past the last byte of the hash */
+    const uint8_t * end(void) const { return bytes + N; }
+};
+
+
+typedef Digest<4>  Digest32;   //!< A 32-bit hash
+typedef Digest<8>  Digest64;   //!< A 64-bit hash
+typedef Digest<16> Digest128;  //!< A 128-bit hash
+
+
+template<size_t N>
+bool operator==(const Digest<N> & lhs, const Digest<N> & rhs)
+{
+    return std::memcmp(lhs.bytes, rhs.bytes, N) == 0;
+}
+
+template<size_t N>
+bool operator!=(const Digest<N> & lhs, const Digest<N> & rhs)
+{
+    return !(lhs == rhs);
+}
+
+template<size_t N>
+bool operator<(const Digest<N> & lhs, const Digest<N> & rhs)
+{
+    return std::memcmp(lhs.bytes, rhs.bytes, N) < 0;
+}
+
+template<size_t N>
+bool operator>(const Digest<N> & lhs, const Digest<N> & rhs)
+{
+    return rhs < lhs;
+}
+
+template<size_t N>
+bool operator<=(const Digest<N> & lhs, const Digest<N> & rhs)
+{
+    return !(rhs < lhs);
+}
+
+template<size_t N>
+bool operator>=(const Digest<N> & lhs, const Digest<N> & rhs)
+{
+    return !(lhs < rhs);
+}
+
+
+/*! \brief Convert a HashValue to a fixed-size digest
+ *
+ * If the desired size is larger than the size of the given hash,
+ * the digest is padded with zeroes. Otherwise, it is truncated.
+ *
+ * \tparam N Size of the digest (in bytes)
+ *
+ * \param [in] hash The hash to convert
+ * \return The hash as a fixed-size digest
+ */
+template<size_t N>
+Digest<N> to_digest(const HashValue & hash)
+{
+    Digest<N> ret;
+    const size_t nbytes = std::min(N, hash.size());
+    std::copy(hash.begin(), hash.begin() + nbytes, ret.bytes);
+    std::fill(ret.bytes + nbytes, ret.bytes + N, 0);
+    return ret;
+}
+
+
+/*! \brief Convert a fixed-size digest to a HashValue
+ *
+ * \param [in] digest The digest to convert
+ * \return The digest as a HashValue
+ */
+template<size_t N>
+HashValue to_hash_value(const Digest<N> & digest)
+{
+    return HashValue(digest.begin(), digest.end());
+}
+
+
+/*! \brief Truncate a digest to a given number of bytes
+ *
+ * If the desired size is larger than the size of the given digest,
+ * the new digest is padded with zeroes.
+ *
+ * \tparam M Desired size of the new digest (in bytes)
+ *
+ * \param [in] digest The digest to truncate
+ * \return A new, truncated digest
+ */
+template<size_t M, size_t N>
+Digest<M> truncate_hash(const Digest<N> & digest)
+{
+    Digest<M> ret;
+    const size_t nbytes = std::min(M, N);
+    std::copy(digest.bytes, digest.bytes + nbytes, ret.bytes);
+    std::fill(ret.bytes + nbytes, ret.bytes + M, 0);
+    return ret;
+}
+
+
+/*! \brief Convert a digest to a given integral type
+ *
+ * If the type is larger than the size of the digest, it is padded
+ * with zeros. Otherwise, the digest is truncated. The result is the
+ * same as for the equivalent HashValue.
+ *
+ * \tparam The type to convert to. Must be an integral type.
+ *
+ * \param [in] digest The digest to convert
+ * \return The digest converted to an integral type
+ */
+template<typename T, size_t N>
+T convert_hash(const Digest<N> & digest)
+{
+    static_assert(std::is_integral<T>::value,
+                  "Type to convert to must be an integral type");
+
+    const size_t nbytes = (sizeof(T) < N ? sizeof(T) : N);
+
+    T ret = static_cast<T>(0);
+
+    for(size_t i = 0; i < nbytes; i++)
+        ret |= static_cast<T>(digest.bytes[i]) << (i*8);
+
+    return ret;
+}
+
+
+namespace detail {
+
+/*! \brief Return a hex string representation of some raw bytes */
+std::string bytes_to_string(const uint8_t * data, size_t nbytes);
+
+} // close namespace detail
+
+
+/*! \brief Return a string representation of a digest
+ *
+ * The result is the same as for the equivalent HashValue
+ *
+ * \param [in] digest The digest to convert
+ * \return A string representing the digest
+ */
+template<size_t N>
+std::string hash_to_string(const Digest<N> & digest)
+{
+    return detail::bytes_to_string(digest.data(), N);
+}
+
+
 } // close namespace bphash
 
+
+
+namespace std {
+
+/*! \brief Allows for digests to be used in unordered containers
+ *
+ * The digest is already a hash, so this just uses the first bytes
+ */
+template<size_t N>
+struct hash<bphash::Digest<N>>
+{
+    size_t operator()(const bphash::Digest<N> & digest) const
+    {
+        return bphash::convert_hash<size_t>(digest);
+    }
+};
+
+} // close namespace std
+
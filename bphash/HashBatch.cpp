@@ -0,0 +1,341 @@
+/*! \file
+ * \brief Hashing of many independent keys at once (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/HashBatch.hpp"
+#include "bphash/MurmurHash3_128_x64.hpp"
+#include "bphash/MurmurHash3_32_x32.hpp"
+#include "bphash/TreeHash.hpp"
+#include "bphash/XXH3_64.hpp"
+#include "bphash/XXH3_128.hpp"
+#include "bphash/CRC32C.hpp"
+#include "bphash/CPUFeatures.hpp"
+
+#include <limits>
+
+#ifdef BPHASH_HAVE_X86_64
+#include <immintrin.h>
+#endif
+
+namespace bphash {
+namespace detail {
+
+////////////////////////////////
+// Helper functions
+////////////////////////////////
+
+//! Number of keys hashed at the same time by the 128-bit kernel
+static const size_t nlanes_128_x64 = 4;
+
+//! Number of keys hashed at the same time by the 32-bit kernel
+static const size_t nlanes_32_x32 = 8;
+
+
+/* Keys may start at any address, so blocks are always
+ * loaded via memcpy (which compiles to a plain load) */
+static inline uint64_t load64_(uint8_t const * p)
+{
+    uint64_t ret;
+    std::memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+
+static inline uint32_t load32_(uint8_t const * p)
+{
+    uint32_t ret;
+    std::memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+
+/* Store a full hash into the output, truncating or
+ * zero-padding as needed. The common case uses a fixed-size
+ * copy rather than a call to memmove */
+template<size_t FullSize>
+static inline void store_hash_(uint8_t const * full, uint8_t * out,
+                               size_t hashsize, size_t outsize)
+{
+    if(hashsize == FullSize && outsize == FullSize)
+    {
+        std::memcpy(out, full, FullSize);
+        return;
+    }
+
+    const size_t ncopy = std::min(hashsize, outsize);
+    std::copy(full, full + ncopy, out);
+    std::fill(out + ncopy, out + outsize, 0);
+}
+
+
+/* Hash the remaining part of a single key, starting from an
+ * existing state where the first ndone bytes have been hashed */
+static inline void finish_128_x64_(uint64_t h1, uint64_t h2,
+                                   uint8_t const * data, size_t ndone, size_t len,
+                                   uint8_t * out, size_t hashsize, size_t outsize)
+{
+    for(; len - ndone >= 16; ndone += 16)
+        MurmurHash3_128_x64::mix_block(h1, h2, load64_(data + ndone), load64_(data + ndone + 8));
+
+    uint8_t full[16];
+    MurmurHash3_128_x64::finish(h1, h2, data + ndone, len - ndone, len, full);
+    store_hash_<16>(full, out, hashsize, outsize);
+}
+
+
+static inline void finish_32_x32_(uint32_t h,
+                                  uint8_t const * data, size_t ndone, size_t len,
+                                  uint8_t * out, size_t hashsize, size_t outsize)
+{
+    for(; len - ndone >= 4; ndone += 4)
+        MurmurHash3_32_x32::mix_block(h, load32_(data + ndone));
+
+    uint8_t full[4];
+    MurmurHash3_32_x32::finish(h, data + ndone, len - ndone, len, full);
+    store_hash_<4>(full, out, hashsize, outsize);
+}
+
+
+/* Hash keys one at a time with an existing hash object */
+template<typename Algorithm>
+static void serial_batch_(Algorithm & algo,
+                          void const * const * ptrs, size_t const * lens, size_t n,
+                          uint8_t * out, size_t hashsize, size_t outsize)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        algo.reset();
+        algo.update(ptrs[i], lens[i]);
+
+        uint8_t full[16];
+        algo.finalize_into(full);
+        store_hash_<16>(full, out + i * outsize, hashsize, outsize);
+    }
+}
+
+
+static void murmurhash3_32_x32_batch_generic_(void const * const * ptrs, size_t const * lens, size_t n,
+                                              uint8_t * out, size_t hashsize, size_t outsize)
+{
+    const size_t nl = nlanes_32_x32;
+
+    size_t i = 0;
+    for(; i + nl <= n; i += nl)
+    {
+        uint8_t const * data[nl];
+        uint32_t h[nl];
+
+        // Blocks that all lanes have in common
+        size_t nblocks = std::numeric_limits<size_t>::max();
+
+        for(size_t l = 0; l < nl; l++)
+        {
+            data[l] = static_cast<uint8_t const *>(ptrs[i+l]);
+            h[l] = 0;
+            nblocks = std::min(nblocks, lens[i+l] / 4);
+        }
+
+        for(size_t b = 0; b < nblocks; b++)
+        {
+            const size_t offset = b * 4;
+
+            for(size_t l = 0; l < nl; l++)
+                MurmurHash3_32_x32::mix_block(h[l], load32_(data[l] + offset));
+        }
+
+        for(size_t l = 0; l < nl; l++)
+            finish_32_x32_(h[l], data[l], nblocks * 4, lens[i+l],
+                           out + (i+l) * outsize, hashsize, outsize);
+    }
+
+    for(; i < n; i++)
+        finish_32_x32_(0, static_cast<uint8_t const *>(ptrs[i]), 0, lens[i],
+                       out + i * outsize, hashsize, outsize);
+}
+
+
+#ifdef BPHASH_HAVE_X86_64
+template<int R>
+BPHASH_TARGET_AVX2
+static inline __m256i rotl32_avx2_(__m256i x)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, R), _mm256_srli_epi32(x, 32 - R));
+}
+
+
+/* The eight lanes of the 32-bit kernel fit in a single AVX2 register */
+BPHASH_TARGET_AVX2
+static void murmurhash3_32_x32_batch_avx2_(void const * const * ptrs, size_t const * lens, size_t n,
+                                           uint8_t * out, size_t hashsize, size_t outsize)
+{
+    const size_t nl = nlanes_32_x32;
+
+    const __m256i c1 = _mm256_set1_epi32(static_cast<int>(0xcc9e2d51));
+    const __m256i c2 = _mm256_set1_epi32(static_cast<int>(0x1b873593));
+    const __m256i c3 = _mm256_set1_epi32(static_cast<int>(0xe6546b64));
+
+    size_t i = 0;
+    for(; i + nl <= n; i += nl)
+    {
+        uint8_t const * data[nl];
+
+        // Blocks that all lanes have in common
+        size_t nblocks = std::numeric_limits<size_t>::max();
+
+        for(size_t l = 0; l < nl; l++)
+        {
+            data[l] = static_cast<uint8_t const *>(ptrs[i+l]);
+            nblocks = std::min(nblocks, lens[i+l] / 4);
+        }
+
+        __m256i h = _mm256_setzero_si256();
+
+        for(size_t b = 0; b < nblocks; b++)
+        {
+            const size_t offset = b * 4;
+
+            __m256i k = _mm256_setr_epi32(static_cast<int>(load32_(data[0] + offset)),
+                                          static_cast<int>(load32_(data[1] + offset)),
+                                          static_cast<int>(load32_(data[2] + offset)),
+                                          static_cast<int>(load32_(data[3] + offset)),
+                                          static_cast<int>(load32_(data[4] + offset)),
+                                          static_cast<int>(load32_(data[5] + offset)),
+                                          static_cast<int>(load32_(data[6] + offset)),
+                                          static_cast<int>(load32_(data[7] + offset)));
+
+            // Same as MurmurHash3_32_x32::mix_block
+            k = _mm256_mullo_epi32(k, c1);
+            k = rotl32_avx2_<15>(k);
+            k = _mm256_mullo_epi32(k, c2);
+
+            h = _mm256_xor_si256(h, k);
+            h = rotl32_avx2_<13>(h);
+            h = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(h, 2), h), c3);
+        }
+
+        uint32_t hl[nl];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(hl), h);
+
+        for(size_t l = 0; l < nl; l++)
+            finish_32_x32_(hl[l], data[l], nblocks * 4, lens[i+l],
+                           out + (i+l) * outsize, hashsize, outsize);
+    }
+
+    for(; i < n; i++)
+        finish_32_x32_(0, static_cast<uint8_t const *>(ptrs[i]), 0, lens[i],
+                       out + i * outsize, hashsize, outsize);
+}
+#endif
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+void murmurhash3_128_x64_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                               uint8_t * out, size_t hashsize, size_t outsize)
+{
+    const size_t nl = nlanes_128_x64;
+
+    size_t i = 0;
+    for(; i + nl <= n; i += nl)
+    {
+        uint8_t const * data[nl];
+        uint64_t h1[nl];
+        uint64_t h2[nl];
+
+        // Blocks that all lanes have in common
+        size_t nblocks = std::numeric_limits<size_t>::max();
+
+        for(size_t l = 0; l < nl; l++)
+        {
+            data[l] = static_cast<uint8_t const *>(ptrs[i+l]);
+            h1[l] = h2[l] = 0;
+            nblocks = std::min(nblocks, lens[i+l] / 16);
+        }
+
+        // The states of the different lanes are independent, so
+        // the multiplications of one lane overlap with the others
+        for(size_t b = 0; b < nblocks; b++)
+        {
+            const size_t offset = b * 16;
+
+            for(size_t l = 0; l < nl; l++)
+                MurmurHash3_128_x64::mix_block(h1[l], h2[l],
+                                               load64_(data[l] + offset),
+                                               load64_(data[l] + offset + 8));
+        }
+
+        // Anything left is done one key at a time
+        for(size_t l = 0; l < nl; l++)
+            finish_128_x64_(h1[l], h2[l], data[l], nblocks * 16, lens[i+l],
+                            out + (i+l) * outsize, hashsize, outsize);
+    }
+
+    for(; i < n; i++)
+        finish_128_x64_(0, 0, static_cast<uint8_t const *>(ptrs[i]), 0, lens[i],
+                        out + i * outsize, hashsize, outsize);
+}
+
+
+void murmurhash3_32_x32_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                              uint8_t * out, size_t hashsize, size_t outsize)
+{
+#ifdef BPHASH_HAVE_X86_64
+    if(isa_level() >= ISALevel::AVX2)
+    {
+        murmurhash3_32_x32_batch_avx2_(ptrs, lens, n, out, hashsize, outsize);
+        return;
+    }
+#endif
+
+    murmurhash3_32_x32_batch_generic_(ptrs, lens, n, out, hashsize, outsize);
+}
+
+
+void treehash_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                    uint8_t * out, size_t hashsize, size_t outsize)
+{
+    // Keys are expected to be short, so they are not worth
+    // sending to other threads
+    ThreadPool serial(0);
+    TreeHash th(serial);
+    serial_batch_(th, ptrs, lens, n, out, hashsize, outsize);
+}
+
+
+void xxh3_64_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                   uint8_t * out, size_t hashsize, size_t outsize)
+{
+    // XXH3 has no long dependency chains for short
+    // keys, so there is nothing to gain by interleaving
+    XXH3_64 xxh;
+    serial_batch_(xxh, ptrs, lens, n, out, hashsize, outsize);
+}
+
+
+void xxh3_128_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                    uint8_t * out, size_t hashsize, size_t outsize)
+{
+    XXH3_128 xxh;
+    serial_batch_(xxh, ptrs, lens, n, out, hashsize, outsize);
+}
+
+
+void crc32c_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                  uint8_t * out, size_t hashsize, size_t outsize)
+{
+    CRC32C crc;
+    serial_batch_(crc, ptrs, lens, n, out, hashsize, outsize);
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
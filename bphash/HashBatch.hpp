@@ -0,0 +1,157 @@
+/*! \file
+ * \brief Hashing of many independent keys at once
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hasher.hpp"
+
+namespace bphash {
+namespace detail {
+
+/*! \brief Hash many independent keys with MurmurHash3 128-bit x64
+ *
+ * Each key is hashed independently, and the results are identical to
+ * hashing each key separately with MurmurHash3_128_x64. Several keys
+ * are hashed at the same time in interleaved lanes.
+ *
+ * The first \p hashsize bytes of each hash are written to \p out,
+ * which must hold `n * outsize` bytes. If \p outsize is larger
+ * than \p hashsize, the remaining bytes for each key are zeroed.
+ *
+ * \param [in] ptrs Pointers to the start of each key
+ * \param [in] lens Length (in bytes) of each key
+ * \param [in] n Number of keys
+ * \param [out] out Where to write the hashes
+ * \param [in] hashsize Number of bytes of each hash to keep (at most 16)
+ * \param [in] outsize Size of each output element
+ */
+void murmurhash3_128_x64_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                               uint8_t * out, size_t hashsize, size_t outsize);
+
+
+/*! \brief Hash many independent keys with MurmurHash3 32-bit x32
+ *
+ * \copydetails murmurhash3_128_x64_batch
+ */
+void murmurhash3_32_x32_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                              uint8_t * out, size_t hashsize, size_t outsize);
+
+
+/*! \brief Hash many independent keys with the 128-bit tree hash
+ *
+ * The keys are hashed one at a time in the calling thread.
+ *
+ * \copydetails murmurhash3_128_x64_batch
+ */
+void treehash_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                    uint8_t * out, size_t hashsize, size_t outsize);
+
+
+/*! \brief Hash many independent keys with the 64-bit XXH3 hash
+ *
+ * \copydetails murmurhash3_128_x64_batch
+ */
+void xxh3_64_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                   uint8_t * out, size_t hashsize, size_t outsize);
+
+
+/*! \brief Hash many independent keys with the 128-bit XXH3 hash
+ *
+ * \copydetails murmurhash3_128_x64_batch
+ */
+void xxh3_128_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                    uint8_t * out, size_t hashsize, size_t outsize);
+
+
+/*! \brief Compute the CRC32C checksums of many independent keys
+ *
+ * \copydetails murmurhash3_128_x64_batch
+ */
+void crc32c_batch(void const * const * ptrs, size_t const * lens, size_t n,
+                  uint8_t * out, size_t hashsize, size_t outsize);
+
+} // close namespace detail
+
+
+
+/*! \brief Hash many short, independent keys at once
+ *
+ * The raw bytes of each key are hashed separately, and the hash of
+ * key `i` is written to `out[i]`. This is equivalent to (but faster than)
+ * creating a new hasher for each key, passing the raw bytes of the key to
+ * the hash algorithm, and calling `finalize_digest<N>()`. That is,
+ * no size is prepended as is done when hashing objects via a Hasher.
+ * The results therefore match the reference MurmurHash3 functions (with a
+ * seed of zero).
+ *
+ * Keys are hashed several at a time, with their states interleaved so
+ * that the latency of each multiplication is hidden by work on the
+ * other keys. This is most useful for keys of similar length.
+ *
+ * As with Hasher::finalize_digest, if \p N does not match the size of
+ * the hash for \p type, the hash is truncated or padded with zeros.
+ *
+ * \param [in] type The type of hash to use
+ * \param [in] ptrs Pointers to the start of each key
+ * \param [in] lens Length (in bytes) of each key
+ * \param [in] n Number of keys
+ * \param [out] out Where to store the digests (must hold \p n digests)
+ */
+template<size_t N>
+void hash_batch(HashType type, void const * const * ptrs, size_t const * lens,
+                size_t n, Digest<N> * out)
+{
+    static_assert(sizeof(Digest<N>) == N, "Digest has extra storage");
+
+    uint8_t * outbytes = reinterpret_cast<uint8_t *>(out);
+
+    switch(type)
+    {
+        case HashType::Hash128:
+        case HashType::Hash128_x32:
+        case HashType::Hash128_x64:
+            detail::murmurhash3_128_x64_batch(ptrs, lens, n, outbytes, 16, N);
+            break;
+
+        case HashType::Hash64:
+        case HashType::Hash64_x32:
+        case HashType::Hash64_x64:
+            detail::murmurhash3_128_x64_batch(ptrs, lens, n, outbytes, 8, N);
+            break;
+
+        case HashType::Hash32:
+        case HashType::Hash32_x64:
+            detail::murmurhash3_128_x64_batch(ptrs, lens, n, outbytes, 4, N);
+            break;
+
+        case HashType::Hash32_x32:
+            detail::murmurhash3_32_x32_batch(ptrs, lens, n, outbytes, 4, N);
+            break;
+
+        case HashType::Hash128_tree:
+            detail::treehash_batch(ptrs, lens, n, outbytes, 16, N);
+            break;
+
+        case HashType::Hash64_xxh3:
+            detail::xxh3_64_batch(ptrs, lens, n, outbytes, 8, N);
+            break;
+
+        case HashType::Hash128_xxh3:
+            detail::xxh3_128_batch(ptrs, lens, n, outbytes, 16, N);
+            break;
+
+        case HashType::CRC32C:
+            detail::crc32c_batch(ptrs, lens, n, outbytes, 4, N);
+            break;
+    }
+}
+
+
+} // close namespace bphash
+
@@ -0,0 +1,317 @@
+/*! \file
+ * \brief Hashing of the contents of files (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/HashFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BPHASH_HAVE_POSIX_FILES
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace bphash {
+namespace detail {
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+static std::system_error file_error_(int err, const char * what, const std::string & path)
+{
+    return std::system_error(err, std::generic_category(), std::string(what) + " " + path);
+}
+
+
+#ifdef BPHASH_HAVE_POSIX_FILES
+
+/* Closes a file descriptor when going out of scope */
+class FileDescriptor
+{
+    public:
+        explicit FileDescriptor(int fd) : fd_(fd) { }
+
+        ~FileDescriptor(void) { if(fd_ >= 0) ::close(fd_); }
+
+        FileDescriptor(const FileDescriptor &)             = delete;
+        FileDescriptor & operator=(const FileDescriptor &) = delete;
+
+        int get(void) const { return fd_; }
+
+    private:
+        int fd_;
+};
+
+
+/* Buffer aligned to a page, as some file systems
+ * (and O_DIRECT) read faster into these */
+class AlignedBuffer
+{
+    public:
+        explicit AlignedBuffer(size_t size)
+            : ptr_(nullptr)
+        {
+            void * p = nullptr;
+            if(posix_memalign(&p, 4096, size) != 0)
+                throw std::bad_alloc();
+            ptr_ = static_cast<uint8_t *>(p);
+        }
+
+        ~AlignedBuffer(void) { free(ptr_); }
+
+        AlignedBuffer(const AlignedBuffer &)             = delete;
+        AlignedBuffer & operator=(const AlignedBuffer &) = delete;
+
+        uint8_t * get(void) const { return ptr_; }
+
+    private:
+        uint8_t * ptr_;
+};
+
+
+/* Hash a range of a regular file by mapping it, one window at a time
+ *
+ * Returns false if the file could not be mapped */
+static bool hash_mapped_(int fd, const std::string & path, uint64_t offset, uint64_t nbytes,
+                         HashImpl & impl, size_t window_size)
+{
+    if(nbytes == 0)
+        return true;
+
+    const uint64_t pagesize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t end = offset + nbytes;
+
+    // Windows start on a page boundary
+    uint64_t window_start = offset - (offset % pagesize);
+
+    #ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(nbytes), POSIX_FADV_SEQUENTIAL);
+    #endif
+
+    int flags = MAP_PRIVATE;
+    #ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+    #endif
+
+    bool first = true;
+
+    while(window_start < end)
+    {
+        const size_t window_len = static_cast<size_t>(std::min<uint64_t>(window_size, end - window_start));
+
+        // Have the OS start reading the next window while this one is hashed
+        #ifdef POSIX_FADV_WILLNEED
+        if(window_start + window_len < end)
+        {
+            const uint64_t next_len = std::min<uint64_t>(window_size, end - window_start - window_len);
+            posix_fadvise(fd, static_cast<off_t>(window_start + window_len),
+                          static_cast<off_t>(next_len), POSIX_FADV_WILLNEED);
+        }
+        #endif
+
+        void * p = mmap(nullptr, window_len, PROT_READ, flags, fd, static_cast<off_t>(window_start));
+        if(p == MAP_FAILED)
+        {
+            // Nothing hashed yet? The caller can fall back to reading
+            if(first)
+                return false;
+            throw file_error_(errno, "Cannot map", path);
+        }
+
+        #ifdef MADV_SEQUENTIAL
+        madvise(p, window_len, MADV_SEQUENTIAL);
+        #endif
+
+        // Skip anything before the requested offset (first window only)
+        const uint64_t skip = std::max(window_start, offset) - window_start;
+        impl.update(static_cast<uint8_t const *>(p) + skip, window_len - skip);
+
+        munmap(p, window_len);
+        window_start += window_len;
+        first = false;
+    }
+
+    return true;
+}
+
+
+/* Read and throw away data until the offset is reached
+ *
+ * Returns false if the end of the file was reached first */
+static bool discard_(int fd, const std::string & path, uint64_t offset, uint8_t * buffer)
+{
+    uint64_t pos = 0;
+
+    while(pos < offset)
+    {
+        const size_t toread = static_cast<size_t>(std::min<uint64_t>(file_buffer_size, offset - pos));
+        const ssize_t n = ::read(fd, buffer, toread);
+
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            throw file_error_(errno, "Cannot read", path);
+        if(n == 0)
+            return false;
+
+        pos += static_cast<uint64_t>(n);
+    }
+
+    return true;
+}
+
+
+/* Hash a range of a file by reading it into a buffer */
+static uint64_t hash_read_(int fd, const std::string & path, uint64_t offset, uint64_t nbytes,
+                           HashImpl & impl)
+{
+    // Can't be represented as an offset (so it is beyond the end)
+    if(offset > static_cast<uint64_t>(std::numeric_limits<off_t>::max()))
+        return 0;
+
+    AlignedBuffer buffer(file_buffer_size);
+
+    bool seekable = true;
+    uint64_t ndone = 0;
+
+    while(ndone < nbytes)
+    {
+        const size_t toread = static_cast<size_t>(std::min<uint64_t>(file_buffer_size, nbytes - ndone));
+
+        const ssize_t n = seekable ? pread(fd, buffer.get(), toread, static_cast<off_t>(offset + ndone))
+                                   : ::read(fd, buffer.get(), toread);
+
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            // pread isn't available for pipes, etc. Those
+            // are read from the start, skipping the offset
+            if(seekable && errno == ESPIPE)
+            {
+                seekable = false;
+                if(!discard_(fd, path, offset, buffer.get()))
+                    break;
+                continue;
+            }
+
+            throw file_error_(errno, "Cannot read", path);
+        }
+
+        if(n == 0)
+            break;   // end of file
+
+        impl.update(buffer.get(), static_cast<size_t>(n));
+        ndone += static_cast<uint64_t>(n);
+    }
+
+    return ndone;
+}
+
+#endif // BPHASH_HAVE_POSIX_FILES
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+uint64_t hash_file_into(const std::string & path, uint64_t offset, uint64_t nbytes,
+                        HashImpl & impl, FileAccess access, size_t window_size)
+{
+#ifdef BPHASH_HAVE_POSIX_FILES
+    int oflags = O_RDONLY;
+    #ifdef O_CLOEXEC
+    oflags |= O_CLOEXEC;
+    #endif
+
+    FileDescriptor fd(::open(path.c_str(), oflags));
+    if(fd.get() < 0)
+        throw file_error_(errno, "Cannot open", path);
+
+    struct stat st;
+    if(fstat(fd.get(), &st) != 0)
+        throw file_error_(errno, "Cannot stat", path);
+
+    // Files in procfs and sysfs are regular, but have a size of zero
+    // whatever their contents. There is nothing to map, so those are
+    // read until the end.
+    const bool sized = S_ISREG(st.st_mode) && st.st_size > 0;
+
+    if(sized && access != FileAccess::Read)
+    {
+        // Only what is actually in the file
+        const uint64_t filesize = static_cast<uint64_t>(st.st_size);
+        const uint64_t map_offset = std::min(offset, filesize);
+        const uint64_t map_nbytes = std::min(nbytes, filesize - map_offset);
+
+        if(hash_mapped_(fd.get(), path, map_offset, map_nbytes, impl, window_size))
+            return map_nbytes;
+    }
+
+    if(access == FileAccess::Map && (sized || !S_ISREG(st.st_mode)))
+        throw file_error_(ENODEV, "Cannot map", path);
+
+    return hash_read_(fd.get(), path, offset, nbytes, impl);
+
+#else
+    (void)access;
+    (void)window_size;
+
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        throw file_error_(ENOENT, "Cannot open", path);
+
+    file.seekg(static_cast<std::streamoff>(offset));
+
+    std::vector<char> buffer(file_buffer_size);
+    uint64_t ndone = 0;
+
+    while(ndone < nbytes && file)
+    {
+        const size_t toread = static_cast<size_t>(std::min<uint64_t>(buffer.size(), nbytes - ndone));
+        file.read(buffer.data(), static_cast<std::streamsize>(toread));
+
+        const size_t n = static_cast<size_t>(file.gcount());
+        impl.update(buffer.data(), n);
+        ndone += n;
+    }
+
+    return ndone;
+#endif
+}
+
+} // close namespace detail
+
+
+HashValue hash_file(const std::string & path, HashType type)
+{
+    return hash_file(path, type, 0, std::numeric_limits<uint64_t>::max());
+}
+
+
+HashValue hash_file(const std::string & path, HashType type,
+                    uint64_t offset, uint64_t nbytes)
+{
+    std::unique_ptr<detail::HashImpl> impl = detail::make_hash_impl(type);
+    detail::hash_file_into(path, offset, nbytes, *impl, detail::FileAccess::Auto);
+    return impl->finalize();
+}
+
+
+} // close namespace bphash
+
@@ -0,0 +1,92 @@
+/*! \file
+ * \brief Hashing of the contents of files (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hasher.hpp"
+
+#include <limits>
+#include <string>
+
+namespace bphash {
+
+namespace detail {
+
+/*! \brief How the contents of a file are obtained */
+enum class FileAccess
+{
+    Auto,  //!< Memory map if possible, otherwise read
+    Map,   //!< Memory map (fails if the file can't be mapped)
+    Read   //!< Read into a buffer
+};
+
+
+//! Size of the windows a file is mapped with (a multiple of the 2 MiB huge page size)
+static const size_t file_window_size = 64*1024*1024;
+
+//! Size of the buffer used when reading a file
+static const size_t file_buffer_size = 1024*1024;
+
+
+/*! \brief Add the contents of (part of) a file to a hash
+ *
+ * \throw std::system_error if the file can't be opened or read
+ *
+ * \param [in] path Path to the file
+ * \param [in] offset Where to start in the file (in bytes)
+ * \param [in] nbytes Maximum number of bytes to hash
+ * \param [in] impl The hash to add the data to
+ * \param [in] access How the data is obtained
+ * \param [in] window_size Size of the windows a file is mapped with.
+ *                         Must be a multiple of the page size.
+ * \return The number of bytes hashed
+ */
+uint64_t hash_file_into(const std::string & path, uint64_t offset, uint64_t nbytes,
+                        HashImpl & impl, FileAccess access = FileAccess::Auto,
+                        size_t window_size = file_window_size);
+
+} // close namespace detail
+
+
+/*! \brief Hash the contents of a file
+ *
+ * The raw bytes of the file are hashed. For XXH3 and CRC32C, this
+ * gives the same result as the usual command-line tools.
+ * Note that this is not the same as hashing a container holding the same bytes
+ * with make_hash(), which also includes the number of elements.
+ *
+ * Regular files are memory mapped in large windows, with hints to the
+ * operating system to read ahead. Other files (such as pipes) are read
+ * in large blocks. The file must not be truncated while it is being hashed.
+ *
+ * \throw std::system_error if the file can't be opened or read
+ *
+ * \param [in] path Path to the file
+ * \param [in] type The type of hash to use
+ * \return Hash of the contents of the file
+ */
+HashValue hash_file(const std::string & path, HashType type);
+
+
+/*! \brief Hash part of a file
+ *
+ * The range is limited to the end of the file, so an offset beyond the
+ * end of the file gives the hash of no data.
+ *
+ * \copydetails hash_file(const std::string &, HashType)
+ *
+ * \param [in] offset Where to start in the file (in bytes)
+ * \param [in] nbytes Maximum number of bytes to hash
+ */
+HashValue hash_file(const std::string & path, HashType type,
+                    uint64_t offset, uint64_t nbytes);
+
+
+} // close namespace bphash
+
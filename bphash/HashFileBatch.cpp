@@ -0,0 +1,609 @@
+/*! \file
+ * \brief Hashing of the contents of many files at once (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/HashFileBatch.hpp"
+#include "bphash/HashFile.hpp"
+#include "bphash/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BPHASH_HAVE_POSIX_FILES
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+// Opening, reading, and closing through the ring needs Linux 5.6, which is
+// also when probing for supported operations (and IORING_FEAT_RW_CUR_POS) was added
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define BPHASH_HAVE_IO_URING
+#endif
+#endif
+#endif
+
+namespace bphash {
+namespace detail {
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+static std::exception_ptr file_error_(int err, const char * what, const std::string & path)
+{
+    return std::make_exception_ptr(std::system_error(err, std::generic_category(),
+                                                     std::string(what) + " " + path));
+}
+
+
+/* Throw the first error (in input order), if there are any */
+static void rethrow_first_(const std::vector<std::exception_ptr> & errors)
+{
+    for(const auto & e : errors)
+    {
+        if(e)
+            std::rethrow_exception(e);
+    }
+}
+
+
+#ifdef BPHASH_HAVE_IO_URING
+
+/* A minimal io_uring, set up with the raw system calls
+ *
+ * Each submission is copied into the submission ring, and is given
+ * to the kernel (in bulk) by submit_and_wait(). The caller must not have
+ * more operations in flight than there are entries in the ring. */
+class IOUring
+{
+    public:
+        explicit IOUring(unsigned entries)
+            : fd_(-1), sq_ptr_(MAP_FAILED), sq_size_(0), cq_ptr_(MAP_FAILED), cq_size_(0),
+              sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)), sqes_size_(0), to_submit_(0)
+        {
+            io_uring_params p;
+            std::memset(&p, 0, sizeof(p));
+
+            fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+            if(fd_ < 0)
+                return;
+
+            if(!map_rings_(p) || !supports_(IORING_OP_OPENAT) ||
+               !supports_(IORING_OP_READ) || !supports_(IORING_OP_CLOSE))
+            {
+                unmap_();
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+
+        ~IOUring(void)
+        {
+            if(fd_ >= 0)
+            {
+                unmap_();
+                ::close(fd_);
+            }
+        }
+
+        IOUring(const IOUring &)             = delete;
+        IOUring & operator=(const IOUring &) = delete;
+
+
+        /* Was the ring set up, with all the operations we need? */
+        bool valid(void) const { return fd_ >= 0; }
+
+
+        /* Add an operation to the submission ring */
+        void push(const io_uring_sqe & sqe)
+        {
+            // We are the only writer of the tail
+            const unsigned tail = *sq_tail_;
+            const unsigned idx = tail & *sq_mask_;
+
+            sqes_[idx] = sqe;
+            sq_array_[idx] = idx;
+            __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+            to_submit_++;
+        }
+
+
+        /* Submit everything pushed so far, and wait for at least one completion */
+        void submit_and_wait(void)
+        {
+            while(true)
+            {
+                const long ret = syscall(__NR_io_uring_enter, fd_, to_submit_, 1,
+                                         IORING_ENTER_GETEVENTS, nullptr, 0);
+                if(ret >= 0)
+                {
+                    to_submit_ -= static_cast<unsigned>(ret);
+                    if(to_submit_ == 0)
+                        return;
+                }
+                else if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+            }
+        }
+
+
+        /* Take the next completion, if there is one */
+        bool pop(io_uring_cqe & cqe)
+        {
+            // We are the only writer of the head
+            const unsigned head = *cq_head_;
+            if(head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+                return false;
+
+            cqe = cqes_[head & *cq_mask_];
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+
+    private:
+        int fd_;
+
+        void * sq_ptr_;
+        size_t sq_size_;
+        void * cq_ptr_;
+        size_t cq_size_;
+        io_uring_sqe * sqes_;
+        size_t sqes_size_;
+
+        unsigned * sq_tail_;
+        unsigned * sq_mask_;
+        unsigned * sq_array_;
+        unsigned * cq_head_;
+        unsigned * cq_tail_;
+        unsigned * cq_mask_;
+        io_uring_cqe * cqes_;
+
+        unsigned to_submit_;    // Pushed, but not yet given to the kernel
+
+
+        bool map_rings_(const io_uring_params & p)
+        {
+            sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+
+            // Newer kernels share one mapping for both rings
+            const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if(single)
+                sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+            sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           fd_, IORING_OFF_SQ_RING);
+            if(sq_ptr_ == MAP_FAILED)
+                return false;
+
+            if(single)
+                cq_ptr_ = sq_ptr_;
+            else
+            {
+                cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               fd_, IORING_OFF_CQ_RING);
+                if(cq_ptr_ == MAP_FAILED)
+                    return false;
+            }
+
+            sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe *>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+            if(sqes_ == MAP_FAILED)
+                return false;
+
+            char * sq = static_cast<char *>(sq_ptr_);
+            char * cq = static_cast<char *>(cq_ptr_);
+            sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+            sq_mask_ = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+            cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+            cq_mask_ = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+            return true;
+        }
+
+
+        void unmap_(void)
+        {
+            if(sqes_ != MAP_FAILED)
+                munmap(sqes_, sqes_size_);
+            if(cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_)
+                munmap(cq_ptr_, cq_size_);
+            if(sq_ptr_ != MAP_FAILED)
+                munmap(sq_ptr_, sq_size_);
+        }
+
+
+        bool supports_(int op) const
+        {
+            const size_t nops = 256;
+            std::vector<uint8_t> buffer(sizeof(io_uring_probe) + nops * sizeof(io_uring_probe_op), 0);
+            io_uring_probe * probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+
+            if(syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, nops) < 0)
+                return false;
+
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        }
+};
+
+
+/* State of one of the files being read through the ring */
+struct UringSlot
+{
+    enum class State { Free, Opening, Reading, Closing };
+
+    State state;
+    size_t index;                       // Index of the file in the input
+    int fd;
+    uint64_t offset;                    // How much of the file has been read
+    uint8_t * buffer;
+    std::unique_ptr<HashImpl> impl;
+};
+
+
+/* Hash files through io_uring
+ *
+ * Each file goes through open -> read (until the end) -> close,
+ * with one operation in flight for each slot. The data is hashed
+ * in this thread as each read completes.
+ *
+ * Returns false if io_uring can't be used */
+static bool hash_files_uring_(const std::vector<std::string> & paths, HashType type,
+                              std::vector<HashValue> & results,
+                              std::vector<std::exception_ptr> & errors)
+{
+    const size_t nslots = std::min(file_batch_depth, paths.size());
+
+    IOUring ring(static_cast<unsigned>(nslots));
+    if(!ring.valid())
+        return false;
+
+    std::vector<uint8_t> buffers(nslots * file_batch_buffer_size);
+    std::vector<UringSlot> slots(nslots);
+
+    for(size_t i = 0; i < nslots; i++)
+    {
+        slots[i].state = UringSlot::State::Free;
+        slots[i].buffer = buffers.data() + i * file_batch_buffer_size;
+        slots[i].impl = make_hash_impl(type);
+    }
+
+    size_t next = 0;
+    size_t nactive = 0;
+
+    auto push_ = [&ring](uint8_t opcode, size_t s, int fd, uint64_t addr, unsigned len, uint64_t off)
+    {
+        io_uring_sqe sqe;
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.addr = addr;
+        sqe.len = len;
+        sqe.off = off;
+        sqe.user_data = s;
+        if(opcode == IORING_OP_OPENAT)
+            sqe.open_flags = O_RDONLY | O_CLOEXEC;
+        ring.push(sqe);
+    };
+
+    auto push_read_ = [&](size_t s)
+    {
+        UringSlot & slot = slots[s];
+        push_(IORING_OP_READ, s, slot.fd, reinterpret_cast<uintptr_t>(slot.buffer),
+              static_cast<unsigned>(file_batch_buffer_size), slot.offset);
+    };
+
+    auto push_close_ = [&](size_t s)
+    {
+        slots[s].state = UringSlot::State::Closing;
+        push_(IORING_OP_CLOSE, s, slots[s].fd, 0, 0, 0);
+    };
+
+    // Start on the next file with a slot. Returns false if there are no more files
+    auto start_next_ = [&](size_t s)
+    {
+        UringSlot & slot = slots[s];
+        if(next == paths.size())
+        {
+            slot.state = UringSlot::State::Free;
+            return false;
+        }
+
+        slot.state = UringSlot::State::Opening;
+        slot.index = next++;
+        slot.offset = 0;
+        slot.impl->reset();
+        push_(IORING_OP_OPENAT, s, AT_FDCWD, reinterpret_cast<uintptr_t>(paths[slot.index].c_str()), 0, 0);
+        return true;
+    };
+
+    for(size_t s = 0; s < nslots; s++)
+    {
+        if(start_next_(s))
+            nactive++;
+    }
+
+    while(nactive > 0)
+    {
+        ring.submit_and_wait();
+
+        io_uring_cqe cqe;
+        while(ring.pop(cqe))
+        {
+            const size_t s = static_cast<size_t>(cqe.user_data);
+            UringSlot & slot = slots[s];
+
+            switch(slot.state)
+            {
+                case UringSlot::State::Opening:
+                    if(cqe.res < 0)
+                    {
+                        errors[slot.index] = file_error_(-cqe.res, "Cannot open", paths[slot.index]);
+                        if(!start_next_(s))
+                            nactive--;
+                    }
+                    else
+                    {
+                        slot.fd = cqe.res;
+                        slot.state = UringSlot::State::Reading;
+                        push_read_(s);
+                    }
+                    break;
+
+                case UringSlot::State::Reading:
+                    if(cqe.res == -EINTR || cqe.res == -EAGAIN)
+                        push_read_(s);
+                    else if(cqe.res < 0)
+                    {
+                        errors[slot.index] = file_error_(-cqe.res, "Cannot read", paths[slot.index]);
+                        push_close_(s);
+                    }
+                    else if(cqe.res == 0)
+                    {
+                        results[slot.index] = slot.impl->finalize();
+                        push_close_(s);
+                    }
+                    else
+                    {
+                        slot.impl->update(slot.buffer, static_cast<size_t>(cqe.res));
+                        slot.offset += static_cast<uint64_t>(cqe.res);
+                        push_read_(s);
+                    }
+                    break;
+
+                case UringSlot::State::Closing:
+                    if(!start_next_(s))
+                        nactive--;
+                    break;
+
+                case UringSlot::State::Free:
+                    break;
+            }
+        }
+    }
+
+    return true;
+}
+
+#endif
+
+
+/* Hash a whole file with blocking reads into the given buffer
+ *
+ * Returns the error, if any */
+static std::exception_ptr hash_file_read_(const std::string & path, HashImpl & impl, uint8_t * buffer)
+{
+#ifdef BPHASH_HAVE_POSIX_FILES
+    int fd;
+    do {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    } while(fd < 0 && errno == EINTR);
+
+    if(fd < 0)
+        return file_error_(errno, "Cannot open", path);
+
+    std::exception_ptr err;
+    uint64_t offset = 0;
+    bool seekable = true;
+
+    while(true)
+    {
+        const ssize_t n = seekable ? pread(fd, buffer, file_batch_buffer_size, static_cast<off_t>(offset))
+                                   : ::read(fd, buffer, file_batch_buffer_size);
+
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == ESPIPE && seekable)
+            {
+                seekable = false;
+                continue;
+            }
+
+            err = file_error_(errno, "Cannot read", path);
+            break;
+        }
+
+        if(n == 0)
+            break;
+
+        impl.update(buffer, static_cast<size_t>(n));
+        offset += static_cast<uint64_t>(n);
+    }
+
+    ::close(fd);
+    return err;
+#else
+    (void)buffer;
+
+    try {
+        hash_file_into(path, 0, std::numeric_limits<uint64_t>::max(), impl, FileAccess::Read);
+    }
+    catch(...)
+    {
+        return std::current_exception();
+    }
+
+    return std::exception_ptr();
+#endif
+}
+
+
+/* Hash files by reading them from a pool of threads
+ *
+ * Each worker, and the calling thread, takes the next file that hasn't been
+ * started. The caller then only waits for files that a worker has started, so
+ * this can't deadlock if called from a job running on the same pool. */
+static void hash_files_threads_(const std::vector<std::string> & paths, HashType type,
+                                ThreadPool & pool,
+                                std::vector<HashValue> & results,
+                                std::vector<std::exception_ptr> & errors)
+{
+    // Shared with the jobs, which may start after all the files are
+    // finished (and this function has returned). A job only uses the
+    // arguments after claiming a file, which is waited for.
+    struct State
+    {
+        std::atomic<size_t> next;   // Next file to be claimed
+        size_t ndone;               // Number of files finished
+
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->next = 0;
+    state->ndone = 0;
+
+    const size_t nfiles = paths.size();
+    const std::vector<std::string> * ppaths = &paths;
+    std::vector<HashValue> * presults = &results;
+    std::vector<std::exception_ptr> * perrors = &errors;
+
+    auto work = [state, nfiles, type, ppaths, presults, perrors](void)
+    {
+        std::vector<uint8_t> buffer;
+        std::unique_ptr<HashImpl> impl;
+
+        size_t i;
+        while((i = state->next++) < nfiles)
+        {
+            // Errors are kept for each file, and the file is always counted,
+            // so that the caller doesn't wait forever
+            try {
+                if(!impl)
+                {
+                    buffer.resize(file_batch_buffer_size);
+                    impl = make_hash_impl(type);
+                }
+
+                impl->reset();
+                (*perrors)[i] = hash_file_read_((*ppaths)[i], *impl, buffer.data());
+                if(!(*perrors)[i])
+                    (*presults)[i] = impl->finalize();
+            }
+            catch(...)
+            {
+                (*perrors)[i] = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> l(state->mutex);
+            state->ndone++;
+            state->cv.notify_all();
+        }
+    };
+
+    const size_t njobs = std::min(pool.size(), nfiles - 1);
+    for(size_t j = 0; j < njobs; j++)
+        pool.submit(work);
+    work();
+
+    std::unique_lock<std::mutex> l(state->mutex);
+    state->cv.wait(l, [&state, nfiles]{ return state->ndone == nfiles; });
+}
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+bool file_batch_uring_available(void)
+{
+#ifdef BPHASH_HAVE_IO_URING
+    static const bool available = IOUring(1).valid();
+    return available;
+#else
+    return false;
+#endif
+}
+
+
+std::vector<HashValue> hash_files(const std::vector<std::string> & paths, HashType type,
+                                  FileBatchEngine engine, ThreadPool & pool)
+{
+    std::vector<HashValue> results(paths.size());
+    std::vector<std::exception_ptr> errors(paths.size());
+
+    if(paths.empty())
+        return results;
+
+    bool done = false;
+
+#ifdef BPHASH_HAVE_IO_URING
+    if(engine != FileBatchEngine::Threads)
+        done = hash_files_uring_(paths, type, results, errors);
+#endif
+
+    if(!done)
+    {
+        if(engine == FileBatchEngine::IOUring)
+            throw std::system_error(ENOSYS, std::generic_category(), "io_uring is not available");
+
+        hash_files_threads_(paths, type, pool, results, errors);
+    }
+
+    rethrow_first_(errors);
+    return results;
+}
+
+} // close namespace detail
+
+
+std::vector<HashValue> hash_files(const std::vector<std::string> & paths, HashType type)
+{
+    using namespace detail;
+
+    if(file_batch_uring_available())
+    {
+        ThreadPool nopool(0);
+        return hash_files(paths, type, FileBatchEngine::Auto, nopool);
+    }
+
+    return hash_files(paths, type, FileBatchEngine::Threads, default_thread_pool());
+}
+
+
+} // close namespace bphash
+
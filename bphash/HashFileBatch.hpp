@@ -0,0 +1,89 @@
+/*! \file
+ * \brief Hashing of the contents of many files at once (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hasher.hpp"
+
+#include <string>
+#include <vector>
+
+namespace bphash {
+
+namespace detail {
+
+class ThreadPool;
+
+
+/*! \brief How the files of a batch are read */
+enum class FileBatchEngine
+{
+    Auto,     //!< io_uring if the system supports it, otherwise threads
+    IOUring,  //!< Submit all the reads through a single io_uring
+    Threads   //!< Read the files with blocking calls from a pool of threads
+};
+
+
+//! Number of files being read at the same time by the io_uring engine
+static const size_t file_batch_depth = 64;
+
+//! Size of the buffer each file is read into (per file in flight)
+static const size_t file_batch_buffer_size = 128*1024;
+
+
+/*! \brief Can the io_uring engine be used on this system?
+ *
+ * This checks that the kernel supports io_uring and
+ * the operations needed (open, read, and close).
+ * The result is determined once and then cached.
+ */
+bool file_batch_uring_available(void);
+
+
+/*! \brief Hash the contents of many files, with a given engine
+ *
+ * \throw std::system_error if the engine is not available, or if
+ *        any of the files can't be opened or read
+ *
+ * \param [in] paths Paths to the files
+ * \param [in] type The type of hash to use
+ * \param [in] engine How the files are read
+ * \param [in] pool Threads to use for FileBatchEngine::Threads
+ * \return Hashes of the contents of each file, in the same order as \p paths
+ */
+std::vector<HashValue> hash_files(const std::vector<std::string> & paths, HashType type,
+                                  FileBatchEngine engine, ThreadPool & pool);
+
+} // close namespace detail
+
+
+/*! \brief Hash the contents of many files
+ *
+ * Each file is hashed the same way as hash_file(), so
+ * `hash_files(paths, type)[i] == hash_file(paths[i], type)`.
+ *
+ * This is meant for hashing many (small) files, where the cost is in
+ * the system calls rather than the hashing. Where available (Linux 5.6 and later),
+ * the opens, reads, and closes for many files are submitted together through
+ * io_uring. Otherwise, the files are read by the default thread pool.
+ *
+ * If any file can't be hashed, an exception is thrown for the first
+ * such file (in the order given) after all the files have been processed.
+ *
+ * \throw std::system_error if any of the files can't be opened or read
+ *
+ * \param [in] paths Paths to the files
+ * \param [in] type The type of hash to use
+ * \return Hashes of the contents of each file, in the same order as \p paths
+ */
+std::vector<HashValue> hash_files(const std::vector<std::string> & paths, HashType type);
+
+
+} // close namespace bphash
+
@@ -10,6 +10,9 @@
 #pragma once
 
 #include "bphash/Hash.hpp"
+#include "bphash/Instrumentation.hpp"
+
+#include <memory>
 
 namespace bphash {
 namespace detail {
@@ -31,6 +34,25 @@ class HashImpl
         virtual void update(void const * data, size_t nbytes) = 0;
 
 
+        /*! \brief Size of the hash produced by this implementation (in bytes) */
+        virtual size_t hash_size(void) const = 0;
+
+
+        /*! \brief Finish hashing and write the hash to a buffer
+         *
+         * Finish hashing any remaining data if necessary, and perform
+         * and last steps. Then, write the hash to \p out.
+         *
+         * This does not change the state of the hash. More data may be
+         * added afterwards, and the next call gives the hash of all the data
+         * added since construction or the last reset().
+         *
+         * \param [out] out Where to write the hash. Must be able to hold
+         *                  hash_size() bytes.
+         */
+        virtual void finalize_into(uint8_t * out) const = 0;
+
+
         /*! \brief Finish hashing and report the hash
          *
          * Finish hashing any remaining data if necessary, and perform
@@ -38,7 +60,13 @@ class HashImpl
          *
          * \return The computed hash of all the data that had been added
          */
-        virtual HashValue finalize(void) = 0;
+        HashValue finalize(void) const
+        {
+            BPHASH_INSTRUMENT_FINALIZE();
+            HashValue hv(hash_size());
+            finalize_into(hv.data());
+            return hv;
+        }
 
 
         /*! \brief Zero out the hash
@@ -49,6 +77,14 @@ class HashImpl
         virtual void reset(void) = 0;
 
 
+        /*! \brief Create an independent copy of this implementation
+         *
+         * The copy includes all the data added so far, so that
+         * the copy and the original may continue with different data.
+         */
+        virtual std::unique_ptr<HashImpl> clone(void) const = 0;
+
+
         virtual ~HashImpl() = default;
 };
 
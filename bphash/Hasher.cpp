@@ -14,34 +14,121 @@
 #include "MurmurHash3_64_x64.hpp"
 #include "MurmurHash3_32_x64.hpp"
 #include "MurmurHash3_32_x32.hpp"
+#include "TreeHash.hpp"
+#include "XXH3_64.hpp"
+#include "XXH3_128.hpp"
+#include "CRC32C.hpp"
 
 namespace bphash {
 
-Hasher::Hasher(HashType type)
+namespace detail {
+
+std::unique_ptr<HashImpl> make_hash_impl(HashType type)
 {
     switch(type)
     {
         case HashType::Hash128:
         case HashType::Hash128_x32:
         case HashType::Hash128_x64:
-            hashimpl_ = std::unique_ptr<detail::HashImpl>(new detail::MurmurHash3_128_x64);
-            break;
+            return std::unique_ptr<HashImpl>(new MurmurHash3_128_x64);
 
         case HashType::Hash64:
         case HashType::Hash64_x32:
         case HashType::Hash64_x64:
-            hashimpl_ = std::unique_ptr<detail::HashImpl>(new detail::MurmurHash3_64_x64);
-            break;
+            return std::unique_ptr<HashImpl>(new MurmurHash3_64_x64);
 
         case HashType::Hash32:
         case HashType::Hash32_x64:
-            hashimpl_ = std::unique_ptr<detail::HashImpl>(new detail::MurmurHash3_32_x64);
-            break;
+            return std::unique_ptr<HashImpl>(new MurmurHash3_32_x64);
 
         case HashType::Hash32_x32:
-            hashimpl_ = std::unique_ptr<detail::HashImpl>(new detail::MurmurHash3_32_x32);
-            break;
+            return std::unique_ptr<HashImpl>(new MurmurHash3_32_x32);
+
+        case HashType::Hash128_tree:
+            return std::unique_ptr<HashImpl>(new TreeHash);
+
+        case HashType::Hash64_xxh3:
+            return std::unique_ptr<HashImpl>(new XXH3_64);
+
+        case HashType::Hash128_xxh3:
+            return std::unique_ptr<HashImpl>(new XXH3_128);
+
+        case HashType::CRC32C:
+            return std::unique_ptr<HashImpl>(new CRC32C);
     }
+
+    return nullptr;
+}
+
+} // close namespace detail
+
+
+Hasher::Hasher(HashType type)
+    : owned_hashimpl_(detail::make_hash_impl(type)),
+      hashimpl_(owned_hashimpl_.get()),
+      nstage_(0)
+{ }
+
+
+Hasher::Hasher(const Hasher & rhs)
+    : owned_hashimpl_(rhs.hashimpl_->clone()),
+      hashimpl_(owned_hashimpl_.get()),
+      nstage_(rhs.nstage_)
+{
+    std::copy(rhs.stage_.begin(), rhs.stage_.begin() + nstage_, stage_.begin());
+}
+
+
+Hasher & Hasher::operator=(const Hasher & rhs)
+{
+    if(this == &rhs)
+        return *this;
+
+    // Wrapping an implementation we don't own? Make sure it
+    // gets everything before we are overwritten
+    if(!owned_hashimpl_)
+        flush_();
+
+    owned_hashimpl_ = rhs.hashimpl_->clone();
+    hashimpl_ = owned_hashimpl_.get();
+    nstage_ = rhs.nstage_;
+    std::copy(rhs.stage_.begin(), rhs.stage_.begin() + nstage_, stage_.begin());
+    return *this;
+}
+
+
+Hasher::Hasher(Hasher && rhs)
+    : owned_hashimpl_(std::move(rhs.owned_hashimpl_)),
+      hashimpl_(rhs.hashimpl_),
+      nstage_(rhs.nstage_)
+{
+    std::copy(rhs.stage_.begin(), rhs.stage_.begin() + nstage_, stage_.begin());
+    rhs.nstage_ = 0;
+}
+
+
+Hasher & Hasher::operator=(Hasher && rhs)
+{
+    // Wrapping an implementation we don't own? Make sure it
+    // gets everything before we are overwritten
+    if(!owned_hashimpl_)
+        flush_();
+
+    owned_hashimpl_ = std::move(rhs.owned_hashimpl_);
+    hashimpl_ = rhs.hashimpl_;
+    nstage_ = rhs.nstage_;
+    std::copy(rhs.stage_.begin(), rhs.stage_.begin() + nstage_, stage_.begin());
+    rhs.nstage_ = 0;
+    return *this;
+}
+
+
+Hasher::~Hasher(void)
+{
+    // If we are wrapping an implementation we don't own,
+    // it must get all the data we have buffered
+    if(!owned_hashimpl_)
+        flush_();
 }
 
 
@@ -14,8 +14,10 @@
 
 
 #include <typeinfo>
-#include <cstring>  // for strlen
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <array>
 
 
 namespace bphash {
@@ -35,9 +37,51 @@ enum class HashType
     Hash32_x64,   //!< Default 32-bit hash for x86-64
     Hash64_x64,   //!< Default 64-bit hash for x86-64
     Hash128_x64,  //!< Default 128-bit hash for x86-64
+
+    Hash128_tree, //!< 128-bit tree hash, computed in parallel (see detail::TreeHash)
+
+    Hash64_xxh3,  //!< 64-bit XXH3 hash (fast for both short and long inputs)
+    Hash128_xxh3, //!< 128-bit XXH3 hash (fast for both short and long inputs)
+
+    CRC32C,       //!< CRC32C checksum (not a good general-purpose hash, see detail::CRC32C)
 };
 
 
+namespace detail {
+
+/*! \brief Create the hash algorithm used for a type of hash */
+std::unique_ptr<HashImpl> make_hash_impl(HashType type);
+
+
+/*! \brief 64-bit FNV-1a hash of a null-terminated string */
+inline uint64_t fnv1a_64(const char * str)
+{
+    uint64_t h = UINT64_C(14695981039346656037);
+    for(; *str != '\0'; str++)
+    {
+        h ^= static_cast<uint8_t>(*str);
+        h *= UINT64_C(1099511628211);
+    }
+    return h;
+}
+
+
+/*! \brief A 64-bit tag identifying a type
+ *
+ * This is a hash of `typeid(T).name()`, which is computed the first
+ * time it is needed for each type. Like the name, it may differ
+ * between compilers.
+ */
+template<typename T>
+uint64_t type_tag(void)
+{
+    static const uint64_t tag = fnv1a_64(typeid(T).name());
+    return tag;
+}
+
+} // close namespace detail
+
+
 
 /*! \brief Wrapper for pointers and arrays
  *
@@ -71,26 +115,24 @@ PointerWrapper<T> hash_pointer(const T * ptr, size_t len = 1)
 
 
 
-/*! \brief Class that is used to hash objects
+namespace detail {
+
+/*! \brief Common object hashing for Hasher and BasicHasher
+ *
+ * This contains all the logic for breaking down objects into raw bytes.
+ * The derived class only has to provide `update_raw_()`, which adds raw
+ * bytes to the underlying hash algorithm, and `make_adapter_()`,
+ * which returns a Hasher that feeds the same hash algorithm.
  *
- * Data is added via operator(). 
+ * The adapter is used for objects whose `hash()` member function or
+ * `hash_object()` free function only accept a plain Hasher.
+ *
+ * \tparam Derived The class deriving from this one
  */
-class Hasher
+template<typename Derived>
+class HasherBase
 {
     public:
-        /*! \brief Constructor
-         *
-         * \param[in] type Type of hasher to use
-         */
-        Hasher(HashType type);
-
-        // not copyable or assignable
-        Hasher(const Hasher &)             = delete;
-        Hasher & operator=(const Hasher &) = delete;
-        Hasher(Hasher &&)                  = default;
-        Hasher & operator=(Hasher &&)      = default;
-
-
         /*! \brief Add an object to the hash
          *
          * Objects are progressively hashed until finalize() is called
@@ -119,9 +161,8 @@ class Hasher
 
             // Now hash the type of the object (if enabled)
             #ifdef BPHASH_USE_TYPEID
-            const char * typestr = typeid(T).name();
-            size_t len = strlen(typestr);
-            hashimpl_->update(typestr, len);
+            const uint64_t tag = detail::type_tag<T>();
+            update_(&tag, sizeof(uint64_t));
             #endif
 
             // and the rest
@@ -129,17 +170,21 @@ class Hasher
         }
 
 
-        /*! \brief Perform any remaining steps and return the hash */
-        HashValue finalize(void)
+    private:
+
+        /*! \brief Obtain the derived object */
+        Derived & derived_(void)
         {
-            return hashimpl_->finalize();
+            return static_cast<Derived &>(*this);
         }
 
 
-    private:
-
-        //! Internal hasher object
-        std::unique_ptr<detail::HashImpl> hashimpl_;
+        /*! \brief Add raw data to the hash */
+        void update_(void const * data, size_t nbytes)
+        {
+            BPHASH_INSTRUMENT_UPDATE(nbytes);
+            derived_().update_raw_(data, nbytes);
+        }
 
 
         /*! \brief Hash a single fundamental type */
@@ -148,8 +193,8 @@ class Hasher
         hash_single_(const T & obj)
         {
             size_t size = sizeof(T);
-            hashimpl_->update(&size, sizeof(size_t));
-            hashimpl_->update(&obj, size);
+            update_(&size, sizeof(size_t));
+            update_(&obj, size);
         }
 
         /*! \brief Hash a single enum object */
@@ -163,19 +208,38 @@ class Hasher
 
         /*! \brief Hash an object with an appropriate `hash()` member function */
         template<typename T>
-        auto hash_single_(const T & obj)
-        -> decltype(static_cast<void (T::*)(Hasher &) const>(&T::hash), void())
+        typename std::enable_if<detect_hash_member<T>::value, void>::type
+        hash_single_(const T & obj)
         {
-            obj.hash(*this);
+            hash_member_(obj, 0);
         }
 
 
         /*! \brief Hash an object with an appropriate `hash_object()` free function */
         template<typename T>
-        auto hash_single_(const T & obj)
-        -> decltype( hash_object( std::declval<const T &>(), std::declval<Hasher &>() ), void())
+        typename std::enable_if<detect_hash_free_function<T>::value, void>::type
+        hash_single_(const T & obj)
+        {
+            hash_free_(obj, 0);
+        }
+
+
+        /*! \brief Hash a single object via its raw bytes
+         *
+         * This is only used for types declared to be contiguously
+         * hashable that do not have their own hashing functions.
+         */
+        template<typename T>
+        typename std::enable_if<is_contiguously_hashable<T>::value &&
+                                !std::is_fundamental<T>::value &&
+                                !std::is_enum<T>::value &&
+                                !detect_hash_member<T>::value &&
+                                !detect_hash_free_function<T>::value, void>::type
+        hash_single_(const T & obj)
         {
-            hash_object(obj, *this);
+            size_t size = sizeof(T);
+            update_(&size, sizeof(size_t));
+            update_(&obj, size);
         }
 
 
@@ -190,27 +254,30 @@ class Hasher
         }
 
 
-        /*! \brief Hash a wrapped pointer  to a fundamental type */
+        /*! \brief Hash a wrapped pointer to a contiguously-hashable type
+         *
+         * All the data is hashed as a single block of memory
+         */
         template<typename T>
-        typename std::enable_if<std::is_fundamental<T>::value, void>::type
+        typename std::enable_if<is_contiguously_hashable<T>::value, void>::type
         hash_single_(const PointerWrapper<T> & pw)
         {
             if(pw.ptr != nullptr)
             {
                 // we add the data first, then the size
-                hashimpl_->update(pw.ptr, pw.len * sizeof(T));
-                hashimpl_->update(&pw.len, sizeof(pw.len));
+                update_(pw.ptr, pw.len * sizeof(T));
+                update_(&pw.len, sizeof(pw.len));
             }
             else
             {
                 size_t n = 0;
-                hashimpl_->update(&n, sizeof(size_t));
+                update_(&n, sizeof(size_t));
             }
         }
 
-        /*! \brief Hash a wrapped pointer that does not point to a fundamental type */
+        /*! \brief Hash a wrapped pointer that does not point to a contiguously-hashable type */
         template<typename T>
-        typename std::enable_if<!std::is_fundamental<T>::value, void>::type
+        typename std::enable_if<!is_contiguously_hashable<T>::value, void>::type
         hash_single_(const PointerWrapper<T> & pw)
         {
             if(pw.ptr != nullptr)
@@ -219,16 +286,28 @@ class Hasher
                 for(size_t i = 0; i < pw.len; i++)
                     hash_single_(pw.ptr[i]); 
 
-                hashimpl_->update(&pw.len, sizeof(pw.len));
+                update_(&pw.len, sizeof(pw.len));
             }
             else
             {
                 size_t n = 0;
-                hashimpl_->update(&n, sizeof(size_t));
+                update_(&n, sizeof(size_t));
             }
         }
 
 
+        /*! \brief Hash an object whose hash is cached
+         *
+         * Only the cached digest is added, rather than the entire object.
+         */
+        template<typename T>
+        void hash_single_(const CachedHash<T> & obj)
+        {
+            const Digest128 d = obj.digest();
+            update_(d.data(), d.size());
+        }
+
+
         /*! \brief Hashing of a C-style string
          *
          * It is assumed that the pointer points to a null-terminated
@@ -239,6 +318,220 @@ class Hasher
         {
             (*this)(hash_pointer(p, strlen(p)));
         }
+
+
+        /*! \brief Call a `hash()` member function that accepts the derived type */
+        template<typename T>
+        auto hash_member_(const T & obj, int)
+        -> decltype(static_cast<void (T::*)(Derived &) const>(&T::hash), void())
+        {
+            obj.hash(derived_());
+        }
+
+        /*! \brief Call a `hash()` member function that only accepts a Hasher */
+        template<typename T>
+        void hash_member_(const T & obj, long)
+        {
+            Hasher adapter = derived_().make_adapter_();
+            obj.hash(adapter);
+        }
+
+
+        /*! \brief Call a `hash_object()` free function that accepts the derived type */
+        template<typename T>
+        auto hash_free_(const T & obj, int)
+        -> decltype( hash_object( obj, std::declval<Derived &>() ), void())
+        {
+            hash_object(obj, derived_());
+        }
+
+        /*! \brief Call a `hash_object()` free function that only accepts a Hasher */
+        template<typename T>
+        void hash_free_(const T & obj, long)
+        {
+            Hasher adapter = derived_().make_adapter_();
+            hash_object(obj, adapter);
+        }
+};
+
+} // close namespace detail
+
+
+
+/*! \brief Class that is used to hash objects
+ *
+ * Data is added via operator(). The hash algorithm is
+ * selected at runtime. For a hasher where the algorithm is
+ * known at compile time, see BasicHasher.
+ *
+ * Small pieces of data (such as individual integers) are collected
+ * in an internal buffer and passed to the hash algorithm together.
+ * This does not change the resulting hash.
+ */
+class Hasher : public detail::HasherBase<Hasher>
+{
+    public:
+        /*! \brief Constructor
+         *
+         * \param[in] type Type of hasher to use
+         */
+        Hasher(HashType type);
+
+        /*! \brief Copy a hasher, including all the data added so far
+         *
+         * The copy is independent of the original, and each may
+         * continue with different data. The copy always owns its
+         * hash algorithm.
+         */
+        Hasher(const Hasher & rhs);
+        Hasher & operator=(const Hasher & rhs);
+
+        Hasher(Hasher && rhs);
+        Hasher & operator=(Hasher && rhs);
+
+        ~Hasher(void);
+
+
+        /*! \brief Create an independent copy of this hasher
+         *
+         * This is useful when many objects share a common beginning.
+         * The beginning can be hashed once, and then the hasher cloned
+         * for each object.
+         */
+        Hasher clone(void) const
+        {
+            return Hasher(*this);
+        }
+
+
+        /*! \brief Obtain the hash of all the data added so far
+         *
+         * This does not change the state of the hash, so more data
+         * may be added afterwards.
+         */
+        HashValue peek(void)
+        {
+            flush_();
+            return hashimpl_->finalize();
+        }
+
+
+        /*! \brief Obtain the hash of all the data added so far, as a fixed-size digest
+         *
+         * If \p N does not match the size of the hash, the hash is
+         * truncated or padded with zeroes (see truncate_hash).
+         *
+         * This does not change the state of the hash, so more data
+         * may be added afterwards.
+         *
+         * \tparam N Size of the digest (in bytes)
+         */
+        template<size_t N>
+        Digest<N> peek_digest(void)
+        {
+            flush_();
+
+            if(hashimpl_->hash_size() != N)
+                return to_digest<N>(hashimpl_->finalize());
+
+            BPHASH_INSTRUMENT_FINALIZE();
+            Digest<N> ret;
+            hashimpl_->finalize_into(ret.data());
+            return ret;
+        }
+
+
+        /*! \brief Perform any remaining steps and return the hash
+         *
+         * This is the same as peek(). The hasher may still be used afterwards.
+         */
+        HashValue finalize(void)
+        {
+            return peek();
+        }
+
+
+        /*! \brief Perform any remaining steps and return the hash as a fixed-size digest
+         *
+         * This is the same as peek_digest(). The hasher may still be used afterwards.
+         *
+         * \tparam N Size of the digest (in bytes)
+         */
+        template<size_t N>
+        Digest<N> finalize_digest(void)
+        {
+            return peek_digest<N>();
+        }
+
+
+    private:
+        friend class detail::HasherBase<Hasher>;
+        template<typename Algorithm> friend class BasicHasher;
+
+        //! Internal hasher object (if owned by this object)
+        std::unique_ptr<detail::HashImpl> owned_hashimpl_;
+
+        //! Hasher object that is actually used
+        detail::HashImpl * hashimpl_;
+
+        //! Data waiting to be passed to the hasher object
+        std::array<uint8_t, 256> stage_;
+
+        //! Number of bytes in stage_ (never more than stage_.size())
+        size_t nstage_;
+
+
+        /*! \brief Create a hasher that uses an existing implementation
+         *
+         * The implementation is not owned by this object, and
+         * must outlive it. Any buffered data is passed to the
+         * implementation when this object is destroyed.
+         */
+        explicit Hasher(detail::HashImpl & impl)
+            : hashimpl_(&impl), nstage_(0)
+        { }
+
+
+        /*! \brief Add raw data to the hash
+         *
+         * Data is copied to the staging buffer if it fits. Otherwise,
+         * the buffer is flushed, and the data is either buffered or (if large)
+         * passed directly to the hasher object.
+         */
+        void update_raw_(void const * data, size_t nbytes)
+        {
+            if(nstage_ + nbytes <= stage_.size())
+            {
+                std::memcpy(stage_.data() + nstage_, data, nbytes);
+                nstage_ += nbytes;
+                return;
+            }
+
+            flush_();
+
+            if(nbytes < stage_.size())
+            {
+                std::memcpy(stage_.data(), data, nbytes);
+                nstage_ = nbytes;
+            }
+            else
+            {
+                BPHASH_INSTRUMENT_IMPL_UPDATE(nbytes);
+                hashimpl_->update(data, nbytes);
+            }
+        }
+
+
+        /*! \brief Pass any data in the staging buffer to the hasher object */
+        void flush_(void)
+        {
+            if(nstage_ != 0)
+            {
+                BPHASH_INSTRUMENT_IMPL_UPDATE(nstage_);
+                hashimpl_->update(stage_.data(), nstage_);
+                nstage_ = 0;
+            }
+        }
 };
 
 
@@ -255,6 +548,7 @@ class Hasher
 template<typename ... Targs>
 HashValue make_hash(HashType type, const Targs &... objs)
 {
+    BPHASH_INSTRUMENT_MAKE_HASH();
     Hasher hasher(type);
     hasher(objs...);
     return hasher.finalize();
@@ -277,6 +571,7 @@ HashValue make_hash(HashType type, const Targs &... objs)
 template<typename InputIterator>
 HashValue make_hash_range(HashType type, InputIterator first, InputIterator last)
 {
+    BPHASH_INSTRUMENT_MAKE_HASH();
     Hasher hasher(type);
 
     for(auto it = first; it != last; ++it)
@@ -14,12 +14,18 @@ namespace bphash {
 
 class Hasher;
 
+template<typename Algorithm> class BasicHasher;
+
 template<typename T> struct PointerWrapper;
 
+template<typename T> class CachedHash;
+
 namespace detail {
 
 template <typename T> class detect_hash_member;
 
+template <typename Derived> class HasherBase;
+
 }
 
 
@@ -30,6 +36,8 @@ template <typename T> class detect_hash_member;
  */
 #define BPHASH_DECLARE_HASHING_FRIENDS \
     friend class bphash::Hasher;\
+    template<typename A__> friend class bphash::BasicHasher;\
+    template<typename D__> friend class bphash::detail::HasherBase;\
     template<typename T__> friend class bphash::detail::detect_hash_member;
 
 
@@ -0,0 +1,213 @@
+/*! \file
+ * \brief Optional counters for how the hashers are used (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/Instrumentation.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace bphash {
+namespace detail {
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+/* All the threads with counters, and the totals of threads that have exited */
+struct CounterRegistry
+{
+    std::mutex mutex;
+    std::vector<ThreadCounters *> threads;
+    std::array<uint64_t, ThreadCounters::NCounters> retired;
+};
+
+
+static void dump_at_exit_(void)
+{
+    const char * path = std::getenv("BPHASH_INSTRUMENT_FILE");
+    if(path != nullptr && *path != '\0')
+    {
+        try {
+            write_instrumentation(path);
+        }
+        catch(...)
+        {
+            // Nothing to be done at this point
+        }
+    }
+}
+
+
+static CounterRegistry & registry_(void)
+{
+    // Never destroyed, since threads may exit (and use this)
+    // during the destruction of static objects
+    static CounterRegistry * reg = []
+    {
+        CounterRegistry * r = new CounterRegistry;
+        r->retired.fill(0);
+        std::atexit(dump_at_exit_);
+        return r;
+    }();
+
+    return *reg;
+}
+
+
+/* Combine a counter from another set of counts */
+static void combine_(size_t counter, uint64_t value, uint64_t & total)
+{
+    if(counter == ThreadCounters::MakeHashMaxNs)
+        total = std::max(total, value);
+    else
+        total += value;
+}
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+ThreadCounters::ThreadCounters(void)
+{
+    clear();
+
+    CounterRegistry & reg = registry_();
+    std::lock_guard<std::mutex> l(reg.mutex);
+    reg.threads.push_back(this);
+}
+
+
+ThreadCounters::~ThreadCounters(void)
+{
+    CounterRegistry & reg = registry_();
+    std::lock_guard<std::mutex> l(reg.mutex);
+
+    for(size_t i = 0; i < NCounters; i++)
+        combine_(i, get(i), reg.retired[i]);
+
+    reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+}
+
+
+void ThreadCounters::clear(void)
+{
+    for(auto & c : counts_)
+        c.store(0, std::memory_order_relaxed);
+}
+
+} // close namespace detail
+
+
+InstrumentationSnapshot instrumentation_snapshot(void)
+{
+    using detail::ThreadCounters;
+
+    std::array<uint64_t, ThreadCounters::NCounters> totals;
+    totals.fill(0);
+
+    InstrumentationSnapshot snap;
+
+#ifdef BPHASH_INSTRUMENT
+    snap.enabled = true;
+
+    detail::CounterRegistry & reg = detail::registry_();
+    {
+        std::lock_guard<std::mutex> l(reg.mutex);
+        totals = reg.retired;
+        for(const ThreadCounters * t : reg.threads)
+        {
+            for(size_t i = 0; i < ThreadCounters::NCounters; i++)
+                detail::combine_(i, t->get(i), totals[i]);
+        }
+    }
+#else
+    snap.enabled = false;
+#endif
+
+    snap.update_calls = totals[ThreadCounters::UpdateCalls];
+    snap.update_bytes = totals[ThreadCounters::UpdateBytes];
+    snap.impl_update_calls = totals[ThreadCounters::ImplUpdateCalls];
+    snap.carry_events = totals[ThreadCounters::CarryEvents];
+    snap.finalize_calls = totals[ThreadCounters::FinalizeCalls];
+    snap.make_hash_calls = totals[ThreadCounters::MakeHashCalls];
+    snap.make_hash_sampled = totals[ThreadCounters::MakeHashSampled];
+    snap.make_hash_total_ns = totals[ThreadCounters::MakeHashTotalNs];
+    snap.make_hash_max_ns = totals[ThreadCounters::MakeHashMaxNs];
+
+    for(size_t i = 0; i < instrument_nbuckets; i++)
+    {
+        snap.update_sizes[i] = totals[ThreadCounters::UpdateSizes + i];
+        snap.make_hash_times[i] = totals[ThreadCounters::MakeHashTimes + i];
+    }
+
+    return snap;
+}
+
+
+void reset_instrumentation(void)
+{
+#ifdef BPHASH_INSTRUMENT
+    detail::CounterRegistry & reg = detail::registry_();
+    std::lock_guard<std::mutex> l(reg.mutex);
+
+    reg.retired.fill(0);
+    for(detail::ThreadCounters * t : reg.threads)
+        t->clear();
+#endif
+}
+
+
+void write_instrumentation(std::ostream & os, const InstrumentationSnapshot & snapshot)
+{
+    auto write_histogram = [&os](const std::array<uint64_t, instrument_nbuckets> & h)
+    {
+        os << "[";
+        for(size_t i = 0; i < h.size(); i++)
+            os << (i ? ", " : "") << h[i];
+        os << "]";
+    };
+
+    os << "{\n"
+       << "  \"enabled\": " << (snapshot.enabled ? "true" : "false") << ",\n"
+       << "  \"update_calls\": " << snapshot.update_calls << ",\n"
+       << "  \"update_bytes\": " << snapshot.update_bytes << ",\n"
+       << "  \"update_sizes\": ";
+    write_histogram(snapshot.update_sizes);
+    os << ",\n"
+       << "  \"impl_update_calls\": " << snapshot.impl_update_calls << ",\n"
+       << "  \"carry_events\": " << snapshot.carry_events << ",\n"
+       << "  \"finalize_calls\": " << snapshot.finalize_calls << ",\n"
+       << "  \"make_hash_calls\": " << snapshot.make_hash_calls << ",\n"
+       << "  \"make_hash_sampled\": " << snapshot.make_hash_sampled << ",\n"
+       << "  \"make_hash_total_ns\": " << snapshot.make_hash_total_ns << ",\n"
+       << "  \"make_hash_max_ns\": " << snapshot.make_hash_max_ns << ",\n"
+       << "  \"make_hash_times\": ";
+    write_histogram(snapshot.make_hash_times);
+    os << "\n}\n";
+}
+
+
+void write_instrumentation(const std::string & path)
+{
+    std::ofstream f(path, std::ios::trunc);
+    if(!f)
+        throw std::runtime_error("Cannot open " + path);
+
+    write_instrumentation(f, instrumentation_snapshot());
+}
+
+
+} // close namespace bphash
+
@@ -0,0 +1,285 @@
+/*! \file
+ * \brief Optional counters for how the hashers are used (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+/* Instrumentation is enabled by defining BPHASH_INSTRUMENT (the BPHASH_INSTRUMENT
+ * CMake option). Static probes for tools such as bpftrace, perf, and SystemTap
+ * are enabled by defining BPHASH_INSTRUMENT_USDT (if <sys/sdt.h> is available).
+ * Either may be used without the other. When neither is defined, the
+ * instrumentation points in the library compile to nothing. */
+
+#if defined(BPHASH_INSTRUMENT_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define BPHASH_HAVE_USDT
+#endif
+#endif
+
+//! Time one out of this many calls to make_hash() (per thread)
+#ifndef BPHASH_INSTRUMENT_SAMPLE_RATE
+#define BPHASH_INSTRUMENT_SAMPLE_RATE 64
+#endif
+
+static_assert(BPHASH_INSTRUMENT_SAMPLE_RATE > 0, "BPHASH_INSTRUMENT_SAMPLE_RATE must be positive");
+
+namespace bphash {
+
+//! Number of buckets in each histogram of the instrumentation
+static const size_t instrument_nbuckets = 33;
+
+
+/*! \brief Snapshot of the instrumentation counters
+ *
+ * The counts are summed over all threads, including threads that have
+ * already exited.
+ *
+ * The histograms are by powers of two. Bucket 0 counts values of zero,
+ * and bucket `i` counts values in `[2^(i-1), 2^i)`. The last bucket
+ * also holds anything larger.
+ */
+struct InstrumentationSnapshot
+{
+    bool enabled;                   //!< Was the library built with BPHASH_INSTRUMENT?
+
+    uint64_t update_calls;          //!< Pieces of data given to a Hasher or BasicHasher
+    uint64_t update_bytes;          //!< Total size of that data
+    std::array<uint64_t, instrument_nbuckets> update_sizes; //!< Histogram of the size of each piece (bytes)
+
+    uint64_t impl_update_calls;     //!< Calls to the hash algorithm (after buffering by Hasher)
+    uint64_t carry_events;          //!< MurmurHash3 updates that had to complete a partial block first
+    uint64_t finalize_calls;        //!< Hashes computed (finalize, peek, and similar)
+
+    uint64_t make_hash_calls;       //!< Calls to make_hash()
+    uint64_t make_hash_sampled;     //!< Calls to make_hash() that were timed
+    uint64_t make_hash_total_ns;    //!< Total time of the timed calls (nanoseconds)
+    uint64_t make_hash_max_ns;      //!< Longest timed call (nanoseconds)
+    std::array<uint64_t, instrument_nbuckets> make_hash_times; //!< Histogram of the timed calls (nanoseconds)
+};
+
+
+/*! \brief Obtain the current values of the instrumentation counters
+ *
+ * If the library was built without instrumentation, everything is zero.
+ */
+InstrumentationSnapshot instrumentation_snapshot(void);
+
+
+/*! \brief Set all the instrumentation counters to zero
+ *
+ * This should be called when no other threads are hashing, or
+ * some of their counts may be kept.
+ */
+void reset_instrumentation(void);
+
+
+/*! \brief Write a snapshot of the counters as JSON */
+void write_instrumentation(std::ostream & os, const InstrumentationSnapshot & snapshot);
+
+
+/*! \brief Write the current counters to a file, as JSON
+ *
+ * If the environment variable `BPHASH_INSTRUMENT_FILE` is set,
+ * this is done automatically when the program exits.
+ *
+ * \throw std::runtime_error if the file can't be written
+ */
+void write_instrumentation(const std::string & path);
+
+
+namespace detail {
+
+/*! \brief The power-of-two bucket a value falls into */
+inline size_t instrument_bucket(uint64_t value)
+{
+    size_t b = 0;
+    while(value != 0 && b < instrument_nbuckets - 1)
+    {
+        value >>= 1;
+        b++;
+    }
+    return b;
+}
+
+
+/*! \brief Counters kept by each thread
+ *
+ * Only the owning thread changes the counters, so they are
+ * incremented without locked instructions. They are atomic
+ * only so that they may be read by other threads.
+ */
+class ThreadCounters
+{
+    public:
+        enum Counter
+        {
+            UpdateCalls,
+            UpdateBytes,
+            ImplUpdateCalls,
+            CarryEvents,
+            FinalizeCalls,
+            MakeHashCalls,
+            MakeHashSampled,
+            MakeHashTotalNs,
+            MakeHashMaxNs,
+            UpdateSizes,
+            MakeHashTimes = UpdateSizes + instrument_nbuckets,
+            NCounters = MakeHashTimes + instrument_nbuckets
+        };
+
+
+        /*! \brief Register the counters of a new thread */
+        ThreadCounters(void);
+
+        /*! \brief Add the counts of an exiting thread to the totals */
+        ~ThreadCounters(void);
+
+        ThreadCounters(const ThreadCounters &)             = delete;
+        ThreadCounters & operator=(const ThreadCounters &) = delete;
+
+
+        /*! \brief Add to a counter (must be called from the owning thread) */
+        void add(size_t counter, uint64_t n)
+        {
+            counts_[counter].store(counts_[counter].load(std::memory_order_relaxed) + n,
+                                   std::memory_order_relaxed);
+        }
+
+
+        void count_update(size_t nbytes)
+        {
+            add(UpdateCalls, 1);
+            add(UpdateBytes, nbytes);
+            add(UpdateSizes + instrument_bucket(nbytes), 1);
+        }
+
+
+        /*! \brief Should this call to make_hash() be timed? */
+        bool count_make_hash(void)
+        {
+            add(MakeHashCalls, 1);
+            // The first call, and every SAMPLE_RATE calls after it
+            return (counts_[MakeHashCalls].load(std::memory_order_relaxed) - 1) % BPHASH_INSTRUMENT_SAMPLE_RATE == 0;
+        }
+
+
+        void count_make_hash_time(uint64_t ns)
+        {
+            add(MakeHashSampled, 1);
+            add(MakeHashTotalNs, ns);
+            add(MakeHashTimes + instrument_bucket(ns), 1);
+            if(ns > counts_[MakeHashMaxNs].load(std::memory_order_relaxed))
+                counts_[MakeHashMaxNs].store(ns, std::memory_order_relaxed);
+        }
+
+
+        /*! \brief Read a counter (from any thread) */
+        uint64_t get(size_t counter) const
+        {
+            return counts_[counter].load(std::memory_order_relaxed);
+        }
+
+
+        /*! \brief Set all counters to zero */
+        void clear(void);
+
+
+    private:
+        std::array<std::atomic<uint64_t>, NCounters> counts_;
+};
+
+
+/*! \brief The counters for the calling thread */
+inline ThreadCounters & thread_counters(void)
+{
+    static thread_local ThreadCounters counters;
+    return counters;
+}
+
+
+/*! \brief Times a sample of the calls to make_hash() */
+class MakeHashTimer
+{
+    public:
+        MakeHashTimer(void)
+            : sampled_(thread_counters().count_make_hash())
+        {
+            if(sampled_)
+                start_ = std::chrono::steady_clock::now();
+        }
+
+        ~MakeHashTimer(void)
+        {
+            if(sampled_)
+            {
+                auto elapsed = std::chrono::steady_clock::now() - start_;
+                thread_counters().count_make_hash_time(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        }
+
+        MakeHashTimer(const MakeHashTimer &)             = delete;
+        MakeHashTimer & operator=(const MakeHashTimer &) = delete;
+
+    private:
+        bool sampled_;
+        std::chrono::steady_clock::time_point start_;
+};
+
+} // close namespace detail
+} // close namespace bphash
+
+
+////////////////////////////////
+// Instrumentation points
+////////////////////////////////
+
+#ifdef BPHASH_INSTRUMENT
+    #define BPHASH_COUNTER_(call) ::bphash::detail::thread_counters().call
+    #define BPHASH_INSTRUMENT_MAKE_HASH() ::bphash::detail::MakeHashTimer bphash_make_hash_timer_
+#else
+    #define BPHASH_COUNTER_(call) ((void)0)
+    #define BPHASH_INSTRUMENT_MAKE_HASH() ((void)0)
+#endif
+
+#ifdef BPHASH_HAVE_USDT
+    #define BPHASH_PROBE0_(name) DTRACE_PROBE(bphash, name)
+    #define BPHASH_PROBE1_(name, a) DTRACE_PROBE1(bphash, name, a)
+#else
+    #define BPHASH_PROBE0_(name) ((void)0)
+    #define BPHASH_PROBE1_(name, a) ((void)0)
+#endif
+
+//! Data given to a Hasher or BasicHasher
+#define BPHASH_INSTRUMENT_UPDATE(nbytes) \
+    do { BPHASH_COUNTER_(count_update(nbytes)); BPHASH_PROBE1_(update, nbytes); } while(0)
+
+//! Data given to the hash algorithm
+#define BPHASH_INSTRUMENT_IMPL_UPDATE(nbytes) \
+    do { BPHASH_COUNTER_(add(::bphash::detail::ThreadCounters::ImplUpdateCalls, 1)); \
+         BPHASH_PROBE1_(impl_update, nbytes); } while(0)
+
+//! An update that had to complete a partially-filled block
+#define BPHASH_INSTRUMENT_CARRY(nbuffered) \
+    do { BPHASH_COUNTER_(add(::bphash::detail::ThreadCounters::CarryEvents, 1)); \
+         BPHASH_PROBE1_(carry, nbuffered); } while(0)
+
+//! A hash was computed
+#define BPHASH_INSTRUMENT_FINALIZE() \
+    do { BPHASH_COUNTER_(add(::bphash::detail::ThreadCounters::FinalizeCalls, 1)); \
+         BPHASH_PROBE0_(finalize); } while(0)
+
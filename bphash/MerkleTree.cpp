@@ -0,0 +1,246 @@
+/*! \file
+ * \brief Incremental hashing of large buffers (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/MerkleTree.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace bphash {
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+MerkleTree::MerkleTree(void const * data, size_t nbytes, size_t chunk_size)
+    : MerkleTree(data, nbytes, chunk_size, detail::default_thread_pool())
+{ }
+
+
+MerkleTree::MerkleTree(void const * data, size_t nbytes,
+                       size_t chunk_size, detail::ThreadPool & pool)
+    : data_(static_cast<uint8_t const *>(data)), nbytes_(nbytes),
+      chunk_size_(chunk_size), pool_(&pool), ndirty_(0)
+{
+    if(chunk_size == 0)
+        throw std::invalid_argument("Chunk size of a MerkleTree must not be zero");
+
+    resize_levels_();
+    mark_all_dirty();
+    update();
+}
+
+
+void MerkleTree::mark_dirty(size_t offset, size_t nbytes)
+{
+    if(nbytes == 0 || offset >= nbytes_)
+        return;
+
+    const size_t end = offset + std::min(nbytes, nbytes_ - offset);
+    mark_leaves_(offset / chunk_size_, (end - 1) / chunk_size_);
+}
+
+
+void MerkleTree::mark_all_dirty(void)
+{
+    mark_leaves_(0, nchunks() - 1);
+}
+
+
+void MerkleTree::set_data(void const * data, size_t nbytes)
+{
+    const size_t old_nbytes = nbytes_;
+
+    data_ = static_cast<uint8_t const *>(data);
+    nbytes_ = nbytes;
+
+    if(nbytes == old_nbytes)
+        return;
+
+    resize_levels_();
+
+    // Everything from the old end (or the new end, if smaller) has
+    // changed. This includes the last leaf, so all the nodes whose
+    // children change (the last node of each level) are updated too
+    const size_t first = std::min(old_nbytes, nbytes) / chunk_size_;
+    mark_leaves_(std::min(first, nchunks() - 1), nchunks() - 1);
+}
+
+
+void MerkleTree::update(void)
+{
+    if(ndirty_ == 0)
+        return;
+
+    std::vector<size_t> changed;
+    changed.reserve(ndirty_);
+
+    for(size_t i = 0; i < dirty_.size(); i++)
+    {
+        if(dirty_[i])
+            changed.push_back(i);
+    }
+
+    hash_leaves_(changed);
+
+    // Go up the tree, recomputing the parents of anything that changed
+    for(size_t l = 1; l < levels_.size(); l++)
+    {
+        const std::vector<Digest128> & below = levels_[l-1];
+        std::vector<Digest128> & level = levels_[l];
+
+        size_t nparents = 0;
+        for(size_t i : changed)
+        {
+            const size_t p = i / 2;
+            if(nparents > 0 && changed[nparents-1] == p)
+                continue;
+
+            changed[nparents++] = p;
+
+            // The last node may not have a sibling, in
+            // which case it is moved up unchanged
+            if(2*p + 1 < below.size())
+                detail::TreeHash::hash_node(below[2*p], below[2*p+1], level[p]);
+            else
+                level[p] = below[2*p];
+        }
+
+        changed.resize(nparents);
+    }
+
+    detail::TreeHash::hash_root(levels_.back()[0], nbytes_, digest_.data());
+
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    ndirty_ = 0;
+}
+
+
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+void MerkleTree::resize_levels_(void)
+{
+    // Empty data is a single, empty chunk
+    size_t n = std::max<size_t>(1, (nbytes_ + chunk_size_ - 1) / chunk_size_);
+
+    dirty_.resize(n, 0);
+    ndirty_ = static_cast<size_t>(std::count(dirty_.begin(), dirty_.end(), 1));
+
+    // Existing digests are kept. Any that are no longer
+    // valid are above a leaf that is marked dirty
+    size_t nlevels = 0;
+
+    for(;;)
+    {
+        if(levels_.size() <= nlevels)
+            levels_.emplace_back();
+
+        levels_[nlevels++].resize(n);
+
+        if(n == 1)
+            break;
+
+        n = (n + 1) / 2;
+    }
+
+    levels_.resize(nlevels);
+}
+
+
+void MerkleTree::mark_leaves_(size_t first, size_t last)
+{
+    for(size_t i = first; i <= last; i++)
+    {
+        if(!dirty_[i])
+        {
+            dirty_[i] = 1;
+            ndirty_++;
+        }
+    }
+}
+
+
+void MerkleTree::hash_leaves_(const std::vector<size_t> & leaves)
+{
+    std::vector<Digest128> & digests = levels_[0];
+
+    auto hash_range = [this, &leaves, &digests](size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; i++)
+        {
+            const size_t leaf = leaves[i];
+            const size_t offset = leaf * chunk_size_;
+            const size_t len = std::min(chunk_size_, nbytes_ - std::min(offset, nbytes_));
+            detail::TreeHash::hash_leaf(data_ + offset, len, digests[leaf]);
+        }
+    };
+
+    // Split into a few blocks per thread, so that the
+    // work stays balanced without too much overhead
+    const size_t nblocks = std::min(leaves.size(), 4 * pool_->size());
+
+    if(nblocks <= 1)
+    {
+        hash_range(0, leaves.size());
+        return;
+    }
+
+    // Shared with the jobs, which may start after all the blocks
+    // are finished (and this function has returned). A job only
+    // uses hash_range after claiming a block, which is waited for.
+    struct State
+    {
+        std::atomic<size_t> next;   // Next block to be claimed
+        size_t ndone;               // Number of blocks finished
+
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->next = 0;
+    state->ndone = 0;
+
+    const size_t nleaves = leaves.size();
+    auto * range = &hash_range;
+
+    auto work = [state, range, nblocks, nleaves](void)
+    {
+        size_t b;
+        while((b = state->next++) < nblocks)
+        {
+            (*range)((nleaves * b) / nblocks, (nleaves * (b+1)) / nblocks);
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->ndone++;
+            state->cv.notify_all();
+        }
+    };
+
+    // The calling thread hashes blocks as well, and then only waits for
+    // blocks that a worker has started. So this can't deadlock if
+    // called from a job running on the same pool.
+    for(size_t j = 1; j < nblocks; j++)
+        pool_->submit(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state, nblocks] { return state->ndone == nblocks; });
+}
+
+
+} // close namespace bphash
+
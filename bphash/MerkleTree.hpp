@@ -0,0 +1,155 @@
+/*! \file
+ * \brief Incremental hashing of large buffers (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hash.hpp"
+#include "bphash/Hasher.hpp"
+#include "bphash/ThreadPool.hpp"
+#include "bphash/TreeHash.hpp"
+
+#include <vector>
+
+namespace bphash {
+
+
+/*! \brief Hash of a large buffer that is kept up to date as parts of it change
+ *
+ * The buffer is split into chunks, whose digests are kept in a binary
+ * (Merkle) tree. When part of the buffer changes, the changed bytes are marked
+ * with mark_dirty(), and update() then rehashes only the affected chunks
+ * and the nodes of the tree above them.
+ *
+ * The tree is defined the same way as for detail::TreeHash. With the
+ * default chunk size, the hash is the same as that of HashType::Hash128_tree
+ * over the raw bytes of the buffer.
+ *
+ * The buffer is not copied, and must stay valid while this object
+ * is in use. If the buffer moves or changes size (for example, when
+ * a `std::vector` is resized), set_data() must be called.
+ */
+class MerkleTree
+{
+    public:
+        /*! \brief Hash a buffer, using the default thread pool
+         *
+         * \param [in] data The buffer to hash
+         * \param [in] nbytes Size of the buffer (in bytes)
+         * \param [in] chunk_size Size of each chunk (leaf of the tree). Must not be zero
+         */
+        MerkleTree(void const * data, size_t nbytes,
+                   size_t chunk_size = detail::TreeHash::chunk_size);
+
+
+        /*! \brief Hash a buffer, using the given thread pool
+         *
+         * The pool must outlive this object.
+         *
+         * \copydetails MerkleTree(void const *, size_t, size_t)
+         */
+        MerkleTree(void const * data, size_t nbytes,
+                   size_t chunk_size, detail::ThreadPool & pool);
+
+
+        /*! \brief Mark a range of bytes of the buffer as changed
+         *
+         * The hash is not updated until update() is called. Bytes
+         * beyond the end of the buffer are ignored.
+         *
+         * \param [in] offset Start of the range (in bytes)
+         * \param [in] nbytes Length of the range (in bytes)
+         */
+        void mark_dirty(size_t offset, size_t nbytes);
+
+
+        /*! \brief Mark the entire buffer as changed */
+        void mark_all_dirty(void);
+
+
+        /*! \brief Change the location or size of the buffer
+         *
+         * If the size changes, the chunks from the old end of the
+         * buffer onward are marked as changed. Otherwise, nothing is
+         * marked, and changed bytes must still be marked with mark_dirty().
+         */
+        void set_data(void const * data, size_t nbytes);
+
+
+        /*! \brief Rehash any changed chunks and update the tree
+         *
+         * Changed chunks are hashed in parallel on the thread pool. The
+         * calling thread hashes chunks as well, so this may be called from
+         * a job running on the same pool.
+         */
+        void update(void);
+
+
+        /*! \brief Size of the buffer (in bytes) */
+        size_t size(void) const { return nbytes_; }
+
+        /*! \brief Size of each chunk (in bytes) */
+        size_t chunk_size(void) const { return chunk_size_; }
+
+        /*! \brief Number of chunks (leaves of the tree) */
+        size_t nchunks(void) const { return levels_[0].size(); }
+
+        /*! \brief Number of chunks that have changed since the last update() */
+        size_t ndirty(void) const { return ndirty_; }
+
+
+        /*! \brief The hash of the buffer, as of the last update() */
+        Digest128 digest(void) const { return digest_; }
+
+
+        /*! \brief The hash of the buffer, as of the last update() */
+        HashValue hash_value(void) const { return to_hash_value(digest_); }
+
+
+        /*! \brief Hash this object as part of something else
+         *
+         * Only the digest (as of the last update()) is hashed
+         */
+        template<typename HasherT>
+        void hash(HasherT & h) const
+        {
+            h(hash_pointer(digest_.data(), digest_.size()));
+        }
+
+
+    private:
+        uint8_t const * data_;  //!< The buffer being hashed
+        size_t nbytes_;         //!< Size of the buffer
+        size_t chunk_size_;     //!< Size of each chunk
+
+        detail::ThreadPool * pool_;   //!< Pool that the chunks are hashed on
+
+        //! Levels of the tree. The first is the leaves, the last is the root
+        std::vector<std::vector<Digest128>> levels_;
+
+        std::vector<uint8_t> dirty_;   //!< Whether each leaf needs to be rehashed
+        size_t ndirty_;                //!< Number of leaves that need to be rehashed
+
+        Digest128 digest_;   //!< The final hash
+
+
+        /*! \brief Set the sizes of the levels for the current buffer size */
+        void resize_levels_(void);
+
+
+        /*! \brief Mark a range of leaves as changed (inclusive) */
+        void mark_leaves_(size_t first, size_t last);
+
+
+        /*! \brief Hash the given leaves, on the thread pool */
+        void hash_leaves_(const std::vector<size_t> & leaves);
+};
+
+
+} // close namespace bphash
+
@@ -10,8 +10,10 @@
 #pragma once
 
 #include <array>
+#include <algorithm>
 
 #include "bphash/HashImpl.hpp"
+#include "bphash/MurmurHash3_Common.hpp"
 
 namespace bphash {
 namespace detail {
@@ -53,6 +55,34 @@ class MurmurHash3_128_x64 : public HashImpl
 
 
     public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest128 digest_type;
+
+
+        /*! \brief Mix a single 16-byte block into a hash state
+         *
+         * \param [inout] h1 First part of the hash state
+         * \param [inout] h2 Second part of the hash state
+         * \param [in] k1 First 8 bytes of the block
+         * \param [in] k2 Second 8 bytes of the block
+         */
+        static void mix_block(uint64_t & h1, uint64_t & h2, uint64_t k1, uint64_t k2);
+
+
+        /*! \brief Hash the tail/remainder and compute the final hash from a hash state
+         *
+         * \param [in] h1 First part of the hash state
+         * \param [in] h2 Second part of the hash state
+         * \param [in] tail The remaining data (less than 16 bytes)
+         * \param [in] ntail Number of bytes in \p tail
+         * \param [in] len Total number of bytes hashed (including the tail)
+         * \param [out] out Where to write the hash (16 bytes)
+         */
+        static void finish(uint64_t h1, uint64_t h2,
+                           uint8_t const * tail, size_t ntail,
+                           size_t len, uint8_t * out);
+
+
         MurmurHash3_128_x64(void);
         ~MurmurHash3_128_x64(void) = default;
 
@@ -67,12 +97,177 @@ class MurmurHash3_128_x64 : public HashImpl
 
         virtual void update(void const * data, size_t nbytes);
 
-        virtual HashValue finalize(void);
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
 
         virtual void reset(void);
 };
 
 
+////////////////////////////////////////////
+// Inline functions
+//
+// These are kept in the header so that they
+// can be inlined when the algorithm type is known
+// at compile time (see BasicHasher)
+////////////////////////////////////////////
+inline void MurmurHash3_128_x64::update(void const * data, size_t nbytes)
+{
+    if(nbytes == 0)
+        return; // got nothing to do
+
+    // cast to an array of bytes
+    const uint8_t * data_conv = static_cast<const uint8_t*>(data);
+
+    if(nbuffer_ != 0)
+    {
+        BPHASH_INSTRUMENT_CARRY(nbuffer_);
+
+        // we have some leftover data. Add some from the
+        // new data and hash the temporary buffer
+
+        // Amount of space left in the buffer?
+        size_t nbytes_avail = 16 - nbuffer_;
+    
+        // How much of data should we actually copy?
+        size_t tocopy = std::min(nbytes, nbytes_avail);
+    
+        // copy it to the end of the buffer
+        std::copy(data_conv,
+                  data_conv + tocopy,
+                  buffer_.begin() + nbuffer_);
+    
+        // how much do we have in the buffer now?
+        nbuffer_ += tocopy;
+
+        // The new number of bytes to do in data
+        // This should not underflow since
+        // tocopy = std::min(nbytes, ...)
+        nbytes -= tocopy;
+
+        // Also advance the data pointer
+        data_conv += tocopy;
+
+        // hash the buffer if it is full
+        if(nbuffer_ == 16)
+        {
+            update_block_(buffer_.data(), 1);
+            nbuffer_ = 0;
+        }
+    }
+
+    // now continue hashing the data in place
+    size_t nblocks = nbytes / 16;
+    update_block_(data_conv, nblocks);  // ok if nblocks == 0
+
+    // advance the pointer and calculate how much is left
+    nbytes -= (nblocks * 16);
+    data_conv += (nblocks * 16);
+
+    // Leave any remainder in the main buffer
+    // (we already know that nbytes < 16, or else
+    // the while loop would have kept going)
+    if(nbytes != 0)
+    {
+        std::copy(data_conv, data_conv + nbytes, buffer_.begin());
+        nbuffer_ = nbytes;
+    }
+}
+
+
+inline void MurmurHash3_128_x64::mix_block(uint64_t & h1, uint64_t & h2,
+                                           uint64_t k1, uint64_t k2)
+{
+    k1 *= c1;
+    k1  = rotl64(k1, 31);
+    k1 *= c2;
+
+    h1 ^= k1;
+    h1 = rotl64(h1, 27);
+    h1 += h2;
+    h1 = h1*5+0x52dce729;
+
+    k2 *= c2;
+    k2  = rotl64(k2, 33);
+    k2 *= c1;
+    h2 ^= k2;
+
+    h2 = rotl64(h2, 31);
+    h2 += h1;
+    h2 = h2*5+0x38495ab5;
+}
+
+
+inline void MurmurHash3_128_x64::finish(uint64_t h1, uint64_t h2,
+                                        uint8_t const * tail, size_t ntail,
+                                        size_t len, uint8_t * out)
+{
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+
+    switch(ntail & 15)
+    {
+        case 15: k2 ^= (static_cast<uint64_t>(tail[14])) << 48;
+        case 14: k2 ^= (static_cast<uint64_t>(tail[13])) << 40;
+        case 13: k2 ^= (static_cast<uint64_t>(tail[12])) << 32;
+        case 12: k2 ^= (static_cast<uint64_t>(tail[11])) << 24;
+        case 11: k2 ^= (static_cast<uint64_t>(tail[10])) << 16;
+        case 10: k2 ^= (static_cast<uint64_t>(tail[ 9])) << 8;
+        case  9: k2 ^= (static_cast<uint64_t>(tail[ 8])) << 0;
+                 k2 *= c2; k2  = rotl64(k2,33); k2 *= c1; h2 ^= k2;
+
+        case  8: k1 ^= (static_cast<uint64_t>(tail[ 7])) << 56;
+        case  7: k1 ^= (static_cast<uint64_t>(tail[ 6])) << 48;
+        case  6: k1 ^= (static_cast<uint64_t>(tail[ 5])) << 40;
+        case  5: k1 ^= (static_cast<uint64_t>(tail[ 4])) << 32;
+        case  4: k1 ^= (static_cast<uint64_t>(tail[ 3])) << 24;
+        case  3: k1 ^= (static_cast<uint64_t>(tail[ 2])) << 16;
+        case  2: k1 ^= (static_cast<uint64_t>(tail[ 1])) << 8;
+        case  1: k1 ^= (static_cast<uint64_t>(tail[ 0])) << 0;
+                 k1 *= c1; k1  = rotl64(k1,31); k1 *= c2; h1 ^= k1;
+    };
+
+    // Last steps of the hash
+    h1 ^= len; h2 ^= len;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    // Write out the hash
+    for(size_t i = 0; i < 8; i++)
+    {
+        out[i]   = static_cast<uint8_t>(h1 >> (i*8));
+        out[i+8] = static_cast<uint8_t>(h2 >> (i*8));
+    }
+}
+
+
+inline void MurmurHash3_128_x64::update_block_(uint8_t const * data, size_t nblocks)
+{
+    // This function only does entire 16-byte blocks
+    // (passed in through the first parameter)
+    const uint64_t * block64 = reinterpret_cast<const uint64_t *>(data);
+
+    for(size_t i = 0; i < nblocks; i++)
+    {
+        mix_block(h1_, h2_, block64[0], block64[1]);
+        block64 += 2;
+    }
+
+    // update how much we've actually hashed
+    len_ += nblocks * 16;
+}
+
+
 } // close namespace detail
 } // close namespace bphash
 
@@ -10,8 +10,10 @@
 #pragma once
 
 #include <array>
+#include <algorithm>
 
 #include "bphash/HashImpl.hpp"
+#include "bphash/MurmurHash3_Common.hpp"
 
 namespace bphash {
 namespace detail {
@@ -51,6 +53,30 @@ class MurmurHash3_32_x32 : public HashImpl
         void update_block_(uint8_t const * data, size_t nblocks);
 
     public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest32 digest_type;
+
+
+        /*! \brief Mix a single 4-byte block into a hash state
+         *
+         * \param [inout] h The hash state
+         * \param [in] k The 4-byte block
+         */
+        static void mix_block(uint32_t & h, uint32_t k);
+
+
+        /*! \brief Hash the tail/remainder and compute the final hash from a hash state
+         *
+         * \param [in] h The hash state
+         * \param [in] tail The remaining data (less than 4 bytes)
+         * \param [in] ntail Number of bytes in \p tail
+         * \param [in] len Total number of bytes hashed (including the tail)
+         * \param [out] out Where to write the hash (4 bytes)
+         */
+        static void finish(uint32_t h, uint8_t const * tail, size_t ntail,
+                           size_t len, uint8_t * out);
+
+
         MurmurHash3_32_x32(void);
         ~MurmurHash3_32_x32(void) = default;
 
@@ -65,12 +91,137 @@ class MurmurHash3_32_x32 : public HashImpl
 
         virtual void update(void const * data, size_t nbytes);
 
-        virtual HashValue finalize(void);
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
 
         virtual void reset(void);
 };
 
 
+////////////////////////////////////////////
+// Inline functions
+//
+// These are kept in the header so that they
+// can be inlined when the algorithm type is known
+// at compile time (see BasicHasher)
+////////////////////////////////////////////
+inline void MurmurHash3_32_x32::update(void const * data, size_t nbytes)
+{
+    if(nbytes == 0)
+        return; // got nothing to do
+
+    // cast to an array of bytes
+    const uint8_t * data_conv = static_cast<const uint8_t*>(data);
+
+    if(nbuffer_ != 0)
+    {
+        BPHASH_INSTRUMENT_CARRY(nbuffer_);
+
+        // we have some leftover data. Add some from the
+        // new data and hash the temporary buffer
+
+        // Amount of space left in the buffer?
+        size_t nbytes_avail = 4 - nbuffer_;
+    
+        // How much of data should we actually copy?
+        size_t tocopy = std::min(nbytes, nbytes_avail);
+    
+        // copy it to the end of the buffer
+        std::copy(data_conv,
+                  data_conv + tocopy,
+                  buffer_.begin() + nbuffer_);
+    
+        // how much do we have in the buffer now?
+        nbuffer_ += tocopy;
+
+        // The new number of bytes to do in data
+        // This should not underflow since
+        // tocopy = std::min(nbytes, ...)
+        nbytes -= tocopy;
+
+        // Also advance the data pointer
+        data_conv += tocopy;
+
+        // hash the buffer if it is full
+        if(nbuffer_ == 4)
+        {
+            update_block_(buffer_.data(), 1);
+            nbuffer_ = 0;
+        }
+    }
+
+    // now continue hashing the data in place
+    size_t nblocks = nbytes / 4;
+    update_block_(data_conv, nblocks);  // ok if nblocks == 0
+
+    // advance the pointer and calculate how much is left
+    nbytes -= (nblocks * 4);
+    data_conv += (nblocks * 4);
+
+    // Leave any remainder in the main buffer
+    // (we already know that nbytes < 4, or else
+    // the while loop would have kept going)
+    if(nbytes != 0)
+    {
+        std::copy(data_conv, data_conv + nbytes, buffer_.begin());
+        nbuffer_ = nbytes;
+    }
+}
+
+
+inline void MurmurHash3_32_x32::mix_block(uint32_t & h, uint32_t k)
+{
+    k *= c1;
+    k  = rotl32(k, 15);
+    k *= c2;
+
+    h ^= k;
+    h = rotl32(h, 13);
+    h = h*5+0xe6546b64;
+}
+
+
+inline void MurmurHash3_32_x32::finish(uint32_t h, uint8_t const * tail, size_t ntail,
+                                       size_t len, uint8_t * out)
+{
+    uint32_t k = 0;
+
+    switch(ntail & 3)
+    {
+        case  3: k ^= (static_cast<uint32_t>(tail[ 2])) << 16;
+        case  2: k ^= (static_cast<uint32_t>(tail[ 1])) << 8;
+        case  1: k ^= (static_cast<uint32_t>(tail[ 0])) << 0;
+                 k *= c1; k  = rotl32(k,15); k *= c2; h ^= k;
+    };
+
+    // Last steps of the hash
+    h ^= static_cast<uint32_t>(len);
+    h = fmix32(h);
+
+    // Write out the hash
+    for(size_t i = 0; i < 4; i++)
+        out[i] = static_cast<uint8_t>(h >> (i*8));
+}
+
+
+inline void MurmurHash3_32_x32::update_block_(uint8_t const * data, size_t nblocks)
+{
+    // This function only does entire 4-byte blocks
+    // (passed in through the first parameter)
+
+    const uint32_t * block32 = reinterpret_cast<const uint32_t *>(data);
+
+    for(size_t i = 0; i < nblocks; i++)
+        mix_block(h_, block32[i]);
+
+    // update how much we've actually hashed
+    len_ += 4 * nblocks;
+}
+
+
 } // close namespace detail
 } // close namespace bphash
 
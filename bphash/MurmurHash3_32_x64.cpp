@@ -12,10 +12,24 @@
 namespace bphash {
 namespace detail {
 
-HashValue MurmurHash3_32_x64::finalize(void)
+size_t MurmurHash3_32_x64::hash_size(void) const
 {
-    HashValue hv = MurmurHash3_128_x64::finalize();
-    return truncate_hash(hv, 4);
+    return 4;
+}
+
+
+std::unique_ptr<HashImpl> MurmurHash3_32_x64::clone(void) const
+{
+    return std::unique_ptr<HashImpl>(new MurmurHash3_32_x64(*this));
+}
+
+
+void MurmurHash3_32_x64::finalize_into(uint8_t * out) const
+{
+    // Calculate the full hash, and keep only the first part
+    uint8_t full[16];
+    MurmurHash3_128_x64::finalize_into(full);
+    std::copy(full, full + 4, out);
 }
 
 
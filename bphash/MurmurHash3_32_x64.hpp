@@ -23,6 +23,9 @@ namespace detail {
 class MurmurHash3_32_x64 : public MurmurHash3_128_x64
 {
     public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest32 digest_type;
+
         MurmurHash3_32_x64(void) = default;
         ~MurmurHash3_32_x64(void) = default;
 
@@ -35,7 +38,11 @@ class MurmurHash3_32_x64 : public MurmurHash3_128_x64
         // Virtual functions of HashImpl
         /////////////////////////////////
 
-        virtual HashValue finalize(void);
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
 };
 
 
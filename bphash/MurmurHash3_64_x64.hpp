@@ -24,6 +24,9 @@ namespace detail {
 class MurmurHash3_64_x64 : public MurmurHash3_128_x64
 {
     public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest64 digest_type;
+
         MurmurHash3_64_x64(void) = default;
         ~MurmurHash3_64_x64(void) = default;
 
@@ -36,7 +39,11 @@ class MurmurHash3_64_x64 : public MurmurHash3_128_x64
         // Virtual functions of HashImpl
         /////////////////////////////////
 
-        virtual HashValue finalize(void);
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
 };
 
 
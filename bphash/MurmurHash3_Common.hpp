@@ -0,0 +1,58 @@
+/*! \file
+ * \brief Small functions shared by the MurmurHash3 implementations
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace bphash {
+namespace detail {
+
+//////////////////////////////////////////
+// Some small functions for the hash algo
+//////////////////////////////////////////
+inline uint32_t rotl32 ( uint32_t x, int8_t r )
+{
+  return (x << r) | (x >> (32 - r));
+}
+
+
+inline uint64_t rotl64 ( uint64_t x, int8_t r )
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+
+inline uint32_t fmix32 ( uint32_t k )
+{
+    k ^= k >> 16;
+    k *= 0x85ebca6b;
+    k ^= k >> 13;
+    k *= 0xc2b2ae35;
+    k ^= k >> 16;
+
+    return k;
+}
+
+
+inline uint64_t fmix64 ( uint64_t k )
+{
+  k ^= k >> 33;
+  k *= (0xff51afd7ed558ccdLLU);
+  k ^= k >> 33;
+  k *= (0xc4ceb9fe1a85ec53LLU);
+  k ^= k >> 33;
+
+  return k;
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
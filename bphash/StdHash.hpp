@@ -9,14 +9,53 @@
 
 #pragma once
 
-#include "bphash/Hasher.hpp"
+#include "bphash/BasicHasher.hpp"
+#include "bphash/MurmurHash3_64_x64.hpp"
 
 namespace bphash {
+namespace detail {
+
+/*! \brief Hash an arithmetic or enum object for StdHash
+ *
+ * Small objects such as these are mixed directly with the MurmurHash3
+ * finalization mix, rather than going through a full hasher.
+ */
+template<typename T>
+typename std::enable_if<(std::is_arithmetic<T>::value || std::is_enum<T>::value) &&
+                        sizeof(T) <= sizeof(uint64_t), size_t>::type
+std_hash_object(const T & obj)
+{
+    uint64_t bits = 0;
+    std::memcpy(&bits, &obj, sizeof(T));
+    return static_cast<size_t>(fmix64(bits));
+}
+
+
+/*! \brief Hash any other object for StdHash
+ *
+ * The hasher is kept on the stack, so no memory is allocated.
+ */
+template<typename T>
+typename std::enable_if<!((std::is_arithmetic<T>::value || std::is_enum<T>::value) &&
+                          sizeof(T) <= sizeof(uint64_t)), size_t>::type
+std_hash_object(const T & obj)
+{
+    BasicHasher<MurmurHash3_64_x64> hasher;
+    hasher(obj);
+    return convert_hash<size_t>(hasher.finalize_digest());
+}
+
+} // close namespace detail
+
 
 /*! \brief A class that can be used in place of std::hash in containers
  *
  * This is useful for `unordered_map`, etc, that require hashing of the key
  * type.
+ *
+ * \note The values returned are not the same as those obtained via
+ *       make_hash. In particular, arithmetic and enum types are
+ *       hashed with a simple integer mixing function.
  */
 template<typename T>
 struct StdHash
@@ -29,10 +68,8 @@ struct StdHash
          "  ***  (such as <bphash/types/string.hpp>) or to declare a hash member function or  ***\n"
          "  ***  free function?                                                               ***\n");
 
-        auto h = make_hash(HashType::Hash64, obj);
-        return convert_hash<size_t>(h);
+        return detail::std_hash_object(obj);
     }
 };
 
 } // close namespace bphash
-
@@ -0,0 +1,105 @@
+/*! \file
+ * \brief A simple pool of worker threads (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace bphash {
+namespace detail {
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+ThreadPool::ThreadPool(size_t nthreads)
+    : stop_(false)
+{
+    for(size_t i = 0; i < nthreads; i++)
+        threads_.emplace_back(&ThreadPool::worker_, this);
+}
+
+
+ThreadPool::~ThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    cv_.notify_all();
+
+    for(auto & t : threads_)
+        t.join();
+}
+
+
+size_t ThreadPool::size(void) const
+{
+    return threads_.size();
+}
+
+
+void ThreadPool::submit(std::function<void(void)> job)
+{
+    if(threads_.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push(std::move(job));
+    }
+
+    cv_.notify_one();
+}
+
+
+ThreadPool & default_thread_pool(void)
+{
+    // hardware_concurrency may return 0 if it can't be determined
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+void ThreadPool::worker_(void)
+{
+    while(true)
+    {
+        std::function<void(void)> job;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+
+            // Only exit once all the jobs are done
+            if(jobs_.empty())
+                return;
+
+            job = std::move(jobs_.front());
+            jobs_.pop();
+        }
+
+        job();
+    }
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,83 @@
+/*! \file
+ * \brief A simple pool of worker threads (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace bphash {
+namespace detail {
+
+/*! \brief A fixed-size pool of worker threads
+ *
+ * Jobs are run in the order they are submitted, by whichever
+ * worker is free. The pool does not track the completion of jobs;
+ * users of the pool are responsible for waiting on their own jobs.
+ *
+ * A pool with zero threads runs each job immediately in the
+ * submitting thread.
+ */
+class ThreadPool
+{
+    public:
+        /*! \brief Start a pool with the given number of worker threads */
+        explicit ThreadPool(size_t nthreads);
+
+        /*! \brief Finish all submitted jobs and stop the workers */
+        ~ThreadPool(void);
+
+        // not copyable or movable
+        ThreadPool(const ThreadPool &)             = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+        ThreadPool(ThreadPool &&)                  = delete;
+        ThreadPool & operator=(ThreadPool &&)      = delete;
+
+
+        /*! \brief Number of worker threads in this pool */
+        size_t size(void) const;
+
+
+        /*! \brief Add a job to be run by one of the workers
+         *
+         * Jobs must not throw exceptions.
+         */
+        void submit(std::function<void(void)> job);
+
+
+    private:
+        std::vector<std::thread> threads_;              //!< The worker threads
+        std::queue<std::function<void(void)>> jobs_;    //!< Jobs waiting to be run
+
+        std::mutex mutex_;              //!< Protects jobs_ and stop_
+        std::condition_variable cv_;    //!< Signals new jobs (or stopping)
+        bool stop_;                     //!< Set when the workers should exit
+
+
+        /*! \brief Main loop of each worker thread */
+        void worker_(void);
+};
+
+
+/*! \brief The thread pool shared by the library
+ *
+ * This pool is created on first use, with one thread for
+ * each hardware thread of the machine.
+ */
+ThreadPool & default_thread_pool(void);
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,292 @@
+/*! \file
+ * \brief Parallel tree hash built on MurmurHash3 128-bit x64 (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/TreeHash.hpp"
+#include "bphash/MurmurHash3_128_x64.hpp"
+
+#include <cstring>
+
+namespace bphash {
+namespace detail {
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+const size_t TreeHash::chunk_size;
+
+
+TreeHash::TreeHash(void)
+    : TreeHash(default_thread_pool())
+{ }
+
+
+TreeHash::TreeHash(ThreadPool & pool)
+    : pool_(&pool), len_(0), nchunk_(0), nbuffers_(0), state_(std::make_shared<State>())
+{
+    state_->npending = 0;
+}
+
+
+TreeHash::~TreeHash(void)
+{
+    wait_();
+}
+
+
+size_t TreeHash::hash_size(void) const
+{
+    return 16;
+}
+
+
+void TreeHash::update(void const * data, size_t nbytes)
+{
+    const uint8_t * data_conv = static_cast<const uint8_t *>(data);
+
+    // Add to a partially-filled chunk first. Once full,
+    // it is hashed in the background
+    if(nchunk_ > 0)
+    {
+        const size_t tocopy = std::min(nbytes, chunk_size - nchunk_);
+        std::memcpy(chunk_.get() + nchunk_, data_conv, tocopy);
+
+        nchunk_ += tocopy;
+        len_ += tocopy;
+        data_conv += tocopy;
+        nbytes -= tocopy;
+
+        if(nchunk_ == chunk_size)
+        {
+            uint8_t * buffer = chunk_.release();
+            submit_(buffer, buffer);
+            nchunk_ = 0;
+        }
+    }
+
+    // Full chunks are hashed directly from the caller's data
+    if(nbytes >= chunk_size)
+    {
+        while(nbytes >= chunk_size)
+        {
+            submit_(data_conv, nullptr);
+
+            len_ += chunk_size;
+            data_conv += chunk_size;
+            nbytes -= chunk_size;
+        }
+
+        // We can't return while the data is still being used
+        wait_();
+    }
+
+    // Keep anything left over for the next chunk
+    if(nbytes > 0)
+    {
+        if(!chunk_)
+            chunk_ = take_buffer_();
+
+        std::memcpy(chunk_.get(), data_conv, nbytes);
+        nchunk_ = nbytes;
+        len_ += nbytes;
+    }
+}
+
+
+void TreeHash::finalize_into(uint8_t * out) const
+{
+    wait_();
+
+    // Leaves of the tree, including the last (partial) chunk
+    std::vector<Digest128> level(leaves_.begin(), leaves_.end());
+
+    if(nchunk_ > 0 || level.empty())
+    {
+        level.emplace_back();
+        hash_leaf(chunk_.get(), nchunk_, level.back());
+    }
+
+    // Combine pairs until only the root is left
+    while(level.size() > 1)
+    {
+        size_t nnext = 0;
+
+        for(size_t i = 0; i + 1 < level.size(); i += 2)
+            hash_node(level[i], level[i+1], level[nnext++]);
+
+        if(level.size() % 2 != 0)
+            level[nnext++] = level.back();
+
+        level.resize(nnext);
+    }
+
+    hash_root(level[0], len_, out);
+}
+
+
+std::unique_ptr<HashImpl> TreeHash::clone(void) const
+{
+    // Leaves that are still being hashed must be done
+    // before they can be copied
+    wait_();
+
+    std::unique_ptr<TreeHash> ret(new TreeHash(*pool_));
+    ret->leaves_ = leaves_;
+    ret->len_ = len_;
+
+    if(nchunk_ > 0)
+    {
+        ret->chunk_ = ret->take_buffer_();
+        std::memcpy(ret->chunk_.get(), chunk_.get(), nchunk_);
+        ret->nchunk_ = nchunk_;
+    }
+
+    return std::unique_ptr<HashImpl>(std::move(ret));
+}
+
+
+void TreeHash::reset(void)
+{
+    wait_();
+    leaves_.clear();
+    len_ = 0;
+    nchunk_ = 0;
+}
+
+
+void TreeHash::hash_leaf(uint8_t const * data, size_t nbytes, Digest128 & out)
+{
+    const uint8_t leaf_tag = 0x00;
+
+    MurmurHash3_128_x64 h;
+    h.update(data, nbytes);
+    h.update(&leaf_tag, 1);
+    h.finalize_into(out.data());
+}
+
+
+void TreeHash::hash_node(const Digest128 & left, const Digest128 & right, Digest128 & out)
+{
+    const uint8_t node_tag = 0x01;
+
+    MurmurHash3_128_x64 h;
+    h.update(left.data(), left.size());
+    h.update(right.data(), right.size());
+    h.update(&node_tag, 1);
+    h.finalize_into(out.data());
+}
+
+
+void TreeHash::hash_root(const Digest128 & root, uint64_t len, uint8_t * out)
+{
+    const uint8_t root_tag = 0x02;
+
+    // Length is always little endian
+    uint8_t len_bytes[8];
+    for(size_t i = 0; i < 8; i++)
+        len_bytes[i] = static_cast<uint8_t>(len >> (i*8));
+
+    MurmurHash3_128_x64 h;
+    h.update(root.data(), root.size());
+    h.update(len_bytes, 8);
+    h.update(&root_tag, 1);
+    h.finalize_into(out);
+}
+
+
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+void TreeHash::submit_(uint8_t const * data, uint8_t * buffer)
+{
+    // Elements of a deque don't move when adding to the end,
+    // so the task can write directly to its leaf
+    leaves_.emplace_back();
+
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->tasks.push_back(Task{data, buffer, &leaves_.back()});
+        state_->npending++;
+    }
+
+    // Each job runs one task, if one is still waiting
+    std::shared_ptr<State> state = state_;
+    pool_->submit([state]
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if(!state->tasks.empty())
+            run_task_(*state, lock);
+    });
+}
+
+
+void TreeHash::run_task_(State & state, std::unique_lock<std::mutex> & lock)
+{
+    const Task task = state.tasks.front();
+    state.tasks.pop_front();
+
+    lock.unlock();
+    hash_leaf(task.data, chunk_size, *task.leaf);
+    lock.lock();
+
+    if(task.buffer != nullptr)
+        state.spare.emplace_back(task.buffer);
+    state.npending--;
+    state.cv.notify_all();
+}
+
+
+TreeHash::ChunkBuffer TreeHash::take_buffer_(void)
+{
+    // Limit the memory used by chunks waiting to be hashed
+    const size_t max_buffers = 2*pool_->size() + 2;
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+
+    if(state_->spare.empty() && nbuffers_ < max_buffers)
+    {
+        nbuffers_++;
+        return ChunkBuffer(new uint8_t[chunk_size]);
+    }
+
+    while(state_->spare.empty())
+    {
+        if(!state_->tasks.empty())
+            run_task_(*state_, lock);
+        else
+            state_->cv.wait(lock);
+    }
+
+    ChunkBuffer ret = std::move(state_->spare.back());
+    state_->spare.pop_back();
+    return ret;
+}
+
+
+void TreeHash::wait_(void) const
+{
+    std::unique_lock<std::mutex> lock(state_->mutex);
+
+    // Only tasks already running on a worker are waited for
+    while(state_->npending != 0)
+    {
+        if(!state_->tasks.empty())
+            run_task_(*state_, lock);
+        else
+            state_->cv.wait(lock);
+    }
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,183 @@
+/*! \file
+ * \brief Parallel tree hash built on MurmurHash3 128-bit x64 (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "bphash/HashImpl.hpp"
+#include "bphash/ThreadPool.hpp"
+
+namespace bphash {
+namespace detail {
+
+/*! \brief A 128-bit tree hash whose chunks are hashed in parallel
+ *
+ * The input is split into chunks of #chunk_size bytes, which
+ * are hashed independently on a thread pool. The digests of the chunks are
+ * then combined in a binary tree. The result only depends on the data,
+ * and not on the number of threads or how the data was passed to update().
+ *
+ * Using `H(...)` for MurmurHash3 128-bit x64 of the concatenated bytes,
+ * the hash is defined as:
+ *
+ *  1. The input is split into chunks of #chunk_size bytes. The last chunk
+ *     may be shorter. Empty input is a single, empty chunk.
+ *  2. Each chunk is a leaf of the tree, with digest `H(chunk || 0x00)`.
+ *  3. Going from left to right, each pair of neighboring digests
+ *     `L, R` is replaced by `H(L || R || 0x01)`. If the number of digests
+ *     is odd, the last one is moved up to the next level unchanged. This
+ *     is repeated until a single (root) digest is left.
+ *  4. The hash is `H(root || len || 0x02)`, where `len` is the total number
+ *     of bytes as an 8-byte little-endian integer.
+ *
+ * Full chunks passed to update() are hashed in place, and update() waits
+ * for them to finish. Data that does not fill a chunk is copied, and that
+ * chunk is hashed in the background once it is full. Therefore, hashing can
+ * begin before all the data is available.
+ *
+ * While waiting, the calling thread hashes any chunks that no worker has
+ * started yet. It is therefore safe to use this from a job running
+ * on the same thread pool.
+ */
+class TreeHash : public HashImpl
+{
+    public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest128 digest_type;
+
+        //! Size of each chunk (leaf of the tree). This is part of the hash definition
+        static const size_t chunk_size = 1024*1024;
+
+
+        /*! \brief Construct, using the default thread pool */
+        TreeHash(void);
+
+        /*! \brief Construct, using the given thread pool
+         *
+         * The pool must outlive this object
+         */
+        explicit TreeHash(ThreadPool & pool);
+
+        /*! \brief Destructor. Waits for any running jobs */
+        ~TreeHash(void);
+
+        // not copyable or movable (jobs in flight refer to this object).
+        // Use clone() instead
+        TreeHash(const TreeHash &) = delete;
+        TreeHash & operator=(const TreeHash &) = delete;
+        TreeHash(TreeHash &&) = delete;
+        TreeHash & operator=(TreeHash &&) = delete;
+
+        /////////////////////////////////
+        // Virtual functions of HashImpl
+        /////////////////////////////////
+
+        virtual void update(void const * data, size_t nbytes);
+
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
+
+
+        /////////////////////////////////
+        // Building blocks of the tree
+        /////////////////////////////////
+
+        /*! \brief Compute the digest of a leaf (chunk) */
+        static void hash_leaf(uint8_t const * data, size_t nbytes, Digest128 & out);
+
+
+        /*! \brief Compute the digest of a node from its two children */
+        static void hash_node(const Digest128 & left, const Digest128 & right, Digest128 & out);
+
+
+        /*! \brief Compute the final hash from the root digest and the total length
+         *
+         * \param [out] out Where to write the hash (16 bytes)
+         */
+        static void hash_root(const Digest128 & root, uint64_t len, uint8_t * out);
+
+        virtual void reset(void);
+
+
+    private:
+        typedef std::unique_ptr<uint8_t[]> ChunkBuffer;
+
+        ThreadPool * pool_;  //!< Pool that the chunks are hashed on
+
+        std::deque<Digest128> leaves_;    //!< Digests of all full chunks (some may be in progress)
+        size_t len_;                      //!< Total amount already hashed
+
+        ChunkBuffer chunk_;   //!< Holds data of a chunk that isn't full yet
+        size_t nchunk_;       //!< Number of bytes in chunk_
+        size_t nbuffers_;     //!< Total number of chunk buffers allocated
+
+        /*! \brief A full chunk waiting to be hashed */
+        struct Task
+        {
+            uint8_t const * data;   //!< The data of the chunk
+            uint8_t * buffer;       //!< If not null, the buffer holding data
+            Digest128 * leaf;       //!< Where to write the digest
+        };
+
+        /*! \brief State shared with the jobs on the pool
+         *
+         * A job may start after the chunk it was submitted for has been
+         * hashed by another thread, and after this object is destroyed,
+         * in which case it only sees that there are no tasks left.
+         */
+        struct State
+        {
+            std::mutex mutex;                 //!< Protects everything here
+            std::condition_variable cv;       //!< Signals the end of a task
+            std::deque<Task> tasks;           //!< Chunks not yet started
+            size_t npending;                  //!< Tasks not yet finished (including running)
+            std::vector<ChunkBuffer> spare;   //!< Chunk buffers not in use
+        };
+
+        std::shared_ptr<State> state_;
+
+
+        /*! \brief Hash a chunk on the thread pool
+         *
+         * \param [in] data The data of the chunk
+         * \param [in] buffer If not null, the buffer holding \p data,
+         *                    which is returned to the spare buffers when done
+         */
+        void submit_(uint8_t const * data, uint8_t * buffer);
+
+
+        /*! \brief Run the first task waiting in \p state
+         *
+         * \p lock must hold the mutex of \p state, and there must be a task waiting.
+         * The mutex is released while hashing.
+         */
+        static void run_task_(State & state, std::unique_lock<std::mutex> & lock);
+
+
+        /*! \brief Obtain a buffer for the next chunk, waiting (or hashing) if too many are in use */
+        ChunkBuffer take_buffer_(void);
+
+
+        /*! \brief Wait for all submitted chunks to be hashed, hashing any not yet started */
+        void wait_(void) const;
+
+
+};
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,228 @@
+/*! \file
+ * \brief XXH3 128-bit hash (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/XXH3_128.hpp"
+
+namespace bphash {
+namespace detail {
+
+
+////////////////////////////////
+// Short inputs
+////////////////////////////////
+
+/* All of these return the lower 64 bits of the hash,
+ * and store the upper 64 bits in the last parameter */
+
+static uint64_t xxh3_128_len_1to3(uint8_t const * input, size_t len, uint64_t & high)
+{
+    const uint32_t c1 = input[0];
+    const uint32_t c2 = input[len >> 1];
+    const uint32_t c3 = input[len - 1];
+    const uint32_t combinedl = (c1 << 16) | (c2 << 24) | (c3 << 0) | (static_cast<uint32_t>(len) << 8);
+    const uint32_t swapped = xxh_swap32(combinedl);
+    const uint32_t combinedh = (swapped << 13) | (swapped >> 19);
+
+    const uint64_t bitflipl = xxh_read32(xxh3_secret)     ^ xxh_read32(xxh3_secret + 4);
+    const uint64_t bitfliph = xxh_read32(xxh3_secret + 8) ^ xxh_read32(xxh3_secret + 12);
+
+    high = xxh64_avalanche(combinedh ^ bitfliph);
+    return xxh64_avalanche(combinedl ^ bitflipl);
+}
+
+
+static uint64_t xxh3_128_len_4to8(uint8_t const * input, size_t len, uint64_t & high)
+{
+    const uint64_t input_lo = xxh_read32(input);
+    const uint64_t input_hi = xxh_read32(input + len - 4);
+    const uint64_t input64 = input_lo + (input_hi << 32);
+    const uint64_t bitflip = xxh_read64(xxh3_secret + 16) ^ xxh_read64(xxh3_secret + 24);
+    const uint64_t keyed = input64 ^ bitflip;
+
+    // Shift len to the left to ensure it is even (so the multiplier is odd)
+    uint64_t hi;
+    uint64_t lo = xxh_mult64to128(keyed, xxh_prime64_1 + (static_cast<uint64_t>(len) << 2), hi);
+
+    hi += (lo << 1);
+    lo ^= (hi >> 3);
+
+    lo = xxh_xorshift64(lo, 35);
+    lo *= 0x9FB21C651E98DF25ULL;
+    lo = xxh_xorshift64(lo, 28);
+
+    high = xxh3_avalanche(hi);
+    return lo;
+}
+
+
+static uint64_t xxh3_128_len_9to16(uint8_t const * input, size_t len, uint64_t & high)
+{
+    const uint64_t bitflipl = xxh_read64(xxh3_secret + 32) ^ xxh_read64(xxh3_secret + 40);
+    const uint64_t bitfliph = xxh_read64(xxh3_secret + 48) ^ xxh_read64(xxh3_secret + 56);
+    const uint64_t input_lo = xxh_read64(input);
+    uint64_t input_hi = xxh_read64(input + len - 8);
+
+    uint64_t m128_hi;
+    uint64_t m128_lo = xxh_mult64to128(input_lo ^ input_hi ^ bitflipl, xxh_prime64_1, m128_hi);
+
+    m128_lo += static_cast<uint64_t>(len - 1) << 54;
+    input_hi ^= bitfliph;
+    m128_hi += input_hi + xxh_mult32to64(input_hi, xxh_prime32_2 - 1);
+    m128_lo ^= xxh_swap64(m128_hi);
+
+    uint64_t h128_hi;
+    const uint64_t h128_lo = xxh_mult64to128(m128_lo, xxh_prime64_2, h128_hi);
+    h128_hi += m128_hi * xxh_prime64_2;
+
+    high = xxh3_avalanche(h128_hi);
+    return xxh3_avalanche(h128_lo);
+}
+
+
+/* Mix 32 bytes of input (in two 16-byte parts) into a 128-bit accumulator */
+static void xxh3_128_mix32b(uint64_t & lo, uint64_t & hi,
+                            uint8_t const * input1, uint8_t const * input2,
+                            uint8_t const * secret)
+{
+    lo += xxh3_mix16b(input1, secret);
+    lo ^= xxh_read64(input2) + xxh_read64(input2 + 8);
+    hi += xxh3_mix16b(input2, secret + 16);
+    hi ^= xxh_read64(input1) + xxh_read64(input1 + 8);
+}
+
+
+/* Final steps for inputs of 17 to 240 bytes */
+static uint64_t xxh3_128_mid_final(uint64_t lo, uint64_t hi, size_t len, uint64_t & high)
+{
+    high = 0 - xxh3_avalanche(lo * xxh_prime64_1 + hi * xxh_prime64_4 + len * xxh_prime64_2);
+    return xxh3_avalanche(lo + hi);
+}
+
+
+static uint64_t xxh3_128_len_17to128(uint8_t const * input, size_t len, uint64_t & high)
+{
+    uint64_t lo = len * xxh_prime64_1;
+    uint64_t hi = 0;
+
+    if(len > 32)
+    {
+        if(len > 64)
+        {
+            if(len > 96)
+                xxh3_128_mix32b(lo, hi, input + 48, input + len - 64, xxh3_secret + 96);
+            xxh3_128_mix32b(lo, hi, input + 32, input + len - 48, xxh3_secret + 64);
+        }
+        xxh3_128_mix32b(lo, hi, input + 16, input + len - 32, xxh3_secret + 32);
+    }
+    xxh3_128_mix32b(lo, hi, input, input + len - 16, xxh3_secret);
+
+    return xxh3_128_mid_final(lo, hi, len, high);
+}
+
+
+static uint64_t xxh3_128_len_129to240(uint8_t const * input, size_t len, uint64_t & high)
+{
+    const size_t start_offset = 3;
+    const size_t last_offset = 17;
+    const size_t nrounds = len / 32;
+
+    uint64_t lo = len * xxh_prime64_1;
+    uint64_t hi = 0;
+
+    for(size_t i = 0; i < 4; i++)
+        xxh3_128_mix32b(lo, hi, input + 32*i, input + 32*i + 16, xxh3_secret + 32*i);
+
+    lo = xxh3_avalanche(lo);
+    hi = xxh3_avalanche(hi);
+
+    for(size_t i = 4; i < nrounds; i++)
+        xxh3_128_mix32b(lo, hi, input + 32*i, input + 32*i + 16,
+                        xxh3_secret + start_offset + 32*(i-4));
+
+    // last bytes
+    xxh3_128_mix32b(lo, hi, input + len - 16, input + len - 32,
+                    xxh3_secret + xxh3_secret_size_min - last_offset - 16);
+
+    return xxh3_128_mid_final(lo, hi, len, high);
+}
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+size_t XXH3_128::hash_size(void) const
+{
+    return 16;
+}
+
+
+std::unique_ptr<HashImpl> XXH3_128::clone(void) const
+{
+    return std::unique_ptr<HashImpl>(new XXH3_128(*this));
+}
+
+
+void XXH3_128::finalize_into(uint8_t * out) const
+{
+    uint64_t lo, hi;
+
+    if(len_ <= xxh3_midsize_max)
+        lo = hash_short_(buffer_.data(), nbuffer_, hi);
+    else
+    {
+        uint64_t acc[xxh3_acc_nb];
+        finalize_acc_(acc);
+
+        lo = xxh3_merge_accs(acc, xxh3_secret + xxh3_secret_mergeaccs_start,
+                             len_ * xxh_prime64_1);
+        hi = xxh3_merge_accs(acc, xxh3_secret + xxh3_secret_size - sizeof(acc) - xxh3_secret_mergeaccs_start,
+                             ~(len_ * xxh_prime64_2));
+    }
+
+    // Canonical representation: high part first, each big-endian
+    for(size_t i = 0; i < 8; i++)
+    {
+        out[i]   = static_cast<uint8_t>(hi >> (56 - i*8));
+        out[i+8] = static_cast<uint8_t>(lo >> (56 - i*8));
+    }
+}
+
+
+
+////////////////////////////////
+// Private functions
+////////////////////////////////
+
+uint64_t XXH3_128::hash_short_(uint8_t const * input, size_t len, uint64_t & high)
+{
+    if(len > 128)
+        return xxh3_128_len_129to240(input, len, high);
+    else if(len > 16)
+        return xxh3_128_len_17to128(input, len, high);
+    else if(len > 8)
+        return xxh3_128_len_9to16(input, len, high);
+    else if(len >= 4)
+        return xxh3_128_len_4to8(input, len, high);
+    else if(len > 0)
+        return xxh3_128_len_1to3(input, len, high);
+    else
+    {
+        const uint64_t bitflipl = xxh_read64(xxh3_secret + 64) ^ xxh_read64(xxh3_secret + 72);
+        const uint64_t bitfliph = xxh_read64(xxh3_secret + 80) ^ xxh_read64(xxh3_secret + 88);
+        high = xxh64_avalanche(bitfliph);
+        return xxh64_avalanche(bitflipl);
+    }
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,64 @@
+/*! \file
+ * \brief XXH3 128-bit hash (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/XXH3_64.hpp"
+
+namespace bphash {
+namespace detail {
+
+/*! \brief Implementation of the XXH3 128-bit hash
+ *
+ * This shares all of the processing of long inputs with the
+ * 64-bit version (XXH3_64), and only differs in the handling
+ * of short inputs and the final merging of the accumulators.
+ *
+ * The hash is written in the canonical byte order (the high 64 bits
+ * first, each half big-endian).
+ */
+class XXH3_128 : public XXH3_64
+{
+    public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest128 digest_type;
+
+        XXH3_128(void) = default;
+        explicit XXH3_128(const XXH3Kernel & kernel) : XXH3_64(kernel) { }
+        ~XXH3_128(void) = default;
+
+        XXH3_128(const XXH3_128 &) = default;
+        XXH3_128 & operator=(const XXH3_128 &) = default;
+        XXH3_128(XXH3_128 &&) = default;
+        XXH3_128 & operator=(XXH3_128 &&) = default;
+
+        /////////////////////////////////
+        // Virtual functions of HashImpl
+        /////////////////////////////////
+
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
+
+
+    private:
+        /*! \brief Hash an input of at most #xxh3_midsize_max bytes all at once
+         *
+         * \param [out] high The upper 64 bits of the hash
+         * \return The lower 64 bits of the hash
+         */
+        static uint64_t hash_short_(uint8_t const * input, size_t len, uint64_t & high);
+};
+
+
+} // close namespace detail
+} // close namespace bphash
+
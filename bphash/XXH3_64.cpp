@@ -0,0 +1,288 @@
+/*! \file
+ * \brief XXH3 64-bit hash (source)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#include "bphash/XXH3_64.hpp"
+
+#include <algorithm>
+
+namespace bphash {
+namespace detail {
+
+
+////////////////////////////////
+// Short inputs
+////////////////////////////////
+
+static uint64_t xxh3_64_len_1to3(uint8_t const * input, size_t len)
+{
+    const uint32_t c1 = input[0];
+    const uint32_t c2 = input[len >> 1];
+    const uint32_t c3 = input[len - 1];
+    const uint32_t combined = (c1 << 16) | (c2 << 24) | (c3 << 0) | (static_cast<uint32_t>(len) << 8);
+    const uint64_t bitflip = xxh_read32(xxh3_secret) ^ xxh_read32(xxh3_secret + 4);
+    return xxh64_avalanche(combined ^ bitflip);
+}
+
+
+static uint64_t xxh3_64_len_4to8(uint8_t const * input, size_t len)
+{
+    const uint64_t input1 = xxh_read32(input);
+    const uint64_t input2 = xxh_read32(input + len - 4);
+    const uint64_t bitflip = xxh_read64(xxh3_secret + 8) ^ xxh_read64(xxh3_secret + 16);
+    const uint64_t input64 = input2 + (input1 << 32);
+    return xxh3_rrmxmx(input64 ^ bitflip, len);
+}
+
+
+static uint64_t xxh3_64_len_9to16(uint8_t const * input, size_t len)
+{
+    const uint64_t bitflip1 = xxh_read64(xxh3_secret + 24) ^ xxh_read64(xxh3_secret + 32);
+    const uint64_t bitflip2 = xxh_read64(xxh3_secret + 40) ^ xxh_read64(xxh3_secret + 48);
+    const uint64_t input_lo = xxh_read64(input) ^ bitflip1;
+    const uint64_t input_hi = xxh_read64(input + len - 8) ^ bitflip2;
+    const uint64_t acc = len + xxh_swap64(input_lo) + input_hi
+                       + xxh_mul128_fold64(input_lo, input_hi);
+    return xxh3_avalanche(acc);
+}
+
+
+static uint64_t xxh3_64_len_17to128(uint8_t const * input, size_t len)
+{
+    uint64_t acc = len * xxh_prime64_1;
+
+    if(len > 32)
+    {
+        if(len > 64)
+        {
+            if(len > 96)
+            {
+                acc += xxh3_mix16b(input + 48, xxh3_secret + 96);
+                acc += xxh3_mix16b(input + len - 64, xxh3_secret + 112);
+            }
+            acc += xxh3_mix16b(input + 32, xxh3_secret + 64);
+            acc += xxh3_mix16b(input + len - 48, xxh3_secret + 80);
+        }
+        acc += xxh3_mix16b(input + 16, xxh3_secret + 32);
+        acc += xxh3_mix16b(input + len - 32, xxh3_secret + 48);
+    }
+    acc += xxh3_mix16b(input, xxh3_secret);
+    acc += xxh3_mix16b(input + len - 16, xxh3_secret + 16);
+
+    return xxh3_avalanche(acc);
+}
+
+
+static uint64_t xxh3_64_len_129to240(uint8_t const * input, size_t len)
+{
+    const size_t start_offset = 3;
+    const size_t last_offset = 17;
+    const size_t nrounds = len / 16;
+
+    uint64_t acc = len * xxh_prime64_1;
+
+    for(size_t i = 0; i < 8; i++)
+        acc += xxh3_mix16b(input + 16*i, xxh3_secret + 16*i);
+
+    acc = xxh3_avalanche(acc);
+
+    for(size_t i = 8; i < nrounds; i++)
+        acc += xxh3_mix16b(input + 16*i, xxh3_secret + 16*(i-8) + start_offset);
+
+    // last bytes
+    acc += xxh3_mix16b(input + len - 16, xxh3_secret + xxh3_secret_size_min - last_offset);
+
+    return xxh3_avalanche(acc);
+}
+
+
+
+////////////////////////////////
+// Public functions
+////////////////////////////////
+
+XXH3_64::XXH3_64(void)
+    : XXH3_64(xxh3_default_kernel())
+{ }
+
+
+XXH3_64::XXH3_64(const XXH3Kernel & kernel)
+    : kernel_(&kernel)
+{
+    reset();
+}
+
+
+size_t XXH3_64::hash_size(void) const
+{
+    return 8;
+}
+
+
+void XXH3_64::reset(void)
+{
+    acc_ = {{ xxh_prime32_3, xxh_prime64_1, xxh_prime64_2, xxh_prime64_3,
+              xxh_prime64_4, xxh_prime32_2, xxh_prime64_5, xxh_prime32_1 }};
+    std::fill(buffer_.begin(), buffer_.end(), 0);
+    nbuffer_ = 0;
+    nstripes_acc_ = 0;
+    len_ = 0;
+}
+
+
+void XXH3_64::update(void const * data, size_t nbytes)
+{
+    const uint8_t * data_conv = static_cast<const uint8_t *>(data);
+
+    len_ += nbytes;
+
+    // Only buffer the data if it fits. This means that
+    // short inputs are always entirely in the buffer
+    if(nbuffer_ + nbytes <= buffer_size)
+    {
+        std::copy(data_conv, data_conv + nbytes, buffer_.begin() + nbuffer_);
+        nbuffer_ += nbytes;
+        return;
+    }
+
+    // Fill the buffer and hash it
+    if(nbuffer_ > 0)
+    {
+        const size_t tocopy = buffer_size - nbuffer_;
+        std::copy(data_conv, data_conv + tocopy, buffer_.begin() + nbuffer_);
+        data_conv += tocopy;
+        nbytes -= tocopy;
+
+        consume_stripes_(acc_.data(), nstripes_acc_, buffer_.data(), buffer_size / xxh3_stripe_len);
+        nbuffer_ = 0;
+    }
+
+    // Hash as much as possible in place. The last stripe
+    // must be left for finalization
+    if(nbytes > buffer_size)
+    {
+        const size_t nstripes = (nbytes - 1) / xxh3_stripe_len;
+        consume_stripes_(acc_.data(), nstripes_acc_, data_conv, nstripes);
+        data_conv += nstripes * xxh3_stripe_len;
+        nbytes -= nstripes * xxh3_stripe_len;
+
+        // The last stripe may need the data just before the remainder
+        std::copy(data_conv - xxh3_stripe_len, data_conv, buffer_.end() - xxh3_stripe_len);
+    }
+
+    // Keep the rest (there is always something)
+    std::copy(data_conv, data_conv + nbytes, buffer_.begin());
+    nbuffer_ = nbytes;
+}
+
+
+std::unique_ptr<HashImpl> XXH3_64::clone(void) const
+{
+    return std::unique_ptr<HashImpl>(new XXH3_64(*this));
+}
+
+
+void XXH3_64::finalize_into(uint8_t * out) const
+{
+    uint64_t h;
+
+    if(len_ <= xxh3_midsize_max)
+        h = hash_short_(buffer_.data(), nbuffer_);
+    else
+    {
+        uint64_t acc[xxh3_acc_nb];
+        finalize_acc_(acc);
+        h = xxh3_merge_accs(acc, xxh3_secret + xxh3_secret_mergeaccs_start, len_ * xxh_prime64_1);
+    }
+
+    // Canonical (big-endian) representation
+    for(size_t i = 0; i < 8; i++)
+        out[i] = static_cast<uint8_t>(h >> (56 - i*8));
+}
+
+
+
+////////////////////////////////
+// Protected functions
+////////////////////////////////
+
+const size_t XXH3_64::buffer_size;
+
+
+void XXH3_64::consume_stripes_(uint64_t * acc, size_t & nstripes_acc,
+                               uint8_t const * input, size_t nstripes) const
+{
+    while(nstripes > 0)
+    {
+        // The secret is advanced for each stripe in a block
+        const size_t todo = std::min(nstripes, xxh3_stripes_per_block - nstripes_acc);
+
+        kernel_->accumulate(acc, input, xxh3_secret + nstripes_acc * xxh3_secret_consume_rate, todo);
+
+        input += todo * xxh3_stripe_len;
+        nstripes -= todo;
+        nstripes_acc += todo;
+
+        if(nstripes_acc == xxh3_stripes_per_block)
+        {
+            kernel_->scramble(acc, xxh3_secret + xxh3_secret_size - xxh3_stripe_len);
+            nstripes_acc = 0;
+        }
+    }
+}
+
+
+void XXH3_64::finalize_acc_(uint64_t * acc) const
+{
+    std::copy(acc_.begin(), acc_.end(), acc);
+    size_t nstripes_acc = nstripes_acc_;
+
+    uint8_t const * last_secret = xxh3_secret + xxh3_secret_size - xxh3_stripe_len - xxh3_secret_lastacc_start;
+
+    if(nbuffer_ >= xxh3_stripe_len)
+    {
+        const size_t nstripes = (nbuffer_ - 1) / xxh3_stripe_len;
+        consume_stripes_(acc, nstripes_acc, buffer_.data(), nstripes);
+
+        kernel_->accumulate(acc, buffer_.data() + nbuffer_ - xxh3_stripe_len, last_secret, 1);
+    }
+    else
+    {
+        // The last stripe includes data from before
+        // the current contents of the buffer
+        uint8_t last_stripe[xxh3_stripe_len];
+        const size_t catchup = xxh3_stripe_len - nbuffer_;
+
+        std::copy(buffer_.end() - catchup, buffer_.end(), last_stripe);
+        std::copy(buffer_.begin(), buffer_.begin() + nbuffer_, last_stripe + catchup);
+
+        kernel_->accumulate(acc, last_stripe, last_secret, 1);
+    }
+}
+
+
+uint64_t XXH3_64::hash_short_(uint8_t const * input, size_t len)
+{
+    if(len > 128)
+        return xxh3_64_len_129to240(input, len);
+    else if(len > 16)
+        return xxh3_64_len_17to128(input, len);
+    else if(len > 8)
+        return xxh3_64_len_9to16(input, len);
+    else if(len >= 4)
+        return xxh3_64_len_4to8(input, len);
+    else if(len > 0)
+        return xxh3_64_len_1to3(input, len);
+    else
+        return xxh64_avalanche(xxh_read64(xxh3_secret + 56) ^ xxh_read64(xxh3_secret + 64));
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,114 @@
+/*! \file
+ * \brief XXH3 64-bit hash (header)
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include <array>
+
+#include "bphash/HashImpl.hpp"
+#include "bphash/XXH3_Common.hpp"
+
+namespace bphash {
+namespace detail {
+
+/*! \brief Implementation of the XXH3 64-bit hash
+ *
+ * This algorithm is the 64-bit XXH3 hash (with the default
+ * secret and a seed of zero) from the xxHash project,
+ * by Yann Collet. It is much faster than MurmurHash3 for
+ * large inputs, and has special handling for short inputs.
+ *
+ * The code here is adapted from the xxHash project at
+ * https://github.com/Cyan4973/xxHash, which is released
+ * under the BSD 2-clause license.
+ *
+ * Long inputs are hashed using one of the kernels in XXH3_Common.hpp.
+ * The hash is written in the canonical (big-endian) byte order, so
+ * that hash_to_string gives the same result as the xxhsum utility.
+ *
+ * No care has been taken to work with different endianness, etc,
+ * since that is beyond the scope of the project.
+ */
+class XXH3_64 : public HashImpl
+{
+    public:
+        //! Type of the fixed-size hash produced by this algorithm
+        typedef Digest64 digest_type;
+
+        /*! \brief Construct, using the default kernel for long inputs */
+        XXH3_64(void);
+
+        /*! \brief Construct, using a specific kernel for long inputs
+         *
+         * The kernel must be supported by the CPU.
+         */
+        explicit XXH3_64(const XXH3Kernel & kernel);
+
+        ~XXH3_64(void) = default;
+
+        XXH3_64(const XXH3_64 &) = default;
+        XXH3_64 & operator=(const XXH3_64 &) = default;
+        XXH3_64(XXH3_64 &&) = default;
+        XXH3_64 & operator=(XXH3_64 &&) = default;
+
+        /////////////////////////////////
+        // Virtual functions of HashImpl
+        /////////////////////////////////
+
+        virtual void update(void const * data, size_t nbytes);
+
+        virtual size_t hash_size(void) const;
+
+        virtual void finalize_into(uint8_t * out) const;
+
+        virtual std::unique_ptr<HashImpl> clone(void) const;
+
+        virtual void reset(void);
+
+
+    protected:
+        //! Size of the internal buffer
+        static const size_t buffer_size = 256;
+
+        const XXH3Kernel * kernel_;   //!< Kernel used for long inputs
+
+        std::array<uint64_t, xxh3_acc_nb> acc_;      //!< Accumulators for long inputs
+        std::array<uint8_t, buffer_size> buffer_;    //!< Holds the most recent input
+
+        size_t nbuffer_;        //!< Number of bytes in the buffer
+        size_t nstripes_acc_;   //!< Number of stripes accumulated in the current block
+        uint64_t len_;          //!< Total amount added to the hash
+
+
+        /*! \brief Accumulate stripes of the input, scrambling at the end of each block
+         *
+         * \param [inout] acc The accumulators
+         * \param [inout] nstripes_acc The number of stripes already accumulated in the current block
+         */
+        void consume_stripes_(uint64_t * acc, size_t & nstripes_acc,
+                              uint8_t const * input, size_t nstripes) const;
+
+
+        /*! \brief Accumulate everything still in the buffer (for long inputs)
+         *
+         * This does not change the state, so more data can be added afterwards.
+         *
+         * \param [out] acc The final values of the accumulators
+         */
+        void finalize_acc_(uint64_t * acc) const;
+
+
+        /*! \brief Hash an input of at most #xxh3_midsize_max bytes all at once */
+        static uint64_t hash_short_(uint8_t const * input, size_t len);
+};
+
+
+} // close namespace detail
+} // close namespace bphash
+
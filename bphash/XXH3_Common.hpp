@@ -0,0 +1,252 @@
+/*! \file
+ * \brief Constants, small functions, and kernels shared by the XXH3 implementations
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "bphash/CPUFeatures.hpp"
+
+namespace bphash {
+namespace detail {
+
+//////////////////////////////////////////
+// Constants of the algorithm
+//////////////////////////////////////////
+static const uint32_t xxh_prime32_1 = 0x9E3779B1U;
+static const uint32_t xxh_prime32_2 = 0x85EBCA77U;
+static const uint32_t xxh_prime32_3 = 0xC2B2AE3DU;
+
+static const uint64_t xxh_prime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t xxh_prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t xxh_prime64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t xxh_prime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t xxh_prime64_5 = 0x27D4EB2F165667C5ULL;
+
+static const size_t xxh3_stripe_len = 64;           //!< Bytes of input consumed by each stripe
+static const size_t xxh3_secret_consume_rate = 8;   //!< Secret bytes to advance for each stripe
+static const size_t xxh3_acc_nb = 8;                //!< Number of 64-bit accumulators
+static const size_t xxh3_secret_size = 192;         //!< Size of the default secret
+static const size_t xxh3_secret_size_min = 136;     //!< Minimum size of a secret
+static const size_t xxh3_midsize_max = 240;         //!< Largest input not using the accumulators
+static const size_t xxh3_secret_mergeaccs_start = 11;
+static const size_t xxh3_secret_lastacc_start = 7;
+
+//! Number of stripes before the accumulators are scrambled
+static const size_t xxh3_stripes_per_block = (xxh3_secret_size - xxh3_stripe_len) / xxh3_secret_consume_rate;
+
+//! The default secret ("kSecret") of XXH3
+extern const uint8_t xxh3_secret[xxh3_secret_size];
+
+
+
+//////////////////////////////////////////
+// Some small functions for the hash algo
+//////////////////////////////////////////
+inline uint32_t xxh_read32(uint8_t const * p)
+{
+    uint32_t ret;
+    std::memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+
+inline uint64_t xxh_read64(uint8_t const * p)
+{
+    uint64_t ret;
+    std::memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+
+inline uint32_t xxh_swap32(uint32_t x)
+{
+    return ((x << 24) & 0xff000000U) |
+           ((x <<  8) & 0x00ff0000U) |
+           ((x >>  8) & 0x0000ff00U) |
+           ((x >> 24) & 0x000000ffU);
+}
+
+
+inline uint64_t xxh_swap64(uint64_t x)
+{
+    return (static_cast<uint64_t>(xxh_swap32(static_cast<uint32_t>(x))) << 32) |
+            static_cast<uint64_t>(xxh_swap32(static_cast<uint32_t>(x >> 32)));
+}
+
+
+inline uint64_t xxh_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+
+inline uint64_t xxh_mult32to64(uint64_t x, uint64_t y)
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(x)) * static_cast<uint64_t>(static_cast<uint32_t>(y));
+}
+
+
+/*! \brief Full 64x64->128 bit multiplication
+ *
+ * \param [out] hi The upper 64 bits of the product
+ * \return The lower 64 bits of the product
+ */
+inline uint64_t xxh_mult64to128(uint64_t x, uint64_t y, uint64_t & hi)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128_type;
+
+    const uint128_type product = static_cast<uint128_type>(x) * y;
+    hi = static_cast<uint64_t>(product >> 64);
+    return static_cast<uint64_t>(product);
+#else
+    const uint64_t lo_lo = xxh_mult32to64(x & 0xFFFFFFFF, y & 0xFFFFFFFF);
+    const uint64_t hi_lo = xxh_mult32to64(x >> 32,        y & 0xFFFFFFFF);
+    const uint64_t lo_hi = xxh_mult32to64(x & 0xFFFFFFFF, y >> 32);
+    const uint64_t hi_hi = xxh_mult32to64(x >> 32,        y >> 32);
+
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    return (cross << 32) | (lo_lo & 0xFFFFFFFF);
+#endif
+}
+
+
+//! Multiply to 128 bits, then fold the halves together
+inline uint64_t xxh_mul128_fold64(uint64_t x, uint64_t y)
+{
+    uint64_t hi;
+    const uint64_t lo = xxh_mult64to128(x, y, hi);
+    return lo ^ hi;
+}
+
+
+inline uint64_t xxh_xorshift64(uint64_t v, int shift)
+{
+    return v ^ (v >> shift);
+}
+
+
+//! Final mix of XXH64
+inline uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= xxh_prime64_2;
+    h ^= h >> 29;
+    h *= xxh_prime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+
+//! Final mix of XXH3 (faster than xxh64_avalanche)
+inline uint64_t xxh3_avalanche(uint64_t h)
+{
+    h = xxh_xorshift64(h, 37);
+    h *= 0x165667919E3779F9ULL;
+    h = xxh_xorshift64(h, 32);
+    return h;
+}
+
+
+//! Stronger final mix of XXH3, used for inputs of 4 to 8 bytes
+inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= xxh_rotl64(h, 49) ^ xxh_rotl64(h, 24);
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= (h >> 35) + len;
+    h *= 0x9FB21C651E98DF25ULL;
+    return xxh_xorshift64(h, 28);
+}
+
+
+//! Mix 16 bytes of input with 16 bytes of secret
+inline uint64_t xxh3_mix16b(uint8_t const * input, uint8_t const * secret)
+{
+    return xxh_mul128_fold64(xxh_read64(input)     ^ xxh_read64(secret),
+                             xxh_read64(input + 8) ^ xxh_read64(secret + 8));
+}
+
+
+//! Combine two accumulators with 16 bytes of secret
+inline uint64_t xxh3_mix2accs(uint64_t const * acc, uint8_t const * secret)
+{
+    return xxh_mul128_fold64(acc[0] ^ xxh_read64(secret),
+                             acc[1] ^ xxh_read64(secret + 8));
+}
+
+
+//! Combine all the accumulators into a single 64-bit value
+inline uint64_t xxh3_merge_accs(uint64_t const * acc, uint8_t const * secret, uint64_t start)
+{
+    uint64_t result = start;
+
+    for(size_t i = 0; i < 4; i++)
+        result += xxh3_mix2accs(acc + 2*i, secret + 16*i);
+
+    return xxh3_avalanche(result);
+}
+
+
+
+//////////////////////////////////////////
+// Kernels for long inputs
+//////////////////////////////////////////
+
+/*! \brief Kernel functions that work on the accumulators for long inputs
+ *
+ * These are the only parts of XXH3 that benefit from vector
+ * instructions. All kernels give identical results.
+ */
+struct XXH3Kernel
+{
+    //! Name of the kernel (for diagnostics)
+    const char * name;
+
+    /*! \brief Accumulate several stripes of input
+     *
+     * Stripe `i` of \p input is mixed with the secret
+     * starting at `secret + 8*i`.
+     */
+    void (*accumulate)(uint64_t * acc, uint8_t const * input,
+                       uint8_t const * secret, size_t nstripes);
+
+    //! Scramble the accumulators (at the end of each block)
+    void (*scramble)(uint64_t * acc, uint8_t const * secret);
+};
+
+
+//! Portable kernel, using only 64-bit scalar operations
+extern const XXH3Kernel xxh3_kernel_scalar;
+
+#ifdef BPHASH_HAVE_X86_64
+#define BPHASH_XXH3_HAVE_X86_KERNELS
+
+//! Kernel using SSE2 (always available on x86-64)
+extern const XXH3Kernel xxh3_kernel_sse2;
+
+//! Kernel using AVX2. Must only be used if the CPU supports it.
+extern const XXH3Kernel xxh3_kernel_avx2;
+#endif
+
+
+/*! \brief The kernel used by default
+ *
+ * This is the best kernel supported by the CPU, chosen the
+ * first time this is called (see isa_level()).
+ */
+const XXH3Kernel & xxh3_default_kernel(void);
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -0,0 +1,239 @@
+/*! \file
+ * \brief Kernels for long inputs to the XXH3 hashes
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* The algorithm here is from the xxHash project by Yann Collet
+ * (https://github.com/Cyan4973/xxHash), released under
+ * the BSD 2-clause license. */
+
+#include "bphash/XXH3_Common.hpp"
+
+#ifdef BPHASH_XXH3_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace bphash {
+namespace detail {
+
+const uint8_t xxh3_secret[xxh3_secret_size] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e
+};
+
+
+
+////////////////////////////////
+// Scalar kernel
+////////////////////////////////
+
+static void accumulate_scalar(uint64_t * acc, uint8_t const * input,
+                              uint8_t const * secret, size_t nstripes)
+{
+    for(size_t s = 0; s < nstripes; s++)
+    {
+        uint8_t const * in = input + s * xxh3_stripe_len;
+        uint8_t const * sec = secret + s * xxh3_secret_consume_rate;
+
+        for(size_t i = 0; i < xxh3_acc_nb; i++)
+        {
+            const uint64_t data_val = xxh_read64(in + 8*i);
+            const uint64_t data_key = data_val ^ xxh_read64(sec + 8*i);
+
+            acc[i ^ 1] += data_val;
+            acc[i] += xxh_mult32to64(data_key & 0xFFFFFFFF, data_key >> 32);
+        }
+    }
+}
+
+
+static void scramble_scalar(uint64_t * acc, uint8_t const * secret)
+{
+    for(size_t i = 0; i < xxh3_acc_nb; i++)
+    {
+        uint64_t a = xxh_xorshift64(acc[i], 47);
+        a ^= xxh_read64(secret + 8*i);
+        acc[i] = a * xxh_prime32_1;
+    }
+}
+
+
+const XXH3Kernel xxh3_kernel_scalar = { "scalar", accumulate_scalar, scramble_scalar };
+
+
+
+#ifdef BPHASH_XXH3_HAVE_X86_KERNELS
+
+////////////////////////////////
+// SSE2 kernel
+////////////////////////////////
+
+static void accumulate_sse2(uint64_t * acc, uint8_t const * input,
+                            uint8_t const * secret, size_t nstripes)
+{
+    __m128i xacc[4];
+    for(size_t i = 0; i < 4; i++)
+        xacc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc) + i);
+
+    for(size_t s = 0; s < nstripes; s++)
+    {
+        const __m128i * in = reinterpret_cast<const __m128i *>(input + s * xxh3_stripe_len);
+        const __m128i * sec = reinterpret_cast<const __m128i *>(secret + s * xxh3_secret_consume_rate);
+
+        for(size_t i = 0; i < 4; i++)
+        {
+            const __m128i data_vec = _mm_loadu_si128(in + i);
+            const __m128i key_vec = _mm_loadu_si128(sec + i);
+            const __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+
+            // 32x32->64 multiply of the low and high halves of each lane
+            const __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+
+            // Add the input to the neighboring lane
+            const __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+            const __m128i sum = _mm_add_epi64(xacc[i], data_swap);
+            xacc[i] = _mm_add_epi64(product, sum);
+        }
+    }
+
+    for(size_t i = 0; i < 4; i++)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + i, xacc[i]);
+}
+
+
+static void scramble_sse2(uint64_t * acc, uint8_t const * secret)
+{
+    const __m128i prime32 = _mm_set1_epi32(static_cast<int>(xxh_prime32_1));
+
+    for(size_t i = 0; i < 4; i++)
+    {
+        __m128i * xacc = reinterpret_cast<__m128i *>(acc) + i;
+        const __m128i acc_vec = _mm_loadu_si128(xacc);
+        const __m128i shifted = _mm_srli_epi64(acc_vec, 47);
+        const __m128i data_vec = _mm_xor_si128(acc_vec, shifted);
+
+        const __m128i key_vec = _mm_loadu_si128(reinterpret_cast<const __m128i *>(secret) + i);
+        const __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+
+        // 64-bit multiply by a 32-bit constant, done as two 32x32->64 multiplies
+        const __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+        const __m128i prod_lo = _mm_mul_epu32(data_key, prime32);
+        const __m128i prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+        _mm_storeu_si128(xacc, _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+    }
+}
+
+
+const XXH3Kernel xxh3_kernel_sse2 = { "sse2", accumulate_sse2, scramble_sse2 };
+
+
+
+////////////////////////////////
+// AVX2 kernel
+////////////////////////////////
+
+BPHASH_TARGET_AVX2
+static void accumulate_avx2(uint64_t * acc, uint8_t const * input,
+                            uint8_t const * secret, size_t nstripes)
+{
+    __m256i xacc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc));
+    __m256i xacc1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc) + 1);
+
+    for(size_t s = 0; s < nstripes; s++)
+    {
+        const __m256i * in = reinterpret_cast<const __m256i *>(input + s * xxh3_stripe_len);
+        const __m256i * sec = reinterpret_cast<const __m256i *>(secret + s * xxh3_secret_consume_rate);
+
+        const __m256i data_vec0 = _mm256_loadu_si256(in);
+        const __m256i data_vec1 = _mm256_loadu_si256(in + 1);
+        const __m256i data_key0 = _mm256_xor_si256(data_vec0, _mm256_loadu_si256(sec));
+        const __m256i data_key1 = _mm256_xor_si256(data_vec1, _mm256_loadu_si256(sec + 1));
+
+        const __m256i product0 = _mm256_mul_epu32(data_key0, _mm256_srli_epi64(data_key0, 32));
+        const __m256i product1 = _mm256_mul_epu32(data_key1, _mm256_srli_epi64(data_key1, 32));
+
+        const __m256i data_swap0 = _mm256_shuffle_epi32(data_vec0, _MM_SHUFFLE(1, 0, 3, 2));
+        const __m256i data_swap1 = _mm256_shuffle_epi32(data_vec1, _MM_SHUFFLE(1, 0, 3, 2));
+
+        xacc0 = _mm256_add_epi64(product0, _mm256_add_epi64(xacc0, data_swap0));
+        xacc1 = _mm256_add_epi64(product1, _mm256_add_epi64(xacc1, data_swap1));
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc), xacc0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + 1, xacc1);
+}
+
+
+BPHASH_TARGET_AVX2
+static void scramble_avx2(uint64_t * acc, uint8_t const * secret)
+{
+    const __m256i prime32 = _mm256_set1_epi32(static_cast<int>(xxh_prime32_1));
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        __m256i * xacc = reinterpret_cast<__m256i *>(acc) + i;
+        const __m256i acc_vec = _mm256_loadu_si256(xacc);
+        const __m256i shifted = _mm256_srli_epi64(acc_vec, 47);
+        const __m256i data_vec = _mm256_xor_si256(acc_vec, shifted);
+
+        const __m256i key_vec = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(secret) + i);
+        const __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+
+        const __m256i data_key_hi = _mm256_srli_epi64(data_key, 32);
+        const __m256i prod_lo = _mm256_mul_epu32(data_key, prime32);
+        const __m256i prod_hi = _mm256_mul_epu32(data_key_hi, prime32);
+        _mm256_storeu_si256(xacc, _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32)));
+    }
+}
+
+
+const XXH3Kernel xxh3_kernel_avx2 = { "avx2", accumulate_avx2, scramble_avx2 };
+
+#endif // BPHASH_XXH3_HAVE_X86_KERNELS
+
+
+
+////////////////////////////////
+// Kernel selection
+////////////////////////////////
+
+static const XXH3Kernel & select_xxh3_kernel_(void)
+{
+#ifdef BPHASH_XXH3_HAVE_X86_KERNELS
+    const ISALevel level = isa_level();
+
+    if(level >= ISALevel::AVX2)
+        return xxh3_kernel_avx2;
+    if(level >= ISALevel::SSE2)
+        return xxh3_kernel_sse2;
+#endif
+
+    return xxh3_kernel_scalar;
+}
+
+
+const XXH3Kernel & xxh3_default_kernel(void)
+{
+    static const XXH3Kernel & kernel = select_xxh3_kernel_();
+    return kernel;
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -15,9 +15,9 @@ namespace bphash {
 namespace detail {
 
 /*! \brief Helper for hashing STL containers */
-template<typename Cont>
+template<typename Cont, typename HasherT>
 typename std::enable_if<is_hashable<typename Cont::value_type>::value, void>::type
-hash_container_object(const Cont & cont, Hasher & hasher)
+hash_container_object(const Cont & cont, HasherT & hasher)
 {
     // some containers don't have size() (ie, forward_list)
     size_t d = static_cast<size_t>(std::distance(cont.begin(), cont.end()));
@@ -0,0 +1,194 @@
+/*! \file
+ * \brief Helpers for hashing unordered STL containers
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/BasicHasher.hpp"
+#include "bphash/MurmurHash3_128_x64.hpp"
+#include "bphash/ThreadPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bphash {
+namespace detail {
+
+//! Hasher used for each element of an unordered container
+typedef BasicHasher<MurmurHash3_128_x64> UnorderedElementHasher;
+
+//! Sum of the hashes of elements (low 64 bits, then high 64 bits)
+typedef std::array<uint64_t, 2> UnorderedSum;
+
+//! Containers with at least this many elements are hashed on the thread pool
+static const size_t unordered_parallel_min = 16384;
+
+
+/*! \brief Add the hashes of \p n elements, starting at \p it
+ *
+ * Each element is hashed separately, and the 128-bit
+ * hashes are summed (modulo 2^128).
+ */
+template<typename Iterator>
+UnorderedSum sum_element_hashes(Iterator it, size_t n)
+{
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    for(size_t i = 0; i < n; i++, ++it)
+    {
+        UnorderedElementHasher h;
+        h(*it);
+        const Digest128 d = h.finalize_digest();
+
+        uint64_t dlo, dhi;
+        std::memcpy(&dlo, d.data(), sizeof(uint64_t));
+        std::memcpy(&dhi, d.data() + sizeof(uint64_t), sizeof(uint64_t));
+
+        lo += dlo;
+        hi += dhi + (lo < dlo);   // with the carry
+    }
+
+    return UnorderedSum{{lo, hi}};
+}
+
+
+/*! \brief Add two sums of element hashes */
+inline UnorderedSum add_element_sums(const UnorderedSum & a, const UnorderedSum & b)
+{
+    const uint64_t lo = a[0] + b[0];
+    return UnorderedSum{{lo, a[1] + b[1] + (lo < a[0])}};
+}
+
+
+/*! \brief Sum of the hashes of all the elements of a container
+ *
+ * Large containers are split into blocks of consecutive elements, which are
+ * hashed by the workers of \p pool. The calling thread also hashes blocks,
+ * and only waits for blocks that have been started by a worker. It is
+ * therefore safe to call this from a job running on the same pool.
+ *
+ * If hashing an element throws, the first exception is rethrown
+ * here once all the blocks are finished.
+ *
+ * The result does not depend on the number of threads.
+ */
+template<typename Cont>
+UnorderedSum sum_element_hashes(const Cont & cont, ThreadPool & pool)
+{
+    typedef typename Cont::const_iterator Iterator;
+
+    const size_t n = cont.size();
+    if(n < unordered_parallel_min || pool.size() < 2)
+        return sum_element_hashes(cont.begin(), n);
+
+    // Shared with the jobs, which may start after all the blocks
+    // are finished (and this function has returned)
+    struct State
+    {
+        std::vector<Iterator> starts;   // First element of each block
+        std::vector<size_t> sizes;      // Number of elements in each block
+        std::vector<UnorderedSum> sums;
+        std::atomic<size_t> next;       // Next block to be claimed
+        size_t ndone;                   // Number of blocks finished (or given up)
+        std::exception_ptr error;       // First exception thrown while hashing
+
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    const size_t nblocks = std::min(4 * pool.size(), n / (unordered_parallel_min / 4));
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->sums.resize(nblocks);
+    state->next = 0;
+    state->ndone = 0;
+
+    Iterator it = cont.begin();
+    for(size_t b = 0; b < nblocks; b++)
+    {
+        const size_t size = (n * (b+1)) / nblocks - (n * b) / nblocks;
+        state->starts.push_back(it);
+        state->sizes.push_back(size);
+        std::advance(it, size);
+    }
+
+    auto work = [state, nblocks](void)
+    {
+        size_t b;
+        while((b = state->next++) < nblocks)
+        {
+            std::exception_ptr error;
+            try {
+                state->sums[b] = sum_element_hashes(state->starts[b], state->sizes[b]);
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+
+            // The block is always counted, so that the caller doesn't wait forever
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if(error && !state->error)
+                state->error = error;
+            state->ndone++;
+            state->cv.notify_all();
+        }
+    };
+
+    for(size_t j = 1; j < nblocks; j++)
+        pool.submit(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state, nblocks] { return state->ndone == nblocks; });
+
+    // No worker uses the container any more
+    if(state->error)
+        std::rethrow_exception(state->error);
+
+    UnorderedSum sum{{0, 0}};
+    for(const auto & s : state->sums)
+        sum = add_element_sums(sum, s);
+    return sum;
+}
+
+
+/*! \brief Helper for hashing unordered STL containers
+ *
+ * Equal unordered containers may store their elements in different
+ * orders (for example, if they were inserted in a different order), so
+ * hashing the elements in turn is not suitable. Instead, each element
+ * is hashed separately (with the 128-bit MurmurHash3, whatever \p hasher is
+ * using), and the hashes are summed. The number of elements and the sum
+ * are then added to \p hasher.
+ *
+ * Containers with many elements are hashed on the default thread pool.
+ */
+template<typename Cont, typename HasherT>
+typename std::enable_if<is_hashable<typename Cont::value_type>::value, void>::type
+hash_unordered_container_object(const Cont & cont, HasherT & hasher)
+{
+    // Small containers don't start the thread pool
+    const UnorderedSum sum = cont.size() < unordered_parallel_min ?
+                             sum_element_hashes(cont.begin(), cont.size()) :
+                             sum_element_hashes(cont, default_thread_pool());
+    hasher(static_cast<size_t>(cont.size()), sum[0], sum[1]);
+}
+
+
+} // close namespace detail
+} // close namespace bphash
+
@@ -14,10 +14,20 @@
 
 namespace bphash {
 
-/*! \brief Hashing of std::array */
+/*! \brief A std::array can be hashed via its raw bytes if its elements can,
+ *         and if there is no padding */
 template<typename T, size_t N>
+struct is_contiguously_hashable<std::array<T, N>>
+{
+    static constexpr bool value = is_contiguously_hashable<T>::value &&
+                                  sizeof(std::array<T, N>) == N * sizeof(T);
+};
+
+
+/*! \brief Hashing of std::array */
+template<typename T, size_t N, typename HasherT>
 typename std::enable_if<is_hashable<T>::value, void>::type
-hash_object( const std::array<T, N> & a, Hasher & h)
+hash_object( const std::array<T, N> & a, HasherT & h)
 {
     h(hash_pointer(a.data(), N));
 }
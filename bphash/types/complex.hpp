@@ -14,10 +14,19 @@
 
 namespace bphash {
 
-/*! \brief Hashing of std::complex */
+/*! \brief A std::complex can be hashed via its raw bytes if its components can */
 template<typename T>
+struct is_contiguously_hashable<std::complex<T>>
+{
+    static constexpr bool value = is_contiguously_hashable<T>::value &&
+                                  sizeof(std::complex<T>) == 2 * sizeof(T);
+};
+
+
+/*! \brief Hashing of std::complex */
+template<typename T, typename HasherT>
 typename std::enable_if<is_hashable<T>::value, void>::type
-hash_object( const std::complex<T> & a, Hasher & h)
+hash_object( const std::complex<T> & a, HasherT & h)
 {
     h(a.real(), a.imag());
 }
@@ -15,9 +15,9 @@
 namespace bphash {
 
 /*! \brief Hashing of std::list */
-template<typename T, typename Alloc>
+template<typename T, typename Alloc, typename HasherT>
 typename std::enable_if<is_hashable<T>::value, void>::type
-hash_object( const std::list<T, Alloc> & a, Hasher & h)
+hash_object( const std::list<T, Alloc> & a, HasherT & h)
 {
     detail::hash_container_object(a, h);
 }
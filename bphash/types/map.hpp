@@ -16,9 +16,9 @@
 namespace bphash {
 
 /*! \brief Hashing of std::map */
-template<typename Key, typename T, typename Compare, typename Alloc>
+template<typename Key, typename T, typename Compare, typename Alloc, typename HasherT>
 typename std::enable_if<is_hashable<Key, T>::value, void>::type
-hash_object( const std::map<Key, T, Compare, Alloc> & m, Hasher & h)
+hash_object( const std::map<Key, T, Compare, Alloc> & m, HasherT & h)
 {
     detail::hash_container_object(m, h);
 }
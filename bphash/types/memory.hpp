@@ -70,9 +70,9 @@ PointerWrapper<T> hash_pointer(const std::shared_ptr<T[]> & ptr, size_t len)
  * It is assumed that the pointer points to a single element.
  * If not, you must wrap the pointer with hash_pointer.
  */
-template<typename T, typename Deleter>
+template<typename T, typename Deleter, typename HasherT>
 typename std::enable_if<is_hashable<T>::value, void>::type
-hash_object(const std::unique_ptr<T, Deleter> & p, Hasher & h)
+hash_object(const std::unique_ptr<T, Deleter> & p, HasherT & h)
 {
     h(hash_pointer(p)); 
 }
@@ -83,9 +83,9 @@ hash_object(const std::unique_ptr<T, Deleter> & p, Hasher & h)
  * It is assumed that the pointer points to a single element.
  * If not, you must wrap the pointer with hash_pointer.
  */
-template<typename T>
+template<typename T, typename HasherT>
 typename std::enable_if<is_hashable<T>::value, void>::type
-hash_object(const std::shared_ptr<T> & p, Hasher & h)
+hash_object(const std::shared_ptr<T> & p, HasherT & h)
 {
     h(hash_pointer(p)); 
 }
@@ -15,9 +15,9 @@
 namespace bphash {
 
 /*! \brief Hashing of std::set */
-template<typename Key, typename Compare, typename Alloc>
+template<typename Key, typename Compare, typename Alloc, typename HasherT>
 typename std::enable_if<is_hashable<Key>::value, void>::type
-hash_object( const std::set<Key, Compare, Alloc> & s, Hasher & h)
+hash_object( const std::set<Key, Compare, Alloc> & s, HasherT & h)
 {
     detail::hash_container_object(s, h);
 }
@@ -15,9 +15,9 @@
 namespace bphash {
 
 /*! \brief Hashing of std::string */
-template<typename charT, typename Traits, typename Alloc>
+template<typename charT, typename Traits, typename Alloc, typename HasherT>
 typename std::enable_if<is_hashable<charT>::value, void>::type
-hash_object( const std::basic_string<charT, Traits, Alloc> & s, Hasher & h)
+hash_object( const std::basic_string<charT, Traits, Alloc> & s, HasherT & h)
 {
     detail::hash_container_object(s, h);
 }
@@ -16,14 +16,14 @@ namespace bphash {
 namespace detail {
 
 
-template<size_t Idx, typename... Types>
+template<size_t Idx, typename HasherT, typename... Types>
 typename std::enable_if<Idx == sizeof...(Types), void>::type
-tuple_element_hasher(Hasher &, const std::tuple<Types...> &)
+tuple_element_hasher(HasherT &, const std::tuple<Types...> &)
 { }
 
-template<size_t Idx, typename... Types>
+template<size_t Idx, typename HasherT, typename... Types>
 typename std::enable_if<Idx < sizeof...(Types), void>::type
-tuple_element_hasher(Hasher & h, const std::tuple<Types...> & tup)
+tuple_element_hasher(HasherT & h, const std::tuple<Types...> & tup)
 {
     h(std::get<Idx>(tup));
     tuple_element_hasher<Idx+1>(h, tup);
@@ -34,9 +34,9 @@ tuple_element_hasher(Hasher & h, const std::tuple<Types...> & tup)
 
 
 
-template<typename... Types>
+template<typename HasherT, typename... Types>
 typename std::enable_if<is_hashable<Types...>::value, void>::type
-hash_object( const std::tuple<Types...> & tup, Hasher & h)
+hash_object( const std::tuple<Types...> & tup, HasherT & h)
 {
     detail::tuple_element_hasher<0>(h, tup);
 }
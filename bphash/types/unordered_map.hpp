@@ -9,18 +9,18 @@
 
 #pragma once
 
-#include "bphash/types/ContainerHelper.hpp"
+#include "bphash/types/UnorderedHelper.hpp"
 #include "bphash/types/utility.hpp"
 #include <unordered_map>
 
 namespace bphash {
 
 /*! \brief Hashing of std::unordered_map */
-template<typename Key, typename T, typename HashT, typename Pred, typename Alloc>
+template<typename Key, typename T, typename HashT, typename Pred, typename Alloc, typename HasherT>
 typename std::enable_if<is_hashable<Key, T>::value, void>::type
-hash_object( const std::unordered_map<Key, T, HashT, Pred, Alloc> & m, Hasher & h)
+hash_object( const std::unordered_map<Key, T, HashT, Pred, Alloc> & m, HasherT & h)
 {
-    detail::hash_container_object(m, h);
+    detail::hash_unordered_container_object(m, h);
 }
 
 
@@ -9,17 +9,17 @@
 
 #pragma once
 
-#include "bphash/types/ContainerHelper.hpp"
+#include "bphash/types/UnorderedHelper.hpp"
 #include <unordered_set>
 
 namespace bphash {
 
 /*! \brief Hashing of std::unordered_set */
-template<typename Key, typename HashT, typename Pred, typename Alloc>
+template<typename Key, typename HashT, typename Pred, typename Alloc, typename HasherT>
 typename std::enable_if<is_hashable<Key>::value, void>::type
-hash_object( const std::unordered_set<Key, HashT, Pred, Alloc> & s, Hasher & h)
+hash_object( const std::unordered_set<Key, HashT, Pred, Alloc> & s, HasherT & h)
 {
-    detail::hash_container_object(s, h);
+    detail::hash_unordered_container_object(s, h);
 }
 
 
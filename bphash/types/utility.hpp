@@ -14,10 +14,21 @@
 
 namespace bphash {
 
-/*! \brief Hashing of std::pair */
+/*! \brief A std::pair can be hashed via its raw bytes if its members can,
+ *         and if there is no padding */
 template<typename T1, typename T2>
+struct is_contiguously_hashable<std::pair<T1, T2>>
+{
+    static constexpr bool value = is_contiguously_hashable<T1>::value &&
+                                  is_contiguously_hashable<T2>::value &&
+                                  sizeof(std::pair<T1, T2>) == sizeof(T1) + sizeof(T2);
+};
+
+
+/*! \brief Hashing of std::pair */
+template<typename T1, typename T2, typename HasherT>
 typename std::enable_if<is_hashable<T1, T2>::value, void>::type
-hash_object( const std::pair<T1, T2> & p, Hasher & h)
+hash_object( const std::pair<T1, T2> & p, HasherT & h)
 {
     h(p.first, p.second);
 }
@@ -16,17 +16,17 @@
 namespace bphash {
 
 /*! \brief Hashing of std::vector */
-template<typename T, typename Alloc>
+template<typename T, typename Alloc, typename HasherT>
 typename std::enable_if<is_hashable<T>::value, void>::type
-hash_object(const std::vector<T, Alloc> & v, Hasher & h)
+hash_object(const std::vector<T, Alloc> & v, HasherT & h)
 {
     h(hash_pointer(v.data(), v.size()));
 }
 
 
 /*! \brief Hashing of std::vector<bool> */
-template<typename Alloc>
-void hash_object(const std::vector<bool, Alloc> & v, Hasher & h)
+template<typename Alloc, typename HasherT>
+void hash_object(const std::vector<bool, Alloc> & v, HasherT & h)
 {
     // specialization of vector for bool is stored
     // differently. So we have to go element by element
@@ -0,0 +1,199 @@
+/*! \file
+ * \brief Comparison of benchmark results against a baseline
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This program reads two JSON files written by test_benchmark (a stored
+ * baseline and a new run), and reports the change in throughput for each
+ * measurement found in both.
+ *
+ * A measurement is a regression if its median is slower than the baseline by more than
+ * the threshold, and the spread of the two runs do not overlap (the 10th percentile
+ * time of the new run is slower than the 90th percentile time of the baseline).
+ * The program returns 1 if there are any regressions, so it can be used in scripts. */
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+/* One measurement from the results file */
+struct Entry
+{
+    std::string key;    // group/name/size/chunk
+    double p10_ns;
+    double median_ns;
+    double p90_ns;
+};
+
+
+/* Parse the (flat) objects in the "results" array of a file written by test_benchmark
+ *
+ * This is not a general JSON parser. It handles objects containing
+ * only strings (without escapes) and numbers. */
+static std::vector<Entry> read_results(const std::string & path)
+{
+    std::ifstream f(path);
+    if(!f)
+        throw std::runtime_error("Cannot open " + path);
+
+    std::stringstream ss;
+    ss << f.rdbuf();
+    const std::string text = ss.str();
+
+    size_t pos = text.find("\"results\"");
+    if(pos == std::string::npos)
+        throw std::runtime_error("No results in " + path);
+
+    std::vector<Entry> entries;
+
+    while((pos = text.find('{', pos)) != std::string::npos)
+    {
+        const size_t end = text.find('}', pos);
+        if(end == std::string::npos)
+            throw std::runtime_error("Unterminated object in " + path);
+
+        // key -> value (as a string)
+        std::map<std::string, std::string> fields;
+        size_t p = pos + 1;
+
+        while(true)
+        {
+            const size_t kstart = text.find('"', p);
+            if(kstart == std::string::npos || kstart > end)
+                break;
+            const size_t kend = text.find('"', kstart + 1);
+            const size_t colon = text.find(':', kend);
+            const std::string key = text.substr(kstart + 1, kend - kstart - 1);
+
+            size_t vstart = text.find_first_not_of(" \t\n", colon + 1);
+            size_t vend;
+            std::string value;
+
+            if(text[vstart] == '"')
+            {
+                vend = text.find('"', vstart + 1);
+                value = text.substr(vstart + 1, vend - vstart - 1);
+                vend++;
+            }
+            else
+            {
+                vend = text.find_first_of(",}", vstart);
+                value = text.substr(vstart, vend - vstart);
+            }
+
+            fields[key] = value;
+            p = vend;
+        }
+
+        static const char * required[] = { "group", "name", "size", "chunk",
+                                           "p10_ns", "median_ns", "p90_ns" };
+        for(const char * r : required)
+        {
+            if(fields.count(r) == 0)
+                throw std::runtime_error(std::string("Missing '") + r + "' in " + path);
+        }
+
+        Entry e;
+        e.key = fields["group"] + "/" + fields["name"] + "/" + fields["size"] + "/" + fields["chunk"];
+        e.p10_ns = std::strtod(fields["p10_ns"].c_str(), nullptr);
+        e.median_ns = std::strtod(fields["median_ns"].c_str(), nullptr);
+        e.p90_ns = std::strtod(fields["p90_ns"].c_str(), nullptr);
+        entries.push_back(e);
+
+        pos = end + 1;
+    }
+
+    return entries;
+}
+
+
+int main(int argc, char ** argv)
+{
+    if(argc < 3 || argc > 4)
+    {
+        std::cout << "\n  usage: benchmark_compare baseline.json current.json [threshold_percent]\n\n"
+                  << "  The default threshold is 5 percent\n\n";
+        return 2;
+    }
+
+    const double threshold = (argc == 4) ? std::strtod(argv[3], nullptr) / 100.0 : 0.05;
+
+    try {
+
+    const std::vector<Entry> baseline = read_results(argv[1]);
+    const std::vector<Entry> current = read_results(argv[2]);
+
+    std::map<std::string, Entry> baseline_map;
+    for(const auto & e : baseline)
+        baseline_map[e.key] = e;
+
+    size_t nregress = 0;
+    size_t nimprove = 0;
+    size_t nmissing = 0;
+
+    std::cout << "\n" << std::left << std::setw(48) << "benchmark (group/name/size/chunk)"
+              << std::right << std::setw(14) << "baseline ns"
+              << std::setw(14) << "current ns"
+              << std::setw(10) << "change" << "\n";
+
+    for(const auto & cur : current)
+    {
+        auto it = baseline_map.find(cur.key);
+        if(it == baseline_map.end())
+        {
+            nmissing++;
+            continue;
+        }
+
+        const Entry & base = it->second;
+
+        // Positive is faster
+        const double change = base.median_ns / cur.median_ns - 1.0;
+
+        const char * flag = "";
+        if(change < -threshold && cur.p10_ns > base.p90_ns)
+        {
+            flag = "  REGRESSION";
+            nregress++;
+        }
+        else if(change > threshold && cur.p90_ns < base.p10_ns)
+        {
+            flag = "  improved";
+            nimprove++;
+        }
+
+        std::cout << std::left << std::setw(48) << cur.key << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(14) << base.median_ns
+                  << std::setw(14) << cur.median_ns
+                  << std::showpos << std::setw(9) << change * 100.0 << "%"
+                  << std::noshowpos << flag << "\n";
+    }
+
+    std::cout << "\n" << nregress << " regressions, " << nimprove << " improvements (threshold "
+              << threshold * 100.0 << "%)\n";
+    if(nmissing > 0)
+        std::cout << nmissing << " results are not in the baseline\n";
+    std::cout << "\n";
+
+    return (nregress > 0) ? 1 : 0;
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Comparison failed: " << ex.what() << "\n\n";
+        return 2;
+    }
+}
+
@@ -0,0 +1,166 @@
+/*! \file
+ * \brief Helper functions for benchmarking
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+#pragma once
+
+#include "bphash/Hasher.hpp"
+#include "bphash/CPUFeatures.hpp"
+#include "bphash/XXH3_Common.hpp"
+#include "bphash/CRC32C.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Keeps the compiler from removing the work being timed
+static volatile uint8_t benchmark_sink;
+
+
+/* Result of one measurement
+ *
+ * Times are per iteration, in nanoseconds. A lower
+ * percentile of time is a higher percentile of throughput. */
+struct BenchmarkResult
+{
+    std::string group;
+    std::string name;
+    size_t size;            // Bytes (or elements) processed per iteration
+    size_t chunk;           // Bytes passed to each update() (if meaningful)
+    size_t nsamples;
+    size_t iterations;      // Iterations per sample
+    double min_ns;
+    double p10_ns;
+    double median_ns;
+    double p90_ns;
+
+    // Other values to be written to the JSON file
+    std::vector<std::pair<std::string, double>> extra;
+};
+
+
+/* The distinct hash types (ignoring the aliases) */
+static const std::vector<std::pair<bphash::HashType, const char *>> benchmark_hash_types{
+    { bphash::HashType::Hash32_x32,   "Hash32_x32"   },
+    { bphash::HashType::Hash32_x64,   "Hash32_x64"   },
+    { bphash::HashType::Hash64_x64,   "Hash64_x64"   },
+    { bphash::HashType::Hash128_x64,  "Hash128_x64"  },
+    { bphash::HashType::Hash128_tree, "Hash128_tree" },
+    { bphash::HashType::Hash64_xxh3,  "Hash64_xxh3"  },
+    { bphash::HashType::Hash128_xxh3, "Hash128_xxh3" },
+    { bphash::HashType::CRC32C,       "CRC32C"       }
+};
+
+
+static inline double gib_per_sec(size_t nbytes, double ns)
+{
+    return (static_cast<double>(nbytes) / (1024.0*1024.0*1024.0)) / (ns * 1.0e-9);
+}
+
+
+/* Percentile of sorted values, interpolating between neighbors */
+static inline double percentile(const std::vector<double> & sorted, double p)
+{
+    const double pos = p * static_cast<double>(sorted.size() - 1);
+    const size_t lo = static_cast<size_t>(pos);
+    const size_t hi = std::min(lo + 1, sorted.size() - 1);
+    const double frac = pos - static_cast<double>(lo);
+    return sorted[lo] + frac * (sorted[hi] - sorted[lo]);
+}
+
+
+/* Time a function
+ *
+ * The number of iterations per sample is chosen so that each sample takes
+ * at least min_time seconds. This calibration also serves as a warmup. */
+template<typename Func>
+static BenchmarkResult measure(size_t nsamples, double min_time,
+                               const std::string & group, const std::string & name,
+                               size_t size, size_t chunk, Func func)
+{
+    typedef std::chrono::steady_clock clock;
+
+    auto run = [&func](size_t niter)
+    {
+        const auto t0 = clock::now();
+        for(size_t i = 0; i < niter; i++)
+            func();
+        return std::chrono::duration<double>(clock::now() - t0).count();
+    };
+
+    // Find the number of iterations (this also warms up)
+    size_t niter = 1;
+    double t = run(niter);
+    while(t < min_time)
+    {
+        const double scale = (t > 0) ? std::min(min_time / t * 1.2, 100.0) : 100.0;
+        niter = std::max(niter + 1, static_cast<size_t>(static_cast<double>(niter) * scale));
+        t = run(niter);
+    }
+
+    std::vector<double> samples(nsamples);
+    for(auto & it : samples)
+        it = run(niter) * 1.0e9 / static_cast<double>(niter);
+    std::sort(samples.begin(), samples.end());
+
+    BenchmarkResult r;
+    r.group = group;
+    r.name = name;
+    r.size = size;
+    r.chunk = chunk;
+    r.nsamples = nsamples;
+    r.iterations = niter;
+    r.min_ns = samples.front();
+    r.p10_ns = percentile(samples, 0.1);
+    r.median_ns = percentile(samples, 0.5);
+    r.p90_ns = percentile(samples, 0.9);
+    return r;
+}
+
+
+/* Write results in the format read by benchmark_compare */
+static void write_benchmark_json(const std::string & path, const std::vector<BenchmarkResult> & results)
+{
+    using namespace bphash::detail;
+
+    std::ofstream f(path, std::ios::trunc);
+    if(!f)
+        throw std::runtime_error("Cannot open " + path);
+
+    f << std::setprecision(10);
+    f << "{\n"
+      << "  \"bphash_benchmark\": 1,\n"
+      << "  \"isa\": \"" << isa_level_name(isa_level()) << "\",\n"
+      << "  \"xxh3_kernel\": \"" << xxh3_default_kernel().name << "\",\n"
+      << "  \"crc32c_kernel\": \"" << crc32c_default_kernel().name << "\",\n"
+      << "  \"results\": [\n";
+
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult & r = results[i];
+        f << "    {\"group\": \"" << r.group << "\", \"name\": \"" << r.name << "\""
+          << ", \"size\": " << r.size << ", \"chunk\": " << r.chunk
+          << ", \"samples\": " << r.nsamples << ", \"iterations\": " << r.iterations
+          << ", \"min_ns\": " << r.min_ns << ", \"p10_ns\": " << r.p10_ns
+          << ", \"median_ns\": " << r.median_ns << ", \"p90_ns\": " << r.p90_ns;
+
+        for(const auto & e : r.extra)
+            f << ", \"" << e.first << "\": " << e.second;
+
+        f << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    f << "  ]\n}\n";
+}
+
@@ -7,156 +7,348 @@
  * under the BSD 3-clause license. See the LICENSE file for details
  */
 
-/* This file tests the core MurmurHash algorithms against
- * the reference implementations in smhasher */
-
+/* This file measures the throughput of each hash algorithm over
+ * a range of input sizes and update() chunk sizes, along with the reference
+ * MurmurHash3 implementation and memcpy for comparison.
+ *
+ * Each measurement is repeated, and the median and percentiles are reported.
+ * The results can be written as JSON, to be compared against a stored
+ * baseline with the benchmark_compare program. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <random>
-#include <chrono>
-#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "bphash/Hasher.hpp"
-#include "bphash/types/vector.hpp"
+#include "bphash/HashBatch.hpp"
+#include "bphash/HashFile.hpp"
+#include "bphash/MerkleTree.hpp"
 
-#include "bphash/MurmurHash3_32_x64.hpp"
-#include "bphash/MurmurHash3_32_x32.hpp"
-#include "bphash/MurmurHash3_64_x64.hpp"
-#include "bphash/MurmurHash3_128_x64.hpp"
+#include "MurmurHash3_reference.h"
+#include "benchmark_helpers.hpp"
 
 using namespace bphash;
-using namespace std::chrono;
 
 
-static void random_fill(std::vector<uint8_t> & buffer)
+/* Options given on the command line */
+struct Options
 {
-    auto seed = system_clock::now().time_since_epoch().count();
-    std::default_random_engine generator(seed);
-    std::uniform_int_distribution<uint8_t> dist;
+    size_t max_size = 64*1024*1024;     // Largest input to sweep to (bytes)
+    size_t chunk_size = 1024*1024;      // Input size for the chunk and batch sweeps
+    size_t nsamples = 11;               // Number of timed samples per measurement
+    double min_time = 0.01;             // Minimum length of each sample (seconds)
+    std::string filter;                 // Only run benchmarks with names containing this
+    std::string json_path;              // Where to write the JSON results (if anywhere)
+};
 
-    for(auto & it : buffer)
-        it = dist(generator);
+
+static void print_header(const std::string & title)
+{
+    std::cout << "\n" << title << "\n"
+              << std::left << std::setw(24) << "  name"
+              << std::right << std::setw(12) << "size"
+              << std::setw(10) << "chunk"
+              << std::setw(14) << "median ns"
+              << std::setw(12) << "GiB/s"
+              << std::setw(12) << "p10 GiB/s"
+              << std::setw(12) << "p90 GiB/s" << "\n";
+}
+
+
+static void print_result(const BenchmarkResult & r)
+{
+    std::cout << "  " << std::left << std::setw(22) << r.name
+              << std::right << std::setw(12) << r.size
+              << std::setw(10) << r.chunk
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << r.median_ns
+              << std::setprecision(3)
+              << std::setw(12) << gib_per_sec(r.size, r.median_ns)
+              << std::setw(12) << gib_per_sec(r.size, r.p90_ns)
+              << std::setw(12) << gib_per_sec(r.size, r.p10_ns) << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+
+static void usage(void)
+{
+    std::cout << "\n  usage: test_benchmark [max_size] [options]\n\n"
+              << "  options:\n"
+              << "    --max-size N      Largest input to sweep to, in bytes (default 64 MiB)\n"
+              << "    --chunk-size N    Input size for the update() chunk and batch sweeps (default 1 MiB)\n"
+              << "    --samples N       Number of timed samples for each measurement (default 11)\n"
+              << "    --min-time-ms T   Minimum length of each sample, in milliseconds (default 10)\n"
+              << "    --filter STR      Only run benchmarks whose name contains STR\n"
+              << "    --json FILE       Write the results to FILE, for use with benchmark_compare\n\n";
+}
+
+
+static bool parse_options(int argc, char ** argv, Options & opt)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        const bool has_value = (i + 1 < argc);
+
+        if(arg == "--max-size" && has_value)
+            opt.max_size = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--chunk-size" && has_value)
+            opt.chunk_size = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--samples" && has_value)
+            opt.nsamples = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--min-time-ms" && has_value)
+            opt.min_time = std::strtod(argv[++i], nullptr) * 1.0e-3;
+        else if(arg == "--filter" && has_value)
+            opt.filter = argv[++i];
+        else if(arg == "--json" && has_value)
+            opt.json_path = argv[++i];
+        else if(!arg.empty() && arg[0] != '-')
+            opt.max_size = static_cast<size_t>(std::strtoull(arg.c_str(), nullptr, 10));
+        else
+            return false;
+    }
+
+    return opt.max_size > 0 && opt.chunk_size > 0 && opt.nsamples > 0;
 }
 
 
 int main(int argc, char ** argv)
 {
-    if(argc != 2)
+    Options opt;
+    if(!parse_options(argc, argv, opt))
     {
-        std::cout << "\n  Missing number of bytes to test\n";
-        std::cout << "\n  usage: bphash_benchmark nbytes\n\n";
+        usage();
         return 1;
     }
 
-    size_t nbytes = static_cast<size_t>(atol(argv[1]));
+    try {
 
-    std::vector<uint8_t> testdata(nbytes);
-    random_fill(testdata);
+    opt.chunk_size = std::min(opt.chunk_size, opt.max_size);
 
-    const void * testdata_ptr = testdata.data();
-    const size_t testdata_size = testdata.size();
+    // Random data
+    std::vector<uint8_t> testdata(opt.max_size);
+    std::mt19937_64 gen(12345);
+    for(auto & it : testdata)
+        it = static_cast<uint8_t>(gen());
 
-    std::cout << "\nTesting hashing of " << nbytes << " bytes\n";
-    std::cout << "Times in microseconds\n";
+    const uint8_t * data = testdata.data();
 
-    high_resolution_clock timer_clock;
+    // Input sizes: powers of 4, up to the maximum
+    std::vector<size_t> sizes;
+    for(size_t s = 1; s <= opt.max_size; s *= 4)
+        sizes.push_back(s);
 
-    // converts bytes/microsecond to GiB/second
-    const double conv_fac = 1.0e6/(1024.0 * 1024.0 * 1024.0);
+    std::vector<BenchmarkResult> results;
 
+    auto wanted = [&opt](const std::string & name)
     {
-        auto time0 = timer_clock.now();
-        detail::MurmurHash3_32_x32 mh32;
-        mh32.update(testdata_ptr, testdata_size);
-        HashValue bph_32 = mh32.finalize();
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "   32-bit x32 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
-    }
+        return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+    };
 
-    {
-        auto time0 = timer_clock.now();
-        detail::MurmurHash3_32_x64 mh32;
-        mh32.update(testdata_ptr, testdata_size);
-        HashValue bph_32 = mh32.finalize();
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "   32-bit x64 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
-    }
+    // Somewhere to copy the data to (only if memcpy is measured)
+    std::vector<uint8_t> copydest(wanted("memcpy") ? opt.max_size : 0);
 
+    auto add = [&results](BenchmarkResult r)
+    {
+        print_result(r);
+        r.extra.emplace_back("median_gibps", gib_per_sec(r.size, r.median_ns));
+        results.push_back(r);
+    };
+
+    std::cout << "\nKernels for " << detail::isa_level_name(detail::isa_level()) << ": "
+              << "XXH3 " << detail::xxh3_default_kernel().name << ", "
+              << "CRC32C " << detail::crc32c_default_kernel().name << "\n";
+    std::cout << "Median of " << opt.nsamples << " samples of at least "
+              << opt.min_time * 1.0e3 << " ms each\n";
+
+
+    ///////////////////////////////////////////
+    // Whole inputs, in a single update()
+    ///////////////////////////////////////////
+    for(size_t size : sizes)
     {
-        auto time0 = timer_clock.now();
-        detail::MurmurHash3_64_x64 mh64;
-        mh64.update(testdata_ptr, testdata_size);
-        HashValue bph_64 = mh64.finalize();
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "   64-bit x64 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
+        print_header("Inputs of " + std::to_string(size) + " bytes");
+
+        if(wanted("memcpy"))
+        {
+            uint8_t * dest = copydest.data();
+            add(measure(opt.nsamples, opt.min_time, "size", "memcpy", size, size, [=]
+            {
+                std::memcpy(dest, data, size);
+                benchmark_sink = dest[0];
+            }));
+        }
+
+        if(wanted("ref_x86_32"))
+        {
+            add(measure(opt.nsamples, opt.min_time, "size", "ref_x86_32", size, size, [=]
+            {
+                uint8_t out[4];
+                MurmurHash3_x86_32(data, static_cast<int>(size), 0, out);
+                benchmark_sink = out[0];
+            }));
+        }
+
+        if(wanted("ref_x64_128"))
+        {
+            add(measure(opt.nsamples, opt.min_time, "size", "ref_x64_128", size, size, [=]
+            {
+                uint8_t out[16];
+                MurmurHash3_x64_128(data, static_cast<int>(size), 0, out);
+                benchmark_sink = out[0];
+            }));
+        }
+
+        for(const auto & ht : benchmark_hash_types)
+        {
+            if(!wanted(ht.second))
+                continue;
+
+            std::shared_ptr<detail::HashImpl> impl(detail::make_hash_impl(ht.first));
+            add(measure(opt.nsamples, opt.min_time, "size", ht.second, size, size, [=]
+            {
+                uint8_t out[16];
+                impl->reset();
+                impl->update(data, size);
+                impl->finalize_into(out);
+                benchmark_sink = out[0];
+            }));
+        }
     }
 
+
+    ///////////////////////////////////////////
+    // Input given to update() in chunks
+    ///////////////////////////////////////////
+    const size_t size = opt.chunk_size;
+    print_header("Inputs of " + std::to_string(size) + " bytes, in chunks");
+
+    for(const auto & ht : benchmark_hash_types)
     {
-        auto time0 = timer_clock.now();
-        detail::MurmurHash3_128_x64 mh128;
-        mh128.update(testdata_ptr, testdata_size);
-        HashValue bph_128 = mh128.finalize();
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "  128-bit x64 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
+        if(!wanted(ht.second))
+            continue;
+
+        std::shared_ptr<detail::HashImpl> impl(detail::make_hash_impl(ht.first));
+
+        for(size_t chunk = 1; chunk <= std::min<size_t>(size, 64*1024); chunk *= 8)
+        {
+            add(measure(opt.nsamples, opt.min_time, "chunk", ht.second, size, chunk, [=]
+            {
+                uint8_t out[16];
+                impl->reset();
+                for(size_t i = 0; i < size; i += chunk)
+                    impl->update(data + i, std::min(chunk, size - i));
+                impl->finalize_into(out);
+                benchmark_sink = out[0];
+            }));
+        }
     }
 
-    std::cout << "\nHashing of vector via make_hash\n";
 
+    ///////////////////////////////////////////
+    // Many short keys, one at a time and in a batch
+    ///////////////////////////////////////////
+    const size_t keylen = 32;
+    const size_t nkeys = std::max<size_t>(size / keylen, 1);
+
+    std::vector<const void *> keyptrs(nkeys);
+    std::vector<size_t> keylens(nkeys, std::min(keylen, size));
+    std::vector<Digest128> digests(nkeys);
+
+    for(size_t i = 0; i < nkeys; i++)
+        keyptrs[i] = data + i * keylen;
+
+    print_header("Hashing of " + std::to_string(nkeys) + " keys");
+
+    for(const auto & ht : benchmark_hash_types)
     {
-        auto time0 = timer_clock.now();
-        HashValue bph_32 = make_hash(HashType::Hash32_x32, testdata);
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "   32-bit x32 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
+        if(!wanted(ht.second))
+            continue;
+
+        const HashType type = ht.first;
+        std::shared_ptr<detail::HashImpl> impl(detail::make_hash_impl(type));
+        const size_t nbytes = nkeys * keylens[0];
+
+        add(measure(opt.nsamples, opt.min_time, "keys", std::string(ht.second) + "_single", nbytes, keylens[0], [&, impl]
+        {
+            for(size_t i = 0; i < nkeys; i++)
+            {
+                impl->reset();
+                impl->update(keyptrs[i], keylens[i]);
+                impl->finalize_into(digests[i].data());
+            }
+            benchmark_sink = digests[0].data()[0];
+        }));
+
+        add(measure(opt.nsamples, opt.min_time, "keys", std::string(ht.second) + "_batch", nbytes, keylens[0], [&]
+        {
+            hash_batch(type, keyptrs.data(), keylens.data(), nkeys, digests.data());
+            benchmark_sink = digests[0].data()[0];
+        }));
     }
 
+
+    ///////////////////////////////////////////
+    // Other uses
+    ///////////////////////////////////////////
+    print_header("Other");
+
+    if(wanted("merkle_update"))
     {
-        auto time0 = timer_clock.now();
-        HashValue bph_32 = make_hash(HashType::Hash32_x64, testdata);
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "   32-bit x64 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
+        // Rehash after changing one byte
+        MerkleTree mt(data, opt.max_size, 64*1024);
+        uint8_t * mdata = testdata.data();
+
+        add(measure(opt.nsamples, opt.min_time, "other", "merkle_update", opt.max_size, 64*1024, [&]
+        {
+            mdata[opt.max_size/2]++;
+            mt.mark_dirty(opt.max_size/2, 1);
+            mt.update();
+            benchmark_sink = mt.digest().data()[0];
+        }));
     }
 
+    if(wanted("hash_file"))
     {
-        auto time0 = timer_clock.now();
-        HashValue bph_64 = make_hash(HashType::Hash64_x64, testdata);
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "   64-bit x64 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
+        // Probably cached by the OS
+        const char * path = "bphash_benchmark_file.bin";
+
+        {
+            std::ofstream f(path, std::ios::binary | std::ios::trunc);
+            f.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        }
+
+        add(measure(opt.nsamples, opt.min_time, "other", "hash_file", size, size, [&]
+        {
+            benchmark_sink = hash_file(path, HashType::Hash64_xxh3).at(0);
+        }));
+
+        std::remove(path);
     }
 
+    if(!opt.json_path.empty())
     {
-        auto time0 = timer_clock.now();
-        HashValue bph_128 = make_hash(HashType::Hash128_x64, testdata);
-        auto time1 = timer_clock.now();
-        auto elapsed = duration_cast<microseconds>(time1-time0).count();
-        double rate = static_cast<double>(nbytes)/static_cast<double>(elapsed);
-        std::cout << "  128-bit x64 hash: " << elapsed
-                  << " ( " << conv_fac*rate << " GiB/sec)\n";
+        write_benchmark_json(opt.json_path, results);
+        std::cout << "\nResults written to " << opt.json_path << "\n";
     }
 
-    std::cout << "\n\n";
-
-
+    std::cout << "\n";
 
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Benchmark failed: " << ex.what() << "\n\n";
+        return 1;
+    }
 
     return 0;
 }
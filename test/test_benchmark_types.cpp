@@ -0,0 +1,560 @@
+/*! \file
+ * \brief Benchmarking of hashing objects of standard library and user types
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file measures the cost of hashing structured objects with
+ * make_hash(), for each of the types supported in bphash/types, with
+ * varying numbers of elements and depths of nesting.
+ *
+ * Along with the time per element, this reports the number of bytes
+ * given to the hash algorithm for each byte of actual data (payload)
+ * in the object. Anything above 1 is overhead, such as the sizes added
+ * for each element or container. */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bphash/Hasher.hpp"
+#include "bphash/BasicHasher.hpp"
+#include "bphash/types/All.hpp"
+
+#include "benchmark_helpers.hpp"
+
+using namespace bphash;
+
+
+/* Options given on the command line */
+struct Options
+{
+    size_t max_elements = 65536;        // Largest container to sweep to
+    size_t max_depth = 5;               // Deepest nesting of user types
+    size_t nsamples = 11;               // Number of timed samples per measurement
+    double min_time = 0.01;             // Minimum length of each sample (seconds)
+    HashType type = HashType::Hash128;  // Hash to use
+    std::string type_name = "Hash128_x64";
+    std::string filter;                 // Only run benchmarks with names containing this
+    std::string json_path;              // Where to write the JSON results (if anywhere)
+};
+
+
+///////////////////////////////////////////
+// Counting the bytes given to the hash
+///////////////////////////////////////////
+
+/* Hash "algorithm" that only counts the data given to it */
+class ByteCounter : public detail::HashImpl
+{
+    public:
+        typedef Digest<8> digest_type;
+
+        ByteCounter(void) : nbytes_(0) { }
+
+        virtual void update(void const * data, size_t nbytes)
+        {
+            (void)data;
+            nbytes_ += nbytes;
+        }
+
+        virtual size_t hash_size(void) const { return sizeof(uint64_t); }
+
+        virtual void finalize_into(uint8_t * out) const
+        {
+            std::memcpy(out, &nbytes_, sizeof(uint64_t));
+        }
+
+        virtual void reset(void) { nbytes_ = 0; }
+
+        virtual std::unique_ptr<detail::HashImpl> clone(void) const
+        {
+            return std::unique_ptr<detail::HashImpl>(new ByteCounter(*this));
+        }
+
+    private:
+        uint64_t nbytes_;
+};
+
+
+template<typename T>
+static uint64_t bytes_fed(const T & obj)
+{
+    BasicHasher<ByteCounter> h;
+    h(obj);
+
+    uint64_t n;
+    std::memcpy(&n, h.peek_digest().data(), sizeof(uint64_t));
+    return n;
+}
+
+
+/* Unordered containers hash each element with a separate hasher, and only
+ * the number of elements and the sum of their hashes are fed to the hasher
+ * given. The bytes fed to the hashers of the elements are counted as well.
+ * (This is not done for unordered containers nested in other objects) */
+template<typename Cont>
+static uint64_t bytes_fed_unordered(const Cont & cont)
+{
+    BasicHasher<ByteCounter> h;
+    h(cont);
+
+    uint64_t n;
+    std::memcpy(&n, h.peek_digest().data(), sizeof(uint64_t));
+
+    for(const auto & v : cont)
+        n += bytes_fed(v);
+    return n;
+}
+
+template<typename K, typename H, typename E, typename A>
+static uint64_t bytes_fed(const std::unordered_set<K, H, E, A> & s)
+{
+    return bytes_fed_unordered(s);
+}
+
+template<typename K, typename V, typename H, typename E, typename A>
+static uint64_t bytes_fed(const std::unordered_map<K, V, H, E, A> & m)
+{
+    return bytes_fed_unordered(m);
+}
+
+
+///////////////////////////////////////////
+// A user type, nested in a tree
+///////////////////////////////////////////
+
+struct Node
+{
+    std::string name;
+    std::vector<double> values;
+    std::vector<Node> children;
+
+    template<typename HasherT>
+    void hash(HasherT & h) const { h(name, values, children); }
+};
+
+
+///////////////////////////////////////////
+// Bytes of actual data in an object
+///////////////////////////////////////////
+
+// All overloads are declared first, so that they can call each other
+template<typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type payload(const T &);
+static size_t payload(const std::string & s);
+static size_t payload(const std::vector<bool> & v);
+static size_t payload(const Node & n);
+template<typename T> size_t payload(const std::complex<T> &);
+template<typename T, size_t N> size_t payload(const std::array<T, N> & a);
+template<typename A, typename B> size_t payload(const std::pair<A, B> & p);
+template<typename... Types> size_t payload(const std::tuple<Types...> & t);
+template<typename T> size_t payload(const std::unique_ptr<T> & p);
+template<typename T> size_t payload(const std::shared_ptr<T> & p);
+template<typename C> auto payload(const C & c) -> decltype(c.begin(), size_t());
+
+
+template<typename T>
+typename std::enable_if<std::is_arithmetic<T>::value, size_t>::type payload(const T &)
+{
+    return sizeof(T);
+}
+
+static size_t payload(const std::string & s) { return s.size(); }
+
+static size_t payload(const std::vector<bool> & v) { return v.size(); }
+
+static size_t payload(const Node & n)
+{
+    return payload(n.name) + payload(n.values) + payload(n.children);
+}
+
+template<typename T>
+size_t payload(const std::complex<T> &) { return 2*sizeof(T); }
+
+template<typename T, size_t N>
+size_t payload(const std::array<T, N> & a)
+{
+    size_t n = 0;
+    for(const auto & it : a)
+        n += payload(it);
+    return n;
+}
+
+template<typename A, typename B>
+size_t payload(const std::pair<A, B> & p) { return payload(p.first) + payload(p.second); }
+
+template<size_t I, typename... Types>
+typename std::enable_if<I == sizeof...(Types), size_t>::type
+payload_tuple_(const std::tuple<Types...> &) { return 0; }
+
+template<size_t I, typename... Types>
+typename std::enable_if<I < sizeof...(Types), size_t>::type
+payload_tuple_(const std::tuple<Types...> & t)
+{
+    return payload(std::get<I>(t)) + payload_tuple_<I+1>(t);
+}
+
+template<typename... Types>
+size_t payload(const std::tuple<Types...> & t) { return payload_tuple_<0>(t); }
+
+template<typename T>
+size_t payload(const std::unique_ptr<T> & p) { return p ? payload(*p) : 0; }
+
+template<typename T>
+size_t payload(const std::shared_ptr<T> & p) { return p ? payload(*p) : 0; }
+
+template<typename C>
+auto payload(const C & c) -> decltype(c.begin(), size_t())
+{
+    size_t n = 0;
+    for(const auto & it : c)
+        n += payload(it);
+    return n;
+}
+
+
+///////////////////////////////////////////
+// Generating data
+///////////////////////////////////////////
+
+class Generator
+{
+    public:
+        Generator(void) : gen_(12345) { }
+
+        int make_int(void) { return static_cast<int>(gen_() % 1000000); }
+
+        double make_double(void) { return std::uniform_real_distribution<double>(-1e6, 1e6)(gen_); }
+
+        // Identifier-like strings, 4 to 32 characters long
+        std::string make_string(void)
+        {
+            static const char chars[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+            std::string s(4 + gen_() % 29, ' ');
+            for(auto & c : s)
+                c = chars[gen_() % (sizeof(chars) - 1)];
+            return s;
+        }
+
+        std::vector<double> make_doubles(size_t n)
+        {
+            std::vector<double> v(n);
+            for(auto & it : v)
+                it = make_double();
+            return v;
+        }
+
+        // A tree with the given depth, where each node has nchildren children
+        Node make_node(size_t depth, size_t nchildren)
+        {
+            Node n{make_string(), make_doubles(4), {}};
+            if(depth > 1)
+            {
+                for(size_t i = 0; i < nchildren; i++)
+                    n.children.push_back(make_node(depth - 1, nchildren));
+            }
+            return n;
+        }
+
+    private:
+        std::mt19937_64 gen_;
+};
+
+
+static void print_header(const std::string & title)
+{
+    std::cout << "\n" << title << "\n"
+              << std::left << std::setw(52) << "  type"
+              << std::right << std::setw(10) << "elements"
+              << std::setw(14) << "median ns"
+              << std::setw(10) << "ns/elem"
+              << std::setw(10) << "p10"
+              << std::setw(10) << "p90"
+              << std::setw(12) << "payload"
+              << std::setw(10) << "fed/byte" << "\n";
+}
+
+
+/* Measure the hashing of an object
+ *
+ * The result is keyed by the name, number of elements, and depth */
+template<typename T>
+static void run_case(const Options & opt, std::vector<BenchmarkResult> & results,
+                     const std::string & name, size_t nelements, size_t depth, const T & obj)
+{
+    if(!opt.filter.empty() && name.find(opt.filter) == std::string::npos)
+        return;
+
+    const HashType type = opt.type;
+    BenchmarkResult r = measure(opt.nsamples, opt.min_time, "types", name, nelements, depth, [&]
+    {
+        HashValue hv = make_hash(type, obj);
+        benchmark_sink = hv[0];
+    });
+
+    const double n = static_cast<double>(std::max<size_t>(nelements, 1));
+    const size_t payload_bytes = payload(obj);
+    const uint64_t fed = bytes_fed(obj);
+    const double fed_ratio = static_cast<double>(fed) / static_cast<double>(std::max<size_t>(payload_bytes, 1));
+
+    std::cout << "  " << std::left << std::setw(50) << name
+              << std::right << std::setw(10) << nelements
+              << std::fixed << std::setprecision(1)
+              << std::setw(14) << r.median_ns
+              << std::setprecision(2)
+              << std::setw(10) << r.median_ns / n
+              << std::setw(10) << r.p10_ns / n
+              << std::setw(10) << r.p90_ns / n
+              << std::setw(12) << payload_bytes
+              << std::setw(10) << fed_ratio << "\n";
+    std::cout.unsetf(std::ios::floatfield);
+
+    r.extra.emplace_back("ns_per_element", r.median_ns / n);
+    r.extra.emplace_back("payload_bytes", static_cast<double>(payload_bytes));
+    r.extra.emplace_back("fed_bytes", static_cast<double>(fed));
+    r.extra.emplace_back("fed_per_payload_byte", fed_ratio);
+    results.push_back(r);
+}
+
+
+int main(int argc, char ** argv)
+{
+    Options opt;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        const bool has_value = (i + 1 < argc);
+        bool ok = true;
+
+        if(arg == "--max-elements" && has_value)
+            opt.max_elements = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--max-depth" && has_value)
+            opt.max_depth = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--samples" && has_value)
+            opt.nsamples = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--min-time-ms" && has_value)
+            opt.min_time = std::strtod(argv[++i], nullptr) * 1.0e-3;
+        else if(arg == "--filter" && has_value)
+            opt.filter = argv[++i];
+        else if(arg == "--json" && has_value)
+            opt.json_path = argv[++i];
+        else if(arg == "--hash" && has_value)
+        {
+            opt.type_name = argv[++i];
+            ok = false;
+            for(const auto & ht : benchmark_hash_types)
+            {
+                if(opt.type_name == ht.second)
+                {
+                    opt.type = ht.first;
+                    ok = true;
+                }
+            }
+        }
+        else
+            ok = false;
+
+        if(!ok || opt.nsamples == 0)
+        {
+            std::cout << "\n  usage: test_benchmark_types [options]\n\n"
+                      << "  options:\n"
+                      << "    --max-elements N  Largest number of elements in a container (default 65536)\n"
+                      << "    --max-depth N     Deepest nesting of the user type tree (default 5)\n"
+                      << "    --hash NAME       Hash type to use (such as Hash128_x64 or Hash64_xxh3)\n"
+                      << "    --samples N       Number of timed samples for each measurement (default 11)\n"
+                      << "    --min-time-ms T   Minimum length of each sample, in milliseconds (default 10)\n"
+                      << "    --filter STR      Only run benchmarks whose type contains STR\n"
+                      << "    --json FILE       Write the results to FILE, for use with benchmark_compare\n\n";
+            return 1;
+        }
+    }
+
+    try {
+
+    std::vector<BenchmarkResult> results;
+    Generator gen;
+
+    std::cout << "\nHashing with " << opt.type_name;
+    #ifdef BPHASH_USE_TYPEID
+    std::cout << ", including the type of each object (BPHASH_USE_TYPEID)";
+    #endif
+    std::cout << "\n";
+    std::cout << "Median of " << opt.nsamples << " samples of at least "
+              << opt.min_time * 1.0e3 << " ms each\n";
+    std::cout << "fed/byte is the number of bytes hashed for each byte of data in the object\n";
+
+    for(size_t n = 1; n <= opt.max_elements; n *= 16)
+    {
+        print_header("Containers of " + std::to_string(n) + " elements");
+
+        std::vector<std::string> strings(n);
+        for(auto & it : strings)
+            it = gen.make_string();
+
+        std::vector<int> ints(n);
+        for(auto & it : ints)
+            it = gen.make_int();
+
+        const std::vector<double> doubles = gen.make_doubles(n);
+
+        // vector.hpp
+        run_case(opt, results, "std::vector<double>", n, 0, doubles);
+        run_case(opt, results, "std::vector<int>", n, 0, ints);
+        run_case(opt, results, "std::vector<std::string>", n, 0, strings);
+        {
+            std::vector<bool> v(n);
+            for(size_t i = 0; i < n; i++)
+                v[i] = (ints[i] % 2) != 0;
+            run_case(opt, results, "std::vector<bool>", n, 0, v);
+        }
+
+        // string.hpp
+        {
+            std::string s;
+            while(s.size() < n)
+                s += gen.make_string();
+            s.resize(n);
+            run_case(opt, results, "std::string", n, 0, s);
+        }
+
+        // complex.hpp and array.hpp
+        {
+            std::vector<std::complex<double>> v(n);
+            for(size_t i = 0; i < n; i++)
+                v[i] = std::complex<double>(doubles[i], -doubles[i]);
+            run_case(opt, results, "std::vector<std::complex<double>>", n, 0, v);
+
+            std::vector<std::array<double, 4>> va(n);
+            for(size_t i = 0; i < n; i++)
+                va[i] = {{doubles[i], 1.0, 2.0, 3.0}};
+            run_case(opt, results, "std::vector<std::array<double, 4>>", n, 0, va);
+        }
+
+        // list.hpp and forward_list.hpp
+        run_case(opt, results, "std::list<double>", n, 0,
+                 std::list<double>(doubles.begin(), doubles.end()));
+        run_case(opt, results, "std::list<std::string>", n, 0,
+                 std::list<std::string>(strings.begin(), strings.end()));
+        run_case(opt, results, "std::forward_list<double>", n, 0,
+                 std::forward_list<double>(doubles.begin(), doubles.end()));
+
+        // set.hpp and unordered_set.hpp
+        {
+            std::set<int> si(ints.begin(), ints.end());
+            std::set<std::string> ss(strings.begin(), strings.end());
+            std::unordered_set<int> usi(ints.begin(), ints.end());
+            run_case(opt, results, "std::set<int>", si.size(), 0, si);
+            run_case(opt, results, "std::set<std::string>", ss.size(), 0, ss);
+            run_case(opt, results, "std::unordered_set<int>", usi.size(), 0, usi);
+        }
+
+        // map.hpp and unordered_map.hpp
+        {
+            std::map<int, double> mid;
+            std::map<std::string, std::vector<double>> msv;
+            std::unordered_map<std::string, int> umsi;
+            for(size_t i = 0; i < n; i++)
+            {
+                mid[ints[i]] = doubles[i];
+                msv[strings[i]] = gen.make_doubles(8);
+                umsi[strings[i]] = ints[i];
+            }
+            run_case(opt, results, "std::map<int, double>", mid.size(), 0, mid);
+            run_case(opt, results, "std::map<std::string, std::vector<double>>", msv.size(), 0, msv);
+            run_case(opt, results, "std::unordered_map<std::string, int>", umsi.size(), 0, umsi);
+        }
+
+        // utility.hpp and tuple.hpp
+        {
+            std::vector<std::pair<int, std::string>> vp(n);
+            std::vector<std::tuple<int, double, std::string>> vt(n);
+            for(size_t i = 0; i < n; i++)
+            {
+                vp[i] = std::make_pair(ints[i], strings[i]);
+                vt[i] = std::make_tuple(ints[i], doubles[i], strings[i]);
+            }
+            run_case(opt, results, "std::vector<std::pair<int, std::string>>", n, 0, vp);
+            run_case(opt, results, "std::vector<std::tuple<int, double, std::string>>", n, 0, vt);
+        }
+
+        // memory.hpp
+        {
+            std::vector<std::unique_ptr<double>> vu;
+            std::vector<std::shared_ptr<std::string>> vs;
+            for(size_t i = 0; i < n; i++)
+            {
+                vu.emplace_back(new double(doubles[i]));
+                vs.push_back(std::make_shared<std::string>(strings[i]));
+            }
+            run_case(opt, results, "std::vector<std::unique_ptr<double>>", n, 0, vu);
+            run_case(opt, results, "std::vector<std::shared_ptr<std::string>>", n, 0, vs);
+        }
+    }
+
+
+    // The same number of doubles, split into more levels of vectors
+    print_header("Nested vectors of " + std::to_string(opt.max_elements) + " doubles");
+    {
+        const size_t n = opt.max_elements;
+        const size_t n2 = static_cast<size_t>(std::round(std::sqrt(static_cast<double>(n))));
+        const size_t n3 = static_cast<size_t>(std::round(std::cbrt(static_cast<double>(n))));
+
+        run_case(opt, results, "std::vector<double>", n, 1, gen.make_doubles(n));
+
+        std::vector<std::vector<double>> v2(n2);
+        for(auto & it : v2)
+            it = gen.make_doubles(n2);
+        run_case(opt, results, "std::vector<std::vector<double>>", n2*n2, 2, v2);
+
+        std::vector<std::vector<std::vector<double>>> v3(n3, std::vector<std::vector<double>>(n3));
+        for(auto & it : v3)
+            for(auto & it2 : it)
+                it2 = gen.make_doubles(n3);
+        run_case(opt, results, "std::vector<std::vector<std::vector<double>>>", n3*n3*n3, 3, v3);
+    }
+
+
+    // User types, nested in a tree with 4 children per node
+    print_header("Tree of user types (name, 4 doubles, children)");
+    for(size_t depth = 1; depth <= opt.max_depth; depth++)
+    {
+        const Node root = gen.make_node(depth, 4);
+
+        size_t nnodes = 0;
+        for(size_t d = 0, w = 1; d < depth; d++, w *= 4)
+            nnodes += w;
+
+        run_case(opt, results, "Node, depth " + std::to_string(depth), nnodes, depth, root);
+    }
+
+    if(!opt.json_path.empty())
+    {
+        write_benchmark_json(opt.json_path, results);
+        std::cout << "\nResults written to " << opt.json_path << "\n";
+    }
+
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Benchmark failed: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,169 @@
+/*! \file
+ * \brief Testing of CachedHash
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests that CachedHash only hashes the wrapped object
+ * when needed, and that enclosing hashes use the stored digest */
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bphash/CachedHash.hpp"
+#include "bphash/types/vector.hpp"
+#include "bphash/types/string.hpp"
+#include "bphash/XXH3_64.hpp"
+
+using namespace bphash;
+
+
+// Counts how many times it has been hashed
+static std::atomic<size_t> nhashed(0);
+
+struct Expensive
+{
+    std::string name;
+    std::vector<double> data;
+
+    void hash(Hasher & h) const
+    {
+        nhashed++;
+        h(name, data);
+    }
+
+    bool operator==(const Expensive & rhs) const
+    {
+        return name == rhs.name && data == rhs.data;
+    }
+};
+
+
+// Contains a cached object
+struct Outer
+{
+    int i;
+    CachedHash<Expensive> e;
+
+    template<typename HasherT>
+    void hash(HasherT & h) const { h(i, e); }
+};
+
+
+static void check(bool ok, const char * desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+int main(void)
+{
+    try {
+
+    std::cout << "\n";
+
+    const Expensive big{"big", std::vector<double>(100000, 1.234)};
+    const Digest128 ref = to_digest<16>(make_hash(HashType::Hash128, big));
+
+
+    std::cout << "Testing cached digest ... ";
+
+    nhashed = 0;
+    CachedHash<Expensive> c(big);
+    check(!c.has_digest(), "Digest computed before it was needed");
+    check(c.digest() == ref, "Wrong digest");
+    check(c.has_digest(), "Digest was not stored");
+
+    for(int i = 0; i < 10; i++)
+        make_hash(HashType::Hash128, c);
+
+    check(nhashed == 1, "Object hashed more than once");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing enclosing hash ... ";
+
+    Outer o{5, c};
+    check(nhashed == 1, "Copy did not keep the digest");
+
+    HashValue hv = make_hash(HashType::Hash64_xxh3, o);
+
+    // Only the digest is added to the enclosing hash (after the
+    // integer, which is its size followed by its bytes)
+    #ifndef BPHASH_USE_TYPEID
+    const int i = 5;
+    const size_t isize = sizeof(int);
+    detail::XXH3_64 raw;
+    raw.update(&isize, sizeof(size_t));
+    raw.update(&i, sizeof(int));
+    raw.update(ref.data(), ref.size());
+    check(hv == raw.finalize(), "Enclosing hash does not use the digest");
+    #endif
+
+    check(make_hash(HashType::Hash64_xxh3, o) == hv, "Enclosing hash is not reproducible");
+    check(nhashed == 1, "Object hashed more than once");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing invalidation ... ";
+
+    o.e.modify().name = "changed";
+    check(!o.e.has_digest(), "Digest kept after modification");
+    HashValue hv_changed = make_hash(HashType::Hash64_xxh3, o);
+    check(nhashed == 2, "Modified object not rehashed");
+    check(hv_changed != hv, "Hash did not change after modification");
+
+    o.e.invalidate();
+    check(make_hash(HashType::Hash64_xxh3, o) == hv_changed, "Hash changed after invalidation");
+    check(nhashed == 3, "Invalidated object not rehashed");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing comparison ... ";
+
+    CachedHash<Expensive> c2(big);
+    check(c == c2 && !(c != c2), "Equal objects compare unequal");
+    check(c != o.e && !(c == o.e), "Unequal objects compare equal");
+
+    CachedHash<Expensive> c3;
+    c3 = c2;
+    check(c3 == c2 && c3.has_digest(), "Assignment");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing concurrent digest ... ";
+
+    nhashed = 0;
+    CachedHash<Expensive> shared(big);
+    std::vector<Digest128> results(8);
+    std::vector<std::thread> threads;
+
+    for(size_t t = 0; t < results.size(); t++)
+        threads.emplace_back([&shared, &results, t] { results[t] = shared.digest(); });
+    for(auto & t : threads)
+        t.join();
+
+    check(nhashed == 1, "Object hashed by more than one thread");
+    for(const auto & d : results)
+        check(d == ref, "Wrong digest from a thread");
+    std::cout << "OK\n\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*! \file
+ * \brief Testing of the rolling hash and content-defined chunking
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file compares the chunks found by Chunker against a simple
+ * (slow) implementation of the same rule, and checks that the chunks
+ * do not depend on how the data is split between calls to update() */
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bphash/Chunker.hpp"
+
+using namespace bphash;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+static std::vector<uint8_t> random_data(size_t nbytes, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> data(nbytes);
+    for(auto & b : data)
+        b = static_cast<uint8_t>(gen());
+    return data;
+}
+
+
+// Chunk sizes found by checking the hash of every window separately
+static std::vector<size_t> reference_sizes(const std::vector<uint8_t> & data,
+                                           size_t min, size_t avg, size_t max)
+{
+    size_t bits = 0;
+    while((size_t(2) << bits) <= avg)
+        bits++;
+    avg = size_t(1) << bits;
+
+    const uint64_t mask_small = ~uint64_t(0) << (64 - (bits + 2));
+    const uint64_t mask_large = ~uint64_t(0) << (64 - (bits - 2));
+
+    std::vector<size_t> sizes;
+    size_t start = 0;
+    while(start < data.size())
+    {
+        const size_t left = data.size() - start;
+        size_t size = std::min(left, max);
+
+        for(size_t s = min; s < std::min(left + 1, max); s++)
+        {
+            GearHash h;
+            h.roll(data.data() + start + s - GearHash::window_size, GearHash::window_size);
+            if(!(h.value() & (s < avg ? mask_small : mask_large)))
+            {
+                size = s;
+                break;
+            }
+        }
+
+        sizes.push_back(size);
+        start += size;
+    }
+
+    return sizes;
+}
+
+
+static HashValue raw_hash(HashType type, uint8_t const * data, size_t nbytes)
+{
+    auto impl = detail::make_hash_impl(type);
+    impl->update(data, nbytes);
+
+    HashValue h(impl->hash_size());
+    impl->finalize_into(h.data());
+    return h;
+}
+
+
+static void test_gear(void)
+{
+    std::cout << "Testing the rolling hash ... ";
+
+    const auto data = random_data(1000, 1);
+    GearHash full;
+    full.roll(data.data(), data.size());
+
+    GearHash window;
+    for(size_t i = data.size() - GearHash::window_size; i < data.size(); i++)
+        window.roll(data[i]);
+
+    check(full.value() == window.value(), "Hash depends on bytes outside the window");
+
+    window.reset();
+    check(window.value() == 0, "reset() did not clear the hash");
+
+    std::cout << "OK\n";
+}
+
+
+static void test_reference(const std::vector<uint8_t> & data,
+                           size_t min, size_t avg, size_t max, HashType type)
+{
+    Chunker chunker(min, avg, max, type);
+    const auto chunks = chunker.chunk(data.data(), data.size());
+    const auto sizes = reference_sizes(data, min, avg, max);
+
+    check(chunks.size() == sizes.size(), "Wrong number of chunks");
+
+    uint64_t offset = 0;
+    for(size_t i = 0; i < chunks.size(); i++)
+    {
+        check(chunks[i].offset == offset, "Wrong offset of a chunk");
+        check(chunks[i].size == sizes[i], "Wrong size of a chunk");
+        check(chunks[i].size <= max, "Chunk larger than the maximum");
+        check(i + 1 == chunks.size() || chunks[i].size >= min, "Chunk smaller than the minimum");
+        check(chunks[i].digest == raw_hash(type, data.data() + offset, chunks[i].size),
+              "Wrong digest of a chunk");
+        offset += chunks[i].size;
+    }
+
+    check(offset == data.size(), "Chunks do not cover the data");
+}
+
+
+static void test_references(void)
+{
+    std::cout << "Testing against the reference implementation ... ";
+
+    const auto data = random_data(1000000, 2);
+    test_reference(data, 64, 256, 1024, HashType::Hash128);
+    test_reference(data, 64, 2048, 8192, HashType::Hash64_xxh3);
+    test_reference(data, 1000, 3000, 3000, HashType::Hash128);
+    test_reference(data, Chunker::default_min_size, Chunker::default_avg_size,
+                   Chunker::default_max_size, HashType::Hash128);
+
+    // Data without any ends (and shorter than the minimum)
+    test_reference(std::vector<uint8_t>(200000, 0), 64, 1024, 4096, HashType::Hash128);
+    test_reference(std::vector<uint8_t>(10, 1), 64, 1024, 4096, HashType::Hash128);
+    test_reference(std::vector<uint8_t>(), 64, 1024, 4096, HashType::Hash128);
+
+    std::cout << "OK\n";
+}
+
+
+static void test_pieces(void)
+{
+    std::cout << "Testing data given in pieces ... ";
+
+    const auto data = random_data(500000, 3);
+    Chunker chunker(128, 1024, 8192);
+    const auto expected = chunker.chunk(data.data(), data.size());
+
+    std::mt19937 gen(4);
+    for(size_t maxpiece : { size_t(1), size_t(100), size_t(5000), size_t(100000) })
+    {
+        std::vector<Chunker::Chunk> chunks;
+        size_t pos = 0;
+        size_t n = 0;
+        while(pos < data.size())
+        {
+            const size_t piece = std::min(data.size() - pos, 1 + gen() % maxpiece);
+            n += chunker.update(data.data() + pos, piece, chunks);
+            pos += piece;
+            check(chunker.offset() == pos, "Wrong offset");
+        }
+        n += chunker.finish(chunks);
+
+        check(n == chunks.size() && chunks.size() == expected.size(), "Wrong number of chunks");
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            check(chunks[i].offset == expected[i].offset && chunks[i].size == expected[i].size &&
+                  chunks[i].digest == expected[i].digest, "Chunks differ when given in pieces");
+        }
+        check(chunker.offset() == 0, "Not reset after finish()");
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_shift(void)
+{
+    std::cout << "Testing chunks after an insertion ... ";
+
+    auto data = random_data(2000000, 5);
+    Chunker chunker;
+    const auto before = chunker.chunk(data.data(), data.size());
+
+    const auto extra = random_data(100, 6);
+    data.insert(data.begin() + 1000, extra.begin(), extra.end());
+    const auto after = chunker.chunk(data.data(), data.size());
+
+    std::set<HashValue> digests;
+    for(const auto & c : before)
+        digests.insert(c.digest);
+
+    size_t nsame = 0;
+    for(const auto & c : after)
+        nsame += digests.count(c.digest);
+
+    check(nsame + 3 >= before.size(), "Too many chunks changed");
+
+    // The average should be near that requested
+    const double avg = 2000000.0 / before.size();
+    check(avg > Chunker::default_avg_size / 2 && avg < Chunker::default_avg_size * 2,
+          "Average chunk size is far from that requested");
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+        std::cout << "\n";
+        test_gear();
+        test_references();
+        test_pieces();
+        test_shift();
+
+        std::cout << "Testing invalid chunk sizes ... ";
+        size_t nthrown = 0;
+        try { Chunker c(32, 1024, 4096); } catch(const std::invalid_argument &) { nthrown++; }
+        try { Chunker c(2048, 1024, 4096); } catch(const std::invalid_argument &) { nthrown++; }
+        try { Chunker c(64, 1024, 512); } catch(const std::invalid_argument &) { nthrown++; }
+        check(nthrown == 3, "No exception thrown");
+        std::cout << "OK\n";
+
+        std::cout << "\n";
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
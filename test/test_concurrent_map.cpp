@@ -0,0 +1,139 @@
+/*! \file
+ * \brief Testing of concurrent_map
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests concurrent_map from a single thread, then with
+ * many threads inserting, updating, and erasing at once */
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bphash/ConcurrentMap.hpp"
+#include "bphash/types/string.hpp"
+
+using namespace bphash;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+static void test_single(size_t nshards)
+{
+    std::cout << "Testing with " << nshards << " shards ... ";
+
+    concurrent_map<std::string, int> m(nshards);
+    check(m.nshards() >= nshards && m.empty(), "Bad construction");
+
+    for(int i = 0; i < 1000; i++)
+        check(m.insert(std::to_string(i), i), "Insert failed");
+    check(!m.insert("7", 0), "Inserted a duplicate");
+    check(!m.insert_or_assign("7", 70), "insert_or_assign inserted a duplicate");
+    check(m.size() == 1000, "Wrong size");
+
+    int v = 0;
+    check(m.find("7", v) && v == 70, "Wrong value");
+    check(!m.find("1000", v), "Found a missing key");
+
+    // Hashing once and reusing the hash
+    const std::string key = "500";
+    const uint64_t h = m.hash(key);
+    check(m.contains(key, h), "Key not found with precomputed hash");
+    check(m.visit(key, h, [](int & x) { x = -1; }), "visit failed");
+    check(m.find(key, h, v) && v == -1, "visit did not change the value");
+    check(m.erase(key, h) && !m.contains(key), "Erase failed");
+
+    int sum = 0;
+    m.for_each([&sum](const std::string &, int & x) { sum += x; });
+    check(sum == 999*1000/2 - 7 + 70 - 500, "Wrong sum of values");
+
+    m.clear();
+    check(m.empty(), "Not empty after clear");
+    std::cout << "OK\n";
+}
+
+
+static void test_threads(void)
+{
+    std::cout << "Testing with many threads ... ";
+
+    const int nthreads = 8;
+    const int nkeys = 20000;
+    concurrent_map<int, int> m;
+
+    // Every thread inserts every key, and increments its count
+    std::vector<std::thread> threads;
+    for(int t = 0; t < nthreads; t++)
+    {
+        threads.emplace_back([&m, t]
+        {
+            for(int i = 0; i < nkeys; i++)
+            {
+                const int k = (i * 7 + t * 1000) % nkeys;
+                const uint64_t h = m.hash(k);
+                m.insert(k, h, 0);
+                m.visit(k, h, [](int & x) { x++; });
+            }
+        });
+    }
+    for(auto & t : threads)
+        t.join();
+    threads.clear();
+
+    check(m.size() == nkeys, "Wrong size");
+    bool all_counted = true;
+    m.for_each([&all_counted](int, int & x) { all_counted &= (x == nthreads); });
+    check(all_counted, "Some updates were lost");
+
+    // Each thread erases its own keys
+    for(int t = 0; t < nthreads; t++)
+    {
+        threads.emplace_back([&m, t]
+        {
+            for(int i = t; i < nkeys; i += nthreads)
+                check(m.erase(i), "Erase failed");
+        });
+    }
+    for(auto & t : threads)
+        t.join();
+
+    check(m.empty(), "Not empty after erasing");
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::cout << "\n";
+    test_single(1);
+    test_single(5);
+    test_single(64);
+    test_threads();
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,127 @@
+/*! \file
+ * \brief Testing of the compile-time MurmurHash3
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file checks that the constexpr hashes give the same digests as
+ * the runtime hashes, for all lengths of tail and several blocks */
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "bphash/ConstexprHash.hpp"
+#include "bphash/Hasher.hpp"
+
+using namespace bphash;
+using namespace bphash::literals;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+// Hashes of the raw bytes, by the runtime implementation
+template<size_t N>
+static Digest<N> runtime_hash(HashType type, const std::string & s)
+{
+    auto impl = detail::make_hash_impl(type);
+    impl->update(s.data(), s.size());
+
+    Digest<N> d;
+    impl->finalize_into(d.data());
+    return d;
+}
+
+
+// These must be usable where a constant is required
+static_assert(hash_literal("abc") != hash_literal("abd"), "Different literals give the same hash");
+static_assert(hash_literal("") == 0, "Wrong hash of an empty literal");
+static_assert("xyz"_bphash == hash_literal("xyz"), "Literal operator differs from hash_literal");
+static_assert(murmurhash3_32_x32_constexpr("abcd", 4).bytes[0] != 0 ||
+              murmurhash3_32_x32_constexpr("abcd", 4).bytes[1] != 0, "Unlikely zero hash");
+
+
+static int command_number(const std::string & name)
+{
+    switch(hash_literal(name.data(), name.size()))
+    {
+        case hash_literal("add"):    return 1;
+        case hash_literal("remove"): return 2;
+        case "list"_bphash:          return 3;
+        default:                     return 0;
+    }
+}
+
+
+static void test_lengths(void)
+{
+    std::cout << "Testing against the runtime hashes ... ";
+
+    std::string s;
+    for(size_t len = 0; len <= 80; len++)
+    {
+        const Digest128 d128 = murmurhash3_128_x64_constexpr(s.data(), s.size());
+        check(d128 == runtime_hash<16>(HashType::Hash128, s), "Wrong 128-bit hash");
+        check(murmurhash3_32_x32_constexpr(s.data(), s.size()) == runtime_hash<4>(HashType::Hash32_x32, s),
+              "Wrong 32-bit hash");
+
+        const Digest64 d64 = runtime_hash<8>(HashType::Hash64, s);
+        check(hash_literal(s.data(), s.size()) == convert_hash<uint64_t>(d64),
+              "hash_literal differs from the 64-bit hash");
+
+        // Include bytes with the high bit set
+        s.push_back(static_cast<char>(len * 37 + 100));
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_compile_time(void)
+{
+    std::cout << "Testing values computed at compile time ... ";
+
+    // A literal of a few blocks, with a tail
+    static constexpr Digest128 d128 = murmurhash3_128_x64_constexpr("The quick brown fox jumps over the lazy dog", 43);
+    static constexpr Digest32 d32 = murmurhash3_32_x32_constexpr("The quick brown fox jumps over the lazy dog", 43);
+    static constexpr uint64_t h = "The quick brown fox jumps over the lazy dog"_bphash;
+
+    const std::string s = "The quick brown fox jumps over the lazy dog";
+    check(d128 == runtime_hash<16>(HashType::Hash128, s), "Wrong 128-bit hash");
+    check(d32 == runtime_hash<4>(HashType::Hash32_x32, s), "Wrong 32-bit hash");
+    check(h == convert_hash<uint64_t>(runtime_hash<8>(HashType::Hash64, s)), "Wrong hash_literal");
+
+    check(command_number("add") == 1 && command_number("remove") == 2 &&
+          command_number("list") == 3 && command_number("other") == 0, "Wrong switch result");
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+        std::cout << "\n";
+        test_lengths();
+        test_compile_time();
+        std::cout << "\n";
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
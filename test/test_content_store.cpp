@@ -0,0 +1,218 @@
+/*! \file
+ * \brief Testing of ContentStore
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests the deduplication and reference counting of ContentStore,
+ * with many blobs so that the index grows and is rebuilt */
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bphash/ContentStore.hpp"
+
+using namespace bphash;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+static bool same(const ContentStore::Blob & b, const std::string & s)
+{
+    return b.data != nullptr && b.size == s.size() && std::memcmp(b.data, s.data(), s.size()) == 0;
+}
+
+
+static void test_basic(HashType type)
+{
+    std::cout << "Testing basic use ... ";
+
+    ContentStore store(type);
+    const std::string a = "Some data";
+    const std::string b(100000, 'x');   // Gets its own block of the arena
+
+    auto ra = store.insert(a.data(), a.size());
+    auto rb = store.insert(b.data(), b.size());
+    auto ra2 = store.insert(a.data(), a.size());
+    auto re = store.insert("", 0);
+
+    check(ra.second && rb.second && !ra2.second && re.second, "Wrong results of insert");
+    check(ra.first == ra2.first && ra.first != rb.first, "Wrong digests");
+    check(ra.first == store.digest(a.data(), a.size()), "Digest differs from digest()");
+    check(store.size() == 3 && store.stored_bytes() == a.size() + b.size(), "Wrong size");
+    check(store.deduplicated_bytes() == a.size(), "Wrong number of deduplicated bytes");
+
+    check(same(store.get(ra.first), a) && same(store.get(rb.first), b), "Wrong data");
+    check(store.get(re.first).data != nullptr && store.get(re.first).size == 0, "Wrong empty data");
+    check(store.refcount(ra.first) == 2 && store.refcount(rb.first) == 1, "Wrong reference counts");
+
+    check(store.acquire(rb.first) && store.refcount(rb.first) == 2, "acquire failed");
+    check(!store.release(rb.first) && store.release(rb.first), "Wrong results of release");
+    check(!store.contains(rb.first) && store.get(rb.first).data == nullptr, "Data was not removed");
+    check(!store.acquire(rb.first) && !store.release(rb.first), "Used removed data");
+    check(store.size() == 2 && store.stored_bytes() == a.size(), "Wrong size after release");
+
+    store.clear();
+    check(store.empty() && !store.contains(ra.first), "Not empty after clear");
+    std::cout << "OK\n";
+}
+
+
+static void test_many(void)
+{
+    std::cout << "Testing with many blobs ... ";
+
+    ContentStore store;
+    std::map<Digest128, std::pair<std::string, uint32_t>> ref;
+    std::vector<Digest128> digests;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> valdist(0, 5000);
+    std::uniform_int_distribution<int> lendist(0, 300);
+    std::uniform_int_distribution<int> opdist(0, 3);
+
+    for(int i = 0; i < 50000; i++)
+    {
+        const int op = opdist(gen);
+
+        if(op < 3 || digests.empty())
+        {
+            // Many values repeat, so they are deduplicated
+            const int v = valdist(gen);
+            const std::string s = std::string(static_cast<size_t>(v % 300), 'a') + std::to_string(v);
+            auto r = store.insert(s.data(), s.size());
+
+            auto & e = ref[r.first];
+            check(r.second == (e.second == 0), "Wrong result of insert");
+            if(e.second == 0)
+            {
+                e.first = s;
+                digests.push_back(r.first);
+            }
+            e.second++;
+        }
+        else
+        {
+            const size_t idx = static_cast<size_t>(lendist(gen)) % digests.size();
+            const Digest128 d = digests[idx];
+            auto & e = ref[d];
+            e.second--;
+
+            check(store.release(d) == (e.second == 0), "Wrong result of release");
+            if(e.second == 0)
+            {
+                ref.erase(d);
+                digests[idx] = digests.back();
+                digests.pop_back();
+            }
+        }
+    }
+
+    check(store.size() == ref.size(), "Wrong size");
+    for(const auto & e : ref)
+    {
+        check(same(store.get(e.first), e.second.first), "Wrong data");
+        check(store.refcount(e.first) == e.second.second, "Wrong reference count");
+    }
+
+    // Release everything. All the memory of the arena except one block should be freed.
+    for(const auto & e : ref)
+    {
+        for(uint32_t i = 0; i < e.second.second; i++)
+            store.release(e.first);
+    }
+    check(store.empty() && store.stored_bytes() == 0, "Not empty after releasing everything");
+    check(store.memory_usage() < 2 * detail::content_arena_block_size, "Memory was not released");
+
+    std::cout << "OK\n";
+}
+
+
+static void test_empty_blob(void)
+{
+    std::cout << "Testing an empty blob in a released block ... ";
+
+    // The empty blob is inserted while the block holding y is current.
+    // That block is then released before the empty blob.
+    ContentStore store;
+    const std::string y(200*1024, 'y');
+    const auto ry = store.insert(y.data(), y.size());
+    const auto re = store.insert("", 0);
+
+    std::vector<std::string> others;
+    std::vector<Digest128> rothers;
+    for(char c = 'a'; c < 'f'; c++)
+    {
+        others.push_back(std::string(200*1024, c));
+        rothers.push_back(store.insert(others.back().data(), others.back().size()).first);
+    }
+
+    for(size_t i = 0; i < 4; i++)
+        check(store.release(rothers[i]), "Wrong result of release");
+    check(store.release(ry.first), "Wrong result of release");
+    check(store.release(re.first), "Wrong result of release");
+
+    // Each of these gets a block of its own
+    const std::string big1(600*1024, '1');
+    const std::string big2(600*1024, '2');
+    const auto r1 = store.insert(big1.data(), big1.size());
+    const auto r2 = store.insert(big2.data(), big2.size());
+
+    check(same(store.get(r1.first), big1) && same(store.get(r2.first), big2), "Wrong data");
+    check(same(store.get(rothers[4]), others[4]), "Wrong data");
+    check(store.size() == 3, "Wrong size");
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::cout << "\n";
+    test_basic(HashType::Hash128);
+    test_basic(HashType::Hash128_xxh3);
+    test_many();
+    test_empty_blob();
+
+    std::cout << "Testing a hash of the wrong size ... ";
+    bool threw = false;
+    try {
+        ContentStore store(HashType::Hash64);
+    }
+    catch(const std::invalid_argument &)
+    {
+        threw = true;
+    }
+    check(threw, "No exception thrown");
+    std::cout << "OK\n";
+
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,264 @@
+/*! \file
+ * \brief Testing of the CRC32C checksum
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests the CRC32C kernels against published check values
+ * (including those from RFC 3720) and against a simple bit-at-a-time
+ * implementation */
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bphash/Hasher.hpp"
+#include "bphash/HashBatch.hpp"
+#include "bphash/CRC32C.hpp"
+
+// Size of the test set. Make it an odd number
+#define TEST_SIZE 1024*1024 + 7
+
+using namespace bphash;
+
+
+// Bit-at-a-time CRC32C. Slow, but obviously correct
+static uint32_t crc32c_bitwise(uint8_t const * data, size_t nbytes)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for(size_t i = 0; i < nbytes; i++)
+    {
+        crc ^= data[i];
+        for(int k = 0; k < 8; k++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : (crc >> 1);
+    }
+
+    return ~crc;
+}
+
+
+static std::string crc_to_string(uint32_t crc)
+{
+    std::stringstream ss;
+    ss.fill('0');
+    ss.width(8);
+    ss << std::hex << crc;
+    return ss.str();
+}
+
+
+static std::string kernel_crc(const detail::CRC32CKernel & kernel,
+                              uint8_t const * data, size_t nbytes)
+{
+    detail::CRC32C crc(kernel);
+    crc.update(data, nbytes);
+    return hash_to_string(crc.finalize());
+}
+
+
+static void test_check_values(const detail::CRC32CKernel & kernel)
+{
+    std::cout << "Testing CRC32C check values, " << kernel.name << " kernel ... ";
+
+    // RFC 3720, appendix B.4
+    uint8_t zeros[32], ones[32], incr[32], decr[32];
+    for(size_t i = 0; i < 32; i++)
+    {
+        zeros[i] = 0x00;
+        ones[i] = 0xFF;
+        incr[i] = static_cast<uint8_t>(i);
+        decr[i] = static_cast<uint8_t>(31 - i);
+    }
+
+    const char * check = "123456789";
+
+    if(kernel_crc(kernel, reinterpret_cast<uint8_t const *>(check), 9) != "e3069283" ||
+       kernel_crc(kernel, zeros, 32) != "8a9136aa" ||
+       kernel_crc(kernel, ones, 32)  != "62a8ab43" ||
+       kernel_crc(kernel, incr, 32)  != "46dd794e" ||
+       kernel_crc(kernel, decr, 32)  != "113fdb5c" ||
+       kernel_crc(kernel, zeros, 0)  != "00000000")
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Mismatch: CRC32C check values, ") + kernel.name + " kernel");
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_kernel(const detail::CRC32CKernel & kernel, const std::vector<uint8_t> & testdata)
+{
+    test_check_values(kernel);
+
+    std::cout << "Testing CRC32C lengths and alignments, " << kernel.name << " kernel ... ";
+
+    // Covers all the alignment prologues and the transitions between
+    // the interleaved, word, and byte loops
+    const size_t lengths[] = { 0, 1, 7, 8, 9, 63, 767, 768, 769, 1000,
+                               24575, 24576, 24577, 30000, 100003 };
+
+    for(size_t start = 0; start < 16; start++)
+    for(size_t len : lengths)
+    {
+        std::string calc = kernel_crc(kernel, testdata.data() + start, len);
+        std::string ref = crc_to_string(crc32c_bitwise(testdata.data() + start, len));
+
+        if(calc != ref)
+        {
+            std::cout << "FAILED\n";
+
+            std::stringstream ss;
+            ss << "Mismatch: CRC32C, " << kernel.name << " kernel,"
+               << " start " << start << " length " << len << ": " << calc << " vs. " << ref;
+
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_offset(detail::HashImpl & hasher,
+                        const std::vector<uint8_t> & testdata,
+                        size_t offset, size_t blocksize,
+                        const std::string & reference)
+{
+    hasher.reset();
+    hasher.update(testdata.data(), offset);
+
+    if(blocksize == 0)
+        blocksize = testdata.size() - offset;
+
+    size_t done = offset;
+    size_t todo = 0;
+
+    do {
+        todo = blocksize;
+        if( (done + todo) > testdata.size() )
+            todo = testdata.size() - done;
+
+        hasher.update(testdata.data() + done, todo);
+        done += todo;
+
+    } while(todo);
+
+    std::string calc = hash_to_string(hasher.finalize());
+
+    if(calc != reference)
+    {
+        std::cout << "FAILED\n";
+
+        std::stringstream ss;
+        ss << "Mismatch: CRC32C, offset " << offset << " blocksize " << blocksize;
+        throw std::runtime_error(ss.str());
+    }
+}
+
+
+int main(void)
+{
+    std::vector<uint8_t> testdata(TEST_SIZE);
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for(auto & it : testdata)
+        it = static_cast<uint8_t>(dist(gen));
+
+    const std::string full = crc_to_string(crc32c_bitwise(testdata.data(), testdata.size()));
+
+    try {
+
+    std::cout << "\n";
+
+    // All kernels supported by this machine
+    test_kernel(detail::crc32c_kernel_table, testdata);
+
+#ifdef BPHASH_CRC32C_HAVE_SSE42_KERNEL
+#if defined(__GNUC__)
+    if(__builtin_cpu_supports("sse4.2"))
+        test_kernel(detail::crc32c_kernel_sse42, testdata);
+    else
+        std::cout << "Skipping SSE4.2 kernel (not supported by this CPU)\n";
+#endif
+#endif
+
+    std::cout << "\n";
+
+
+    // try with different offsets (to test progressive hashing)
+    std::cout << "Testing CRC32C progressive hashing ... ";
+
+    detail::CRC32C crc;
+
+    for(size_t i = 0; i <= 300; i += 13)
+    for(size_t j = 0; j <= 1150; j += 23) // purposely odd numbers
+        test_offset(crc, testdata, i, j, full);
+
+    std::cout << "OK\n";
+
+
+    // Through the rest of the library. Raw bytes are passed
+    // to the hash algorithm when hashed via a pointer, followed by
+    // the number of elements.
+    std::cout << "Testing CRC32C via make_hash ... ";
+
+    std::vector<uint8_t> withsize(testdata.begin(), testdata.begin() + 1000);
+    const size_t n = 1000;
+    withsize.resize(n + sizeof(size_t));
+    std::memcpy(withsize.data() + n, &n, sizeof(size_t));
+
+    #ifndef BPHASH_USE_TYPEID
+    if(hash_to_string(make_hash(HashType::CRC32C, hash_pointer(testdata.data(), n))) !=
+       crc_to_string(crc32c_bitwise(withsize.data(), withsize.size())))
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error("Mismatch: CRC32C via make_hash");
+    }
+    #endif
+
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing CRC32C via hash_batch ... ";
+
+    std::vector<const void *> ptrs;
+    std::vector<size_t> lens;
+    for(size_t len = 0; len < 5000; len += 37)
+    {
+        ptrs.push_back(testdata.data() + len);
+        lens.push_back(len);
+    }
+
+    std::vector<Digest32> digests(ptrs.size());
+    hash_batch(HashType::CRC32C, ptrs.data(), lens.data(), ptrs.size(), digests.data());
+
+    for(size_t i = 0; i < ptrs.size(); i++)
+    {
+        uint8_t const * p = static_cast<uint8_t const *>(ptrs[i]);
+        if(hash_to_string(digests[i]) != crc_to_string(crc32c_bitwise(p, lens[i])))
+        {
+            std::cout << "FAILED\n";
+            throw std::runtime_error("Mismatch: CRC32C via hash_batch");
+        }
+    }
+
+    std::cout << "OK\n\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
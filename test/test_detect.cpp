@@ -86,6 +86,25 @@ void hash_object(const HashFreeTemplate<T> & hft, Hasher & h)
 }
 
 
+// This class is declared to be hashable via its raw bytes
+struct Contiguous
+{
+    int i;
+    float f;
+};
+
+namespace bphash {
+template<> struct is_contiguously_hashable<Contiguous> : public std::true_type { };
+}
+
+
+enum class TestEnum
+{
+    Value1,
+    Value2
+};
+
+
 #define IS_HASHABLE(type)     static_assert(is_hashable<type>::value, "Type " #type  " is not hashable, but should be")
 #define IS_NOT_HASHABLE(type) static_assert(!is_hashable<type>::value, "Type " #type " is hashable, but shouldn't be")
 
@@ -166,6 +185,22 @@ int main(void)
     static_assert(!is_hashable<std::pair<HashMember_BadSig0, int>>::value, "Test");
 
 
+    // Types that can be hashed via their raw bytes
+    static_assert(is_contiguously_hashable<int>::value, "Failed test for contiguous int");
+    static_assert(is_contiguously_hashable<TestEnum>::value, "Failed test for contiguous enum");
+    static_assert(is_contiguously_hashable<std::pair<int, int>>::value, "Failed test for contiguous pair");
+    static_assert(is_contiguously_hashable<std::complex<double>>::value, "Failed test for contiguous complex");
+    static_assert(is_contiguously_hashable<std::array<std::complex<double>, 4>>::value, "Failed test for contiguous array");
+    static_assert(is_contiguously_hashable<std::pair<std::array<int, 2>, long>>::value, "Failed test for contiguous nested pair");
+    static_assert(is_contiguously_hashable<Contiguous>::value, "Failed test for contiguous opt-in");
+    static_assert(is_hashable<Contiguous>::value, "Failed test for contiguous opt-in");
+    static_assert(!is_contiguously_hashable<std::pair<char, int>>::value, "Failed test for padded pair");
+    static_assert(!is_contiguously_hashable<std::pair<int, std::string>>::value, "Failed test for pair with string");
+    static_assert(!is_contiguously_hashable<std::array<int, 0>>::value, "Failed test for empty array");
+    static_assert(!is_contiguously_hashable<int *>::value, "Failed test for pointer");
+    static_assert(!is_contiguously_hashable<HashMember>::value, "Failed test for class");
+
+
     static_assert(is_hashable<HashMember>::value, "Failed test for Hash Member");
 
     static_assert(!is_hashable<HashMember_BadSig0>::value, "Failed test for member function bad signature 0");
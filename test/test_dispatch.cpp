@@ -0,0 +1,155 @@
+/*! \file
+ * \brief Testing of the runtime selection of kernels
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests that the kernels used by default match the
+ * instruction sets supported by the CPU, and the BPHASH_ISA environment
+ * variable. It is run by ctest with and without BPHASH_ISA set */
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bphash/CPUFeatures.hpp"
+#include "bphash/XXH3_64.hpp"
+#include "bphash/CRC32C.hpp"
+
+using namespace bphash;
+using namespace bphash::detail;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+static void test_names(void)
+{
+    std::cout << "Testing ISA level names ... ";
+
+    const ISALevel all[] = { ISALevel::Generic, ISALevel::SSE2,
+                             ISALevel::SSE42, ISALevel::AVX2 };
+
+    for(ISALevel l : all)
+    {
+        ISALevel parsed = ISALevel::Generic;
+        check(parse_isa_level(isa_level_name(l), parsed) && parsed == l,
+              std::string("Round trip of ISA level ") + isa_level_name(l));
+    }
+
+    ISALevel parsed = ISALevel::SSE2;
+    check(!parse_isa_level("avx9000", parsed) && parsed == ISALevel::SSE2,
+          "Parsing an unknown ISA level");
+    check(!parse_isa_level("", parsed), "Parsing an empty ISA level");
+
+    std::cout << "OK\n";
+}
+
+
+static void test_level(void)
+{
+    const ISALevel detected = detect_isa_level();
+    const ISALevel level = isa_level();
+
+    std::cout << "Testing ISA level (detected " << isa_level_name(detected)
+              << ", using " << isa_level_name(level) << ") ... ";
+
+    ISALevel expected = detected;
+    ISALevel requested;
+    const char * env = std::getenv("BPHASH_ISA");
+    if(env != nullptr && parse_isa_level(env, requested) && requested < detected)
+        expected = requested;
+
+    check(level == expected, "ISA level does not match the CPU and BPHASH_ISA");
+    check(isa_level() == level, "ISA level changed between calls");
+
+#if defined(BPHASH_HAVE_X86_64) && defined(__GNUC__)
+    check((detected >= ISALevel::AVX2) == static_cast<bool>(__builtin_cpu_supports("avx2")),
+          "Detection of AVX2");
+    check((detected >= ISALevel::SSE42) == static_cast<bool>(__builtin_cpu_supports("sse4.2")),
+          "Detection of SSE4.2");
+#endif
+
+    std::cout << "OK\n";
+}
+
+
+static void test_default_kernels(void)
+{
+    const ISALevel level = isa_level();
+    const XXH3Kernel & xxh3 = xxh3_default_kernel();
+    const CRC32CKernel & crc = crc32c_default_kernel();
+
+    std::cout << "Testing default kernels (XXH3 " << xxh3.name
+              << ", CRC32C " << crc.name << ") ... ";
+
+    const XXH3Kernel * xxh3_expected = &xxh3_kernel_scalar;
+    const CRC32CKernel * crc_expected = &crc32c_kernel_table;
+
+#ifdef BPHASH_XXH3_HAVE_X86_KERNELS
+    if(level >= ISALevel::AVX2)
+        xxh3_expected = &xxh3_kernel_avx2;
+    else if(level >= ISALevel::SSE2)
+        xxh3_expected = &xxh3_kernel_sse2;
+#endif
+
+#ifdef BPHASH_CRC32C_HAVE_SSE42_KERNEL
+    if(level >= ISALevel::SSE42)
+        crc_expected = &crc32c_kernel_sse42;
+#endif
+
+    check(&xxh3 == xxh3_expected, "Wrong default XXH3 kernel");
+    check(&crc == crc_expected, "Wrong default CRC32C kernel");
+
+    // Should give the same results as the portable kernels
+    std::vector<uint8_t> data(100003);
+    for(size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+
+    XXH3_64 xxh3_def, xxh3_ref(xxh3_kernel_scalar);
+    CRC32C crc_def, crc_ref(crc32c_kernel_table);
+
+    xxh3_def.update(data.data(), data.size());
+    xxh3_ref.update(data.data(), data.size());
+    crc_def.update(data.data(), data.size());
+    crc_ref.update(data.data(), data.size());
+
+    check(xxh3_def.finalize() == xxh3_ref.finalize(), "Default XXH3 kernel gives a different hash");
+    check(crc_def.finalize() == crc_ref.finalize(), "Default CRC32C kernel gives a different hash");
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::cout << "\n";
+    test_names();
+    test_level();
+    test_default_kernels();
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
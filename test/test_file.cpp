@@ -0,0 +1,301 @@
+/*! \file
+ * \brief Testing of hashing files
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests that hashing a file (by mapping or reading it)
+ * gives the same result as hashing its contents directly, and that
+ * hashing many files at once gives the same result as hashing each one */
+
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "bphash/HashFile.hpp"
+#include "bphash/HashFileBatch.hpp"
+#include "bphash/ThreadPool.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#define TEST_FIFO
+#endif
+
+using namespace bphash;
+
+
+static const char * test_path = "bphash_test_file.bin";
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+static void write_file(const char * path, const std::vector<uint8_t> & data)
+{
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    check(static_cast<bool>(f), "Cannot write test file");
+}
+
+
+static HashValue hash_direct(HashType type, const std::vector<uint8_t> & data,
+                             uint64_t offset, uint64_t nbytes)
+{
+    const size_t start = static_cast<size_t>(std::min<uint64_t>(offset, data.size()));
+    const size_t len = static_cast<size_t>(std::min<uint64_t>(nbytes, data.size() - start));
+
+    auto impl = detail::make_hash_impl(type);
+    impl->update(data.data() + start, len);
+    return impl->finalize();
+}
+
+
+static void test_size(size_t size, std::mt19937 & gen)
+{
+    std::cout << "Testing file of " << size << " bytes ... ";
+
+    std::vector<uint8_t> data(size);
+    for(auto & it : data)
+        it = static_cast<uint8_t>(gen());
+    write_file(test_path, data);
+
+    const HashType types[] = { HashType::Hash128, HashType::Hash64_xxh3,
+                               HashType::Hash128_tree, HashType::CRC32C };
+
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    const uint64_t offsets[] = { 0, 1, 4095, 4096, 100001, size - 1, size, size + 10 };
+    const uint64_t lengths[] = { 0, 1, 65537, 1024*1024 + 3, max };
+
+    for(HashType type : types)
+    {
+        check(hash_file(test_path, type) == hash_direct(type, data, 0, max), "Whole file");
+
+        for(uint64_t offset : offsets)
+        for(uint64_t len : lengths)
+        {
+            const HashValue ref = hash_direct(type, data, offset, len);
+
+            std::stringstream ss;
+            ss << "Mismatch for offset " << offset << " length " << len;
+
+            check(hash_file(test_path, type, offset, len) == ref, ss.str());
+
+            // Also try both methods, and small windows
+            auto impl = detail::make_hash_impl(type);
+            detail::hash_file_into(test_path, offset, len, *impl, detail::FileAccess::Map, 64*1024);
+            check(impl->finalize() == ref, ss.str() + " (mapped)");
+
+            impl->reset();
+            detail::hash_file_into(test_path, offset, len, *impl, detail::FileAccess::Read);
+            check(impl->finalize() == ref, ss.str() + " (read)");
+        }
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_batch(detail::FileBatchEngine engine, size_t nthreads, const char * desc,
+                       std::mt19937 & gen)
+{
+    std::cout << "Testing " << desc << " ... ";
+
+    // More files than are read at the same time, of sizes that need
+    // zero, one, and several reads
+    const size_t nfiles = 3*detail::file_batch_depth + 5;
+
+    std::vector<std::string> paths;
+    std::vector<std::vector<uint8_t>> contents;
+
+    for(size_t i = 0; i < nfiles; i++)
+    {
+        const size_t size = (i % 7 == 0) ? i : static_cast<size_t>(gen() % (3*detail::file_batch_buffer_size));
+
+        std::vector<uint8_t> data(size);
+        for(auto & it : data)
+            it = static_cast<uint8_t>(gen());
+
+        paths.push_back("bphash_test_batch_" + std::to_string(i) + ".bin");
+        write_file(paths.back().c_str(), data);
+        contents.push_back(std::move(data));
+    }
+
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    detail::ThreadPool pool(nthreads);
+
+    for(HashType type : { HashType::Hash64_xxh3, HashType::Hash128_tree })
+    {
+        const std::vector<HashValue> hashes = detail::hash_files(paths, type, engine, pool);
+        check(hashes.size() == nfiles, "Wrong number of hashes");
+
+        for(size_t i = 0; i < nfiles; i++)
+            check(hashes[i] == hash_direct(type, contents[i], 0, max), "Mismatch for " + paths[i]);
+
+        check(hash_files(paths, type) == hashes, "Mismatch for the default engine");
+    }
+
+    check(detail::hash_files({}, HashType::Hash128, engine, pool).empty(), "No files");
+
+    // The whole batch is processed, then the first error is thrown
+    std::vector<std::string> bad_paths(paths);
+    bad_paths[5] = "bphash_test_missing_1";
+    bad_paths[nfiles - 1] = "bphash_test_missing_2";
+
+    bool thrown = false;
+    try {
+        detail::hash_files(bad_paths, HashType::Hash128, engine, pool);
+    }
+    catch(const std::system_error & ex)
+    {
+        thrown = std::string(ex.what()).find("bphash_test_missing_1") != std::string::npos;
+    }
+    check(thrown, "Missing file did not throw the first error");
+
+    // From jobs on the same pool, with every worker busy
+    if(engine == detail::FileBatchEngine::Threads && nthreads > 0)
+    {
+        const std::vector<HashValue> ref = detail::hash_files(paths, HashType::Hash128, engine, pool);
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t npending = nthreads;
+        bool ok = true;
+
+        for(size_t j = 0; j < nthreads; j++)
+        {
+            pool.submit([&]
+            {
+                const bool same = detail::hash_files(paths, HashType::Hash128, engine, pool) == ref;
+
+                std::lock_guard<std::mutex> lock(mutex);
+                ok = ok && same;
+                npending--;
+                cv.notify_all();
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&npending] { return npending == 0; });
+        check(ok, "Mismatch from jobs on the pool");
+    }
+
+    for(const auto & p : paths)
+        std::remove(p.c_str());
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::mt19937 gen(12345);
+
+    std::cout << "\n";
+
+    test_size(0, gen);
+    test_size(1, gen);
+    test_size(4097, gen);
+    test_size(3*1024*1024 + 17, gen);
+
+
+    std::cout << "Testing against a known checksum ... ";
+    const std::string check_str = "123456789";
+    write_file(test_path, std::vector<uint8_t>(check_str.begin(), check_str.end()));
+    check(hash_to_string(hash_file(test_path, HashType::CRC32C)) == "e3069283", "Wrong CRC32C");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing missing file ... ";
+    std::remove(test_path);
+
+    bool thrown = false;
+    try {
+        hash_file(test_path, HashType::Hash128);
+    }
+    catch(const std::system_error &)
+    {
+        thrown = true;
+    }
+    check(thrown, "Missing file did not throw");
+    std::cout << "OK\n";
+
+
+    test_batch(detail::FileBatchEngine::Threads, 4, "batch of files with threads", gen);
+    test_batch(detail::FileBatchEngine::Threads, 0, "batch of files without threads", gen);
+    if(detail::file_batch_uring_available())
+        test_batch(detail::FileBatchEngine::IOUring, 0, "batch of files with io_uring", gen);
+    else
+        std::cout << "Skipping batch of files with io_uring (not available)\n";
+
+
+#ifdef TEST_FIFO
+    // Pipes can't be mapped or read with pread
+    std::cout << "Testing pipe ... ";
+
+    std::vector<uint8_t> data(2*1024*1024 + 5);
+    for(auto & it : data)
+        it = static_cast<uint8_t>(gen());
+
+    const char * fifo_path = "bphash_test_fifo";
+    std::remove(fifo_path);
+    check(mkfifo(fifo_path, 0600) == 0, "Cannot create FIFO");
+
+    std::thread writer([&data, fifo_path] { write_file(fifo_path, data); });
+    // Read all of it, so that the writer doesn't get SIGPIPE
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    HashValue hv = hash_file(fifo_path, HashType::Hash64_xxh3, 1000, max);
+    writer.join();
+    std::remove(fifo_path);
+
+    check(hv == hash_direct(HashType::Hash64_xxh3, data, 1000, max), "Mismatch for pipe");
+    std::cout << "OK\n";
+#endif
+
+#ifdef __linux__
+    // Files in procfs have a size of zero, but some contents
+    std::cout << "Testing file in /proc ... ";
+
+    const char * proc_path = "/proc/self/cmdline";
+    std::ifstream proc(proc_path, std::ios::binary);
+    const std::vector<uint8_t> proc_data((std::istreambuf_iterator<char>(proc)),
+                                         std::istreambuf_iterator<char>());
+    check(!proc_data.empty(), "Cannot read /proc/self/cmdline");
+
+    const HashValue proc_hv = hash_file(proc_path, HashType::CRC32C);
+    check(proc_hv == hash_direct(HashType::CRC32C, proc_data, 0, proc_data.size()), "Mismatch for /proc file");
+    check(proc_hv == hash_files({proc_path}, HashType::CRC32C)[0], "Mismatch with hash_files for /proc file");
+    std::cout << "OK\n";
+#endif
+
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,324 @@
+/*! \file
+ * \brief Testing of flat_map
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests flat_map against std::unordered_map, with random
+ * insertions and erasures, and tests its batched lookups */
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bphash/FlatMap.hpp"
+#include "bphash/types/string.hpp"
+#include "bphash/types/utility.hpp"
+
+using namespace bphash;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+// Hashes everything to the same 7-bit tag, to exercise probing
+struct BadHash
+{
+    size_t operator()(int i) const { return static_cast<size_t>(i % 4) << 7; }
+};
+
+
+template<typename Map, typename Ref>
+static void check_same(const Map & m, const Ref & ref)
+{
+    check(m.size() == ref.size(), "Wrong size");
+
+    size_t n = 0;
+    for(const auto & v : m)
+    {
+        auto it = ref.find(v.first);
+        check(it != ref.end() && it->second == v.second, "Wrong element");
+        n++;
+    }
+    check(n == ref.size(), "Wrong number of elements when iterating");
+
+    for(const auto & v : ref)
+    {
+        auto it = m.find(v.first);
+        check(it != m.end() && it->second == v.second, "Element not found");
+    }
+}
+
+
+template<typename Map, typename KeyFunc>
+static void test_random(const char * desc, KeyFunc make_key)
+{
+    std::cout << "Testing " << desc << " ... ";
+
+    typedef typename Map::key_type Key;
+    std::unordered_map<Key, int, StdHash<Key>> ref;
+    Map m;
+
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> keydist(0, 2000);
+    std::uniform_int_distribution<int> opdist(0, 9);
+
+    for(int i = 0; i < 20000; i++)
+    {
+        const Key key = make_key(keydist(gen));
+        const int op = opdist(gen);
+
+        if(op < 5)
+        {
+            auto r = m.insert({key, i});
+            auto rr = ref.insert({key, i});
+            check(r.second == rr.second, "Wrong result from insert");
+            check(r.first->second == rr.first->second, "Wrong value after insert");
+        }
+        else if(op < 8)
+        {
+            check(m.erase(key) == ref.erase(key), "Wrong result from erase");
+        }
+        else if(op < 9)
+        {
+            m[key] = i;
+            ref[key] = i;
+        }
+        else
+        {
+            check(m.count(key) == ref.count(key), "Wrong count");
+            check(m.contains(key) == (ref.count(key) == 1), "Wrong contains");
+        }
+
+        check(m.size() == ref.size(), "Wrong size");
+    }
+
+    check_same(m, ref);
+    check(m.load_factor() <= m.max_load_factor(), "Load factor is too high");
+
+    // Erase everything while iterating
+    for(auto it = m.begin(); it != m.end(); )
+    {
+        if(it->second % 2)
+        {
+            ref.erase(it->first);
+            it = m.erase(it);
+        }
+        else
+            ++it;
+    }
+    check_same(m, ref);
+
+    m.clear();
+    check(m.empty() && m.begin() == m.end(), "Not empty after clear");
+    check(m.find(make_key(1)) == m.end(), "Found an element after clear");
+
+    std::cout << "OK\n";
+}
+
+
+static void test_misc(void)
+{
+    std::cout << "Testing copying and moving ... ";
+
+    flat_map<std::string, std::unique_ptr<int>> m;
+    for(int i = 0; i < 100; i++)
+        m.try_emplace(std::to_string(i), new int(i));
+
+    flat_map<std::string, std::unique_ptr<int>> m2(std::move(m));
+    check(m.empty() && m2.size() == 100, "Move failed");
+    check(*m2.at("42") == 42, "Wrong value after move");
+
+    flat_map<std::string, int> a = {{"a", 1}, {"b", 2}};
+    flat_map<std::string, int> b(a);
+    b["c"] = 3;
+    a = b;
+    check(a.size() == 3 && a.at("c") == 3 && b.size() == 3, "Copy failed");
+
+    bool threw = false;
+    try {
+        a.at("d");
+    }
+    catch(const std::out_of_range &)
+    {
+        threw = true;
+    }
+    check(threw, "at() did not throw");
+
+    auto r = a.insert_or_assign(std::string("a"), 10);
+    check(!r.second && a.at("a") == 10, "insert_or_assign failed");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing reserve ... ";
+    flat_map<int, int> res;
+    res.reserve(1000);
+    const size_t cap = res.capacity();
+    for(int i = 0; i < 1000; i++)
+        res[i] = i;
+    check(res.capacity() == cap && cap >= 1000, "Map grew after reserve");
+
+    // Erasing and inserting should not grow the map without bound
+    for(int i = 1000; i < 100000; i++)
+    {
+        res.erase(i - 1000);
+        res[i] = i;
+    }
+    check(res.size() == 1000 && res.capacity() == cap, "Map grew with a constant size");
+    std::cout << "OK\n";
+}
+
+
+// Value that throws when constructed from a negative number,
+// and counts the objects alive
+struct Throwing
+{
+    static int nalive;
+    int v;
+
+    explicit Throwing(int i) : v(i)
+    {
+        if(i < 0)
+            throw std::invalid_argument("Negative value");
+        nalive++;
+    }
+
+    Throwing(const Throwing & rhs) : v(rhs.v) { nalive++; }
+    ~Throwing() { nalive--; }
+};
+
+int Throwing::nalive = 0;
+
+
+static void test_throwing(void)
+{
+    std::cout << "Testing a throwing constructor ... ";
+
+    {
+        flat_map<int, Throwing> m;
+        size_t nthrown = 0;
+
+        // Including throws that happen just after the map grows
+        for(int i = 0; i < 1000; i++)
+        {
+            try {
+                m.try_emplace(i, (i % 3 == 0) ? -1 : i);
+            }
+            catch(const std::invalid_argument &)
+            {
+                nthrown++;
+            }
+        }
+
+        check(nthrown == 334 && m.size() == 666, "Wrong size after throwing");
+        check(Throwing::nalive == 666, "Wrong number of values");
+
+        size_t n = 0;
+        for(const auto & v : m)
+        {
+            check(v.first % 3 != 0 && v.second.v == v.first, "Wrong element");
+            n++;
+        }
+        check(n == 666, "Wrong number of elements when iterating");
+        check(m.find(3) == m.end() && m.find(4) != m.end(), "Wrong result of find");
+
+        // The key can still be inserted
+        check(m.try_emplace(3, 3).second && m.size() == 667, "Insertion after throwing failed");
+    }
+
+    check(Throwing::nalive == 0, "Values were destroyed the wrong number of times");
+    std::cout << "OK\n";
+}
+
+
+template<typename Map>
+static void test_batch(const char * desc)
+{
+    std::cout << "Testing batched lookups " << desc << " ... ";
+
+    Map m;
+    std::vector<typename Map::key_type> keys;
+
+    const typename Map::iterator end = m.end();
+    typename Map::iterator empty_result;
+    m.find_batch(nullptr, 0, &empty_result);
+
+    std::vector<typename Map::iterator> results(1);
+    typename Map::key_type k{};
+    m.find_batch(&k, 1, results.data());
+    check(results[0] == end, "Found an element in an empty map");
+
+    for(int i = 0; i < 5000; i++)
+        m[std::to_string(i)] = i;
+
+    // Half of the keys are present
+    for(int i = 0; i < 10000; i += 2)
+        keys.push_back(std::to_string(i));
+
+    results.resize(keys.size());
+    m.find_batch(keys.data(), keys.size(), results.data());
+
+    const Map & cm = m;
+    std::vector<typename Map::const_iterator> cresults(keys.size());
+    cm.find_batch(keys.data(), keys.size(), cresults.data());
+
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        check(results[i] == m.find(keys[i]), "Wrong result from find_batch");
+        check(cresults[i] == cm.find(keys[i]), "Wrong result from const find_batch");
+        if(i < 2500)
+            check(results[i]->second == static_cast<int>(2*i), "Wrong value");
+    }
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::cout << "\n";
+
+    auto int_key = [](int i) { return i; };
+    auto string_key = [](int i) { return "key number " + std::to_string(i); };
+    auto pair_key = [](int i) { return std::make_pair(i % 7, std::to_string(i)); };
+
+    test_random<flat_map<int, int>>("integer keys", int_key);
+    test_random<flat_map<int, int, BadHash>>("colliding hashes", int_key);
+    test_random<flat_map<std::string, int>>("string keys", string_key);
+    test_random<flat_map<std::string, int, StdHash<std::string>,
+                         std::equal_to<std::string>, true>>("stored digests", string_key);
+    test_random<flat_map<std::pair<int, std::string>, int>>("pair keys", pair_key);
+    test_misc();
+    test_throwing();
+    test_batch<flat_map<std::string, int>>("");
+    test_batch<flat_map<std::string, int, StdHash<std::string>,
+                        std::equal_to<std::string>, true>>("with stored digests");
+
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,382 @@
+/*! \file
+ * \brief Testing of the different hasher classes
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests that the compile-time hasher (BasicHasher)
+ * gives the same results as the runtime hasher (Hasher), and
+ * that the fixed-size digests match the equivalent HashValue */
+
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+
+#include "bphash/Hasher.hpp"
+#include "bphash/BasicHasher.hpp"
+#include "bphash/types/All.hpp"
+
+#include "bphash/MurmurHash3_32_x32.hpp"
+#include "bphash/MurmurHash3_32_x64.hpp"
+#include "bphash/MurmurHash3_64_x64.hpp"
+#include "bphash/MurmurHash3_128_x64.hpp"
+#include "bphash/XXH3_128.hpp"
+
+using namespace bphash;
+
+
+enum class TestEnum
+{
+    Value1,
+    Value2
+};
+
+
+// Only accepts a plain Hasher
+class HashMember
+{
+    public:
+        int i;
+        std::string s;
+
+        void hash(Hasher & h) const { h(i, s); }
+};
+
+
+// Accepts any kind of hasher
+class HashMemberTemplate
+{
+    public:
+        int i;
+        std::vector<double> v;
+
+        template<typename HasherT>
+        void hash(HasherT & h) const { h(i, v); }
+};
+
+
+// Only accepts a plain Hasher
+class HashFree
+{
+    public:
+        long l;
+        HashMember hm;
+};
+
+static void hash_object(const HashFree & hf, Hasher & h)
+{
+    h(hf.l, hf.hm);
+}
+
+
+// Private member function, with friends declared
+class HashPrivate
+{
+    public:
+        HashPrivate(double d) : d_(d) { }
+
+    private:
+        BPHASH_DECLARE_HASHING_FRIENDS
+
+        double d_;
+
+        template<typename HasherT>
+        void hash(HasherT & h) const { h(d_); }
+};
+
+
+// Declared to be hashable via its raw bytes
+struct Contiguous
+{
+    int i;
+    float f;
+};
+
+namespace bphash {
+template<> struct is_contiguously_hashable<Contiguous> : public std::true_type { };
+}
+
+
+template<typename HasherT>
+static void hash_test_data(HasherT & h)
+{
+    int i = 42;
+    double d = 1.12e12;
+    const char * cstr = "This is a test string";
+    std::string str("This is another test string");
+    std::vector<double> dvec{1.0, 2.0, 3.0, 4.0, 5.0};
+    std::vector<std::pair<int, std::string>> pvec{{1, "one"}, {2, "two"}};
+    std::map<std::string, std::vector<int>> m{{"a", {1, 2}}, {"b", {3, 4, 5}}};
+    std::array<short, 3> arr{{7, 8, 9}};
+    std::list<float> lst{1.5f, 2.5f};
+    std::tuple<int, std::string, double> tup{3, "three", 3.0};
+    std::unique_ptr<long> uptr(new long(123456789));
+    std::complex<double> cmplx(1.0, -1.0);
+    std::vector<double> big_dvec(1000, 1.234);
+    std::string big_str(300, 'x');
+
+    // contiguously hashable
+    std::vector<std::pair<int, int>> cont_pvec{{1, 2}, {3, 4}, {5, 6}};
+    std::array<std::complex<double>, 3> cont_carr{{{1.0, 2.0}, {3.0, 4.0}, {5.0, 6.0}}};
+    std::vector<TestEnum> cont_evec{TestEnum::Value1, TestEnum::Value2};
+    std::vector<Contiguous> cont_svec{{1, 1.0f}, {2, 2.0f}};
+    Contiguous cont_s{3, 3.0f};
+
+    HashMember hm{123, "Member"};
+    HashMemberTemplate hmt{456, {1.1, 2.2}};
+    HashFree hf{789, {321, "Free"}};
+    HashPrivate hp(9.87);
+
+    h(i, d, TestEnum::Value2, cstr, str);
+    h(dvec, pvec, m, arr, lst, tup, uptr, cmplx);
+    h(hm, hmt, hf, hp);
+    h(cont_pvec, cont_carr, cont_evec, cont_svec, cont_s);
+    h(hash_pointer(dvec.data(), dvec.size()));
+
+    // large enough to skip any buffering
+    h(big_dvec, i, big_str, d, big_str);
+}
+
+
+template<typename Algorithm>
+static void test_hasher(HashType type, const char * desc)
+{
+    std::cout << "Testing " << desc << " ... ";
+
+    Hasher h(type);
+    hash_test_data(h);
+    HashValue ref = h.finalize();
+
+    BasicHasher<Algorithm> bh;
+    hash_test_data(bh);
+    HashValue calc = bh.finalize();
+
+    if(calc != ref)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Mismatch for ") + desc);
+    }
+    else
+        std::cout << "OK\n";
+}
+
+
+template<typename Algorithm>
+static void test_digest(HashType type, const char * desc)
+{
+    typedef typename Algorithm::digest_type digest_type;
+    const size_t N = digest_type::size();
+
+    static_assert(std::is_trivially_copyable<digest_type>::value,
+                  "Digest is not trivially copyable");
+    static_assert(sizeof(digest_type) == N, "Digest has extra storage");
+
+    std::cout << "Testing " << desc << " ... ";
+
+    Hasher h(type);
+    hash_test_data(h);
+    HashValue ref = h.finalize();
+
+    Hasher h2(type);
+    hash_test_data(h2);
+    digest_type hd = h2.finalize_digest<N>();
+
+    BasicHasher<Algorithm> bh;
+    hash_test_data(bh);
+    digest_type bhd = bh.finalize_digest();
+
+    Hasher h3(type);
+    hash_test_data(h3);
+    Digest<N+4> hd_padded = h3.finalize_digest<N+4>();
+
+    if(to_hash_value(hd) != ref || hd != bhd ||
+       to_digest<N>(ref) != hd || hash_to_string(hd) != hash_to_string(ref) ||
+       convert_hash<size_t>(hd) != convert_hash<size_t>(ref) ||
+       convert_hash<uint16_t>(hd) != convert_hash<uint16_t>(ref) ||
+       to_hash_value(hd_padded) != truncate_hash(ref, N+4) ||
+       truncate_hash<N>(hd_padded) != hd)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Mismatch for ") + desc);
+    }
+
+    // Ordering should be the same as for HashValue
+    digest_type hd_other = to_digest<N>(make_hash(type, 1234));
+    HashValue ref_other = make_hash(type, 1234);
+    if((hd < hd_other) != (ref < ref_other) ||
+       (hd_other < hd) != (ref_other < ref) ||
+       !(hd <= hd) || !(hd >= hd) || hd == hd_other)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Bad ordering for ") + desc);
+    }
+
+    std::unordered_set<digest_type> digest_set{hd, bhd, hd_other};
+    if(digest_set.size() != 2)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Bad std::hash for ") + desc);
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_clone(HashType type, const char * desc)
+{
+    std::cout << "Testing " << desc << " ... ";
+
+    // Large enough for several chunks of the tree hash
+    std::vector<uint8_t> prefix(2500000);
+    for(size_t i = 0; i < prefix.size(); i++)
+        prefix[i] = static_cast<uint8_t>(i * 31 + (i >> 12));
+
+    const std::vector<std::string> suffixes{"", "a", "suffix", std::string(1000, 'z')};
+
+    Hasher common(type);
+    common(prefix, 42);
+
+    for(const auto & s : suffixes)
+    {
+        Hasher fresh(type);
+        fresh(prefix, 42, s);
+        HashValue ref = fresh.finalize();
+
+        Hasher cloned = common.clone();
+        cloned(s);
+
+        Hasher copied(type);
+        copied(1.0);
+        copied = common;
+        copied(s);
+
+        if(cloned.finalize() != ref || copied.finalize() != ref)
+        {
+            std::cout << "FAILED\n";
+            throw std::runtime_error(std::string("Mismatch for ") + desc);
+        }
+    }
+
+    // The clones must not have changed the original
+    Hasher fresh(type);
+    fresh(prefix, 42);
+    if(common.peek() != fresh.finalize())
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Clone changed the original for ") + desc);
+    }
+
+    // Peeking must not change the state
+    Hasher peeked(type);
+    peeked(prefix);
+    HashValue mid = peeked.peek();
+    Digest<8> mid_digest = peeked.peek_digest<8>();
+    peeked(suffixes.back());
+
+    Hasher prefix_only(type);
+    prefix_only(prefix);
+    Hasher full(type);
+    full(prefix, suffixes.back());
+
+    if(mid != prefix_only.finalize() || mid_digest != to_digest<8>(mid) ||
+       peeked.finalize() != full.finalize())
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Peek changed the state for ") + desc);
+    }
+
+    std::cout << "OK\n";
+}
+
+
+template<typename Algorithm>
+static void test_basic_clone(HashType type, const char * desc)
+{
+    std::cout << "Testing " << desc << " ... ";
+
+    BasicHasher<Algorithm> common;
+    common(std::string("common header"), 1234);
+
+    BasicHasher<Algorithm> cloned = common.clone();
+    HashValue mid = cloned.peek();
+    cloned(5.0);
+
+    if(mid != common.peek() || cloned.peek_digest() == common.peek_digest() ||
+       cloned.finalize() != make_hash(type, std::string("common header"), 1234, 5.0))
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(std::string("Mismatch for ") + desc);
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_type_tags(void)
+{
+    std::cout << "Testing type tags ... ";
+
+    const bool same = make_hash(HashType::Hash128, 1) == make_hash(HashType::Hash128, 1u);
+
+    #ifdef BPHASH_USE_TYPEID
+    const bool ok = !same && detail::type_tag<int>() != detail::type_tag<unsigned int>() &&
+                    detail::type_tag<int>() == detail::fnv1a_64(typeid(int).name());
+    #else
+    const bool ok = same;
+    #endif
+
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error("Wrong hashing of types");
+    }
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::cout << "\n";
+    test_hasher<detail::MurmurHash3_32_x32>(HashType::Hash32_x32, "32-bit x32 BasicHasher");
+    test_hasher<detail::MurmurHash3_32_x64>(HashType::Hash32_x64, "32-bit x64 BasicHasher");
+    test_hasher<detail::MurmurHash3_64_x64>(HashType::Hash64_x64, "64-bit x64 BasicHasher");
+    test_hasher<detail::MurmurHash3_128_x64>(HashType::Hash128_x64, "128-bit x64 BasicHasher");
+    std::cout << "\n";
+
+    test_digest<detail::MurmurHash3_32_x32>(HashType::Hash32_x32, "32-bit x32 digest");
+    test_digest<detail::MurmurHash3_32_x64>(HashType::Hash32_x64, "32-bit x64 digest");
+    test_digest<detail::MurmurHash3_64_x64>(HashType::Hash64_x64, "64-bit x64 digest");
+    test_digest<detail::MurmurHash3_128_x64>(HashType::Hash128_x64, "128-bit x64 digest");
+    std::cout << "\n";
+
+    test_clone(HashType::Hash32_x32, "32-bit x32 clone");
+    test_clone(HashType::Hash32_x64, "32-bit x64 clone");
+    test_clone(HashType::Hash64_x64, "64-bit x64 clone");
+    test_clone(HashType::Hash128_x64, "128-bit x64 clone");
+    test_clone(HashType::Hash128_tree, "128-bit tree clone");
+    test_clone(HashType::Hash64_xxh3, "64-bit XXH3 clone");
+    test_clone(HashType::Hash128_xxh3, "128-bit XXH3 clone");
+    test_clone(HashType::CRC32C, "CRC32C clone");
+    test_basic_clone<detail::MurmurHash3_128_x64>(HashType::Hash128_x64, "128-bit x64 BasicHasher clone");
+    test_basic_clone<detail::XXH3_128>(HashType::Hash128_xxh3, "128-bit XXH3 BasicHasher clone");
+    std::cout << "\n";
+
+    test_type_tags();
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
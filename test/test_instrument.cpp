@@ -0,0 +1,177 @@
+/*! \file
+ * \brief Testing of the instrumentation counters
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests the counts collected when the library is
+ * built with BPHASH_INSTRUMENT, and that nothing is collected
+ * (but hashing still works) when it is not */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "bphash/Hasher.hpp"
+#include "bphash/BasicHasher.hpp"
+#include "bphash/Instrumentation.hpp"
+#include "bphash/MurmurHash3_128_x64.hpp"
+#include "bphash/types/string.hpp"
+
+using namespace bphash;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+#ifdef BPHASH_INSTRUMENT
+
+// With BPHASH_USE_TYPEID, each object is preceded by an 8-byte type tag
+#ifdef BPHASH_USE_TYPEID
+static const size_t ntags = 1;
+#else
+static const size_t ntags = 0;
+#endif
+
+
+static void test_counts(void)
+{
+    std::cout << "Testing counts of a Hasher ... ";
+
+    reset_instrumentation();
+
+    Hasher h(HashType::Hash128);
+    h(42);                          // 8-byte size, then 4 bytes of data
+    h.finalize();                   // one update of the buffered bytes
+
+    InstrumentationSnapshot s = instrumentation_snapshot();
+    check(s.enabled, "Not enabled");
+    check(s.update_calls == 2 + ntags && s.update_bytes == 12 + 8*ntags, "Wrong update counts");
+    check(s.update_sizes[detail::instrument_bucket(4)] == 1 &&
+          s.update_sizes[detail::instrument_bucket(8)] == 1 + ntags, "Wrong update histogram");
+    check(s.impl_update_calls == 1, "Wrong impl update count");
+    check(s.finalize_calls == 1, "Wrong finalize count");
+    check(s.carry_events == 0, "Wrong carry count");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing counts of a BasicHasher ... ";
+    reset_instrumentation();
+
+    // Updates of 8, 4, 8, 4 bytes. All but the first start with
+    // a partial 16-byte block in the buffer. With type tags, the
+    // updates are 8, 8, 4, 8, 8, 4 bytes, and four start with a partial block.
+    BasicHasher<detail::MurmurHash3_128_x64> bh;
+    bh(1, 2);
+    bh.finalize_digest();
+
+    s = instrumentation_snapshot();
+    check(s.update_calls == 4 + 2*ntags && s.impl_update_calls == 4 + 2*ntags, "Wrong update counts");
+    check(s.carry_events == 3 + ntags, "Wrong carry count");
+    check(s.finalize_calls == 1, "Wrong finalize count");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing counts of make_hash ... ";
+    reset_instrumentation();
+
+    const size_t ncalls = 3 * BPHASH_INSTRUMENT_SAMPLE_RATE;
+    for(size_t i = 0; i < ncalls; i++)
+        make_hash(HashType::Hash64, std::string("abc"), i);
+
+    s = instrumentation_snapshot();
+    size_t nhist = 0;
+    for(auto n : s.make_hash_times)
+        nhist += n;
+
+    check(s.make_hash_calls == ncalls, "Wrong number of calls");
+    check(s.make_hash_sampled == 3 && nhist == 3, "Wrong number of timed calls");
+    check(s.make_hash_max_ns <= s.make_hash_total_ns, "Wrong times");
+    check(s.finalize_calls == ncalls, "Wrong finalize count");
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing counts from other threads ... ";
+    reset_instrumentation();
+
+    std::thread t([] { make_hash(HashType::Hash32, 1.0); });
+    t.join();
+    make_hash(HashType::Hash32, 1.0);
+
+    s = instrumentation_snapshot();
+    check(s.make_hash_calls == 2 && s.update_calls == 4 + 2*ntags, "Counts from the exited thread are missing");
+    std::cout << "OK\n";
+}
+
+#else
+
+static void test_counts(void)
+{
+    std::cout << "Testing that nothing is counted ... ";
+
+    HashValue hv = make_hash(HashType::Hash128, 42);
+    check(hv.size() == 16, "Hashing failed");
+
+    InstrumentationSnapshot s = instrumentation_snapshot();
+    check(!s.enabled, "Enabled");
+    check(s.update_calls == 0 && s.finalize_calls == 0 && s.make_hash_calls == 0, "Something was counted");
+    std::cout << "OK\n";
+}
+
+#endif
+
+
+static void test_write(void)
+{
+    std::cout << "Testing writing of the counters ... ";
+
+    const char * path = "bphash_test_instrument.json";
+    write_instrumentation(path);
+
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    f.close();
+    std::remove(path);
+
+    const std::string text = ss.str();
+    check(text.find("\"update_calls\":") != std::string::npos &&
+          text.find("\"make_hash_times\": [") != std::string::npos &&
+          text.back() == '\n', "Bad output");
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::cout << "\n";
+    test_counts();
+    test_write();
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,249 @@
+/*! \file
+ * \brief Testing of incremental hashing with MerkleTree
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests that a MerkleTree that is updated after changes gives
+ * the same result as hashing the changed buffer from scratch, and that
+ * it matches the tree hash */
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "bphash/MerkleTree.hpp"
+#include "bphash/TreeHash.hpp"
+#include "bphash/types/vector.hpp"
+
+using namespace bphash;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+static Digest128 tree_hash(const std::vector<uint8_t> & data)
+{
+    detail::ThreadPool serial(0);
+    detail::TreeHash th(serial);
+    th.update(data.data(), data.size());
+
+    Digest128 ret;
+    th.finalize_into(ret.data());
+    return ret;
+}
+
+
+static void test_tree_hash(size_t nbytes, std::mt19937 & gen)
+{
+    std::cout << "Testing against the tree hash, " << nbytes << " bytes ... ";
+
+    std::vector<uint8_t> data(nbytes);
+    for(auto & it : data)
+        it = static_cast<uint8_t>(gen());
+
+    MerkleTree mt(data.data(), data.size());
+    check(mt.digest() == tree_hash(data), "Mismatch with the tree hash");
+    check(mt.hash_value() == to_hash_value(mt.digest()), "Mismatch with the hash value");
+    check(mt.ndirty() == 0, "Chunks still dirty after construction");
+
+    std::cout << "OK\n";
+}
+
+
+static void test_incremental(size_t chunk_size, size_t nthreads, std::mt19937 & gen)
+{
+    std::cout << "Testing incremental updates, chunk size " << chunk_size
+              << ", " << nthreads << " threads ... ";
+
+    detail::ThreadPool pool(nthreads);
+
+    std::vector<uint8_t> data(100003);
+    for(auto & it : data)
+        it = static_cast<uint8_t>(gen());
+
+    MerkleTree mt(data.data(), data.size(), chunk_size, pool);
+
+    for(int round = 0; round < 50; round++)
+    {
+        // Change a few random ranges, some of which
+        // cross chunk boundaries or the end of the buffer
+        const int nranges = 1 + round % 4;
+        for(int r = 0; r < nranges; r++)
+        {
+            const size_t offset = gen() % data.size();
+            const size_t len = 1 + gen() % (2*chunk_size);
+
+            for(size_t i = offset; i < std::min(offset + len, data.size()); i++)
+                data[i] = static_cast<uint8_t>(gen());
+
+            mt.mark_dirty(offset, len);
+        }
+
+        check(mt.ndirty() <= mt.nchunks(), "Too many dirty chunks");
+        mt.update();
+
+        MerkleTree ref(data.data(), data.size(), chunk_size, pool);
+        if(mt.digest() != ref.digest())
+        {
+            std::stringstream ss;
+            ss << "Mismatch after update, round " << round;
+            check(false, ss.str());
+        }
+    }
+
+    // Changing the size of the buffer
+    const size_t sizes[] = { 100003, 100003 + chunk_size, 5*chunk_size + 1, chunk_size,
+                             1, 0, 3*chunk_size, 200000 };
+
+    for(size_t s : sizes)
+    {
+        const size_t old_size = data.size();
+        data.resize(s);
+        for(size_t i = old_size; i < s; i++)
+            data[i] = static_cast<uint8_t>(gen());
+
+        mt.set_data(data.data(), data.size());
+        mt.update();
+
+        MerkleTree ref(data.data(), data.size(), chunk_size, pool);
+        if(mt.digest() != ref.digest() || mt.nchunks() != ref.nchunks())
+        {
+            std::stringstream ss;
+            ss << "Mismatch after resizing to " << s;
+            check(false, ss.str());
+        }
+    }
+
+    std::cout << "OK\n";
+}
+
+
+static void test_dirty_tracking(void)
+{
+    std::cout << "Testing dirty tracking ... ";
+
+    std::vector<uint8_t> data(10000, 1);
+    MerkleTree mt(data.data(), data.size(), 1000);
+
+    check(mt.nchunks() == 10, "Wrong number of chunks");
+
+    mt.mark_dirty(999, 2);       // crosses a boundary
+    check(mt.ndirty() == 2, "Range crossing a boundary");
+
+    mt.mark_dirty(999, 1);       // already dirty
+    mt.mark_dirty(5000, 0);      // empty
+    mt.mark_dirty(10000, 50);    // beyond the end
+    check(mt.ndirty() == 2, "Redundant ranges");
+
+    mt.mark_dirty(9999, 1000);   // past the end
+    check(mt.ndirty() == 3, "Range past the end");
+
+    // Changing without marking gives the old hash
+    const Digest128 old_digest = mt.digest();
+    data[5500] = 2;
+    mt.update();
+    check(mt.ndirty() == 0 && mt.digest() == old_digest, "Unmarked change");
+
+    mt.mark_dirty(5500, 1);
+    mt.update();
+    check(mt.digest() != old_digest, "Marked change");
+
+    // Hashing as part of something else uses the digest
+    // (the type tags differ with BPHASH_USE_TYPEID)
+    #ifndef BPHASH_USE_TYPEID
+    check(make_hash(HashType::Hash128, mt) == make_hash(HashType::Hash128, hash_pointer(mt.digest().data(), 16)),
+          "Hashing a MerkleTree");
+    #endif
+
+    std::cout << "OK\n";
+}
+
+
+static void test_in_pool(std::mt19937 & gen)
+{
+    std::cout << "Testing updates from jobs on the same pool ... ";
+
+    std::vector<uint8_t> data(1000000);
+    for(auto & it : data)
+        it = static_cast<uint8_t>(gen());
+
+    const size_t chunk_size = 4096;
+    detail::ThreadPool serial(0);
+    const Digest128 ref = MerkleTree(data.data(), data.size(), chunk_size, serial).digest();
+
+    // Every worker is busy with a job that updates its own tree
+    detail::ThreadPool pool(2);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t npending = 2;
+    bool ok = true;
+
+    for(size_t j = 0; j < 2; j++)
+    {
+        pool.submit([&]
+        {
+            MerkleTree mt(data.data(), data.size(), chunk_size, pool);
+            mt.mark_all_dirty();
+            mt.update();
+            const bool same = mt.digest() == ref;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ok = ok && same;
+            npending--;
+            cv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&npending] { return npending == 0; });
+    check(ok, "Wrong digest from a job on the pool");
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::mt19937 gen(42);
+
+    std::cout << "\n";
+
+    test_tree_hash(0, gen);
+    test_tree_hash(1, gen);
+    test_tree_hash(detail::TreeHash::chunk_size, gen);
+    test_tree_hash(5*detail::TreeHash::chunk_size + 12345, gen);
+    std::cout << "\n";
+
+    test_incremental(1000, 0, gen);
+    test_incremental(1024, 3, gen);
+    test_incremental(4096, 8, gen);
+    test_dirty_tracking();
+    test_in_pool(gen);
+    std::cout << "\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -16,6 +16,7 @@
 #include <sstream>
 
 #include "bphash/Hasher.hpp"
+#include "bphash/HashBatch.hpp"
 #include "bphash/MurmurHash3_32_x32.hpp"
 #include "bphash/MurmurHash3_32_x64.hpp"
 #include "bphash/MurmurHash3_64_x64.hpp"
@@ -90,6 +91,62 @@ static void test_offset(detail::HashImpl & hasher,
 }
 
 
+template<size_t N>
+static void test_batch(HashType type, const std::vector<uint8_t> & testdata,
+                       size_t nkeys, size_t maxlen,
+                       int hashsize, int bitness)
+{
+    std::cout << "Testing " << hashsize << "-bit x" << bitness << " batch hash,"
+              << " " << nkeys << " keys"
+              << " maxlen " << maxlen
+              << " digest size " << N << " ... ";
+
+    // Keys of random length, starting at random (often misaligned)
+    // places in the test data
+    std::default_random_engine generator(static_cast<unsigned>(nkeys * maxlen));
+    std::uniform_int_distribution<size_t> lendist(0, maxlen);
+    std::uniform_int_distribution<size_t> offsetdist(0, testdata.size() - maxlen);
+
+    std::vector<const void *> ptrs(nkeys);
+    std::vector<size_t> lens(nkeys);
+
+    for(size_t i = 0; i < nkeys; i++)
+    {
+        ptrs[i] = testdata.data() + offsetdist(generator);
+        lens[i] = lendist(generator);
+    }
+
+    std::vector<Digest<N>> calc(nkeys);
+    hash_batch(type, ptrs.data(), lens.data(), nkeys, calc.data());
+
+    for(size_t i = 0; i < nkeys; i++)
+    {
+        HashValue ref(16);
+        const int len = static_cast<int>(lens[i]);
+
+        if(bitness == 32)
+            MurmurHash3_x86_32(ptrs[i], len, 0, ref.data());
+        else
+            MurmurHash3_x64_128(ptrs[i], len, 0, ref.data());
+
+        ref = truncate_hash(ref, static_cast<size_t>(hashsize/8));
+
+        if(calc[i] != to_digest<N>(ref))
+        {
+            std::cout << "FAILED\n";
+
+            std::stringstream ss;
+            ss << "Mismatch: " << hashsize << "-bit batch hash,"
+                               << " key " << i
+                               << " length " << lens[i];
+
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    std::cout << "OK\n";
+}
+
 
 int main(void)
 {
@@ -181,6 +238,23 @@ int main(void)
 
     std::cout << "\n";
 
+
+    // hash many independent keys at once
+    for(size_t nkeys : {1, 7, 8, 9, 103})
+    for(size_t maxlen : {0, 3, 16, 100, 5000})
+    {
+        test_batch<4>(HashType::Hash32_x32, testdata, nkeys, maxlen, 32, 32);
+        test_batch<4>(HashType::Hash32_x64, testdata, nkeys, maxlen, 32, 64);
+        test_batch<8>(HashType::Hash64_x64, testdata, nkeys, maxlen, 64, 64);
+        test_batch<16>(HashType::Hash128_x64, testdata, nkeys, maxlen, 128, 64);
+    }
+
+    // Truncated and padded digests
+    test_batch<8>(HashType::Hash32_x32, testdata, 103, 100, 32, 32);
+    test_batch<4>(HashType::Hash128_x64, testdata, 103, 100, 128, 64);
+
+    std::cout << "\n";
+
     }
     catch(const std::exception & ex)
     {
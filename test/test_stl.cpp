@@ -16,6 +16,13 @@
 
 using namespace bphash;
 
+enum class TestEnum
+{
+    Value1,
+    Value2,
+    Value3
+};
+
 int main(void)
 {
     typedef std::pair<int, double> key_type;
@@ -29,6 +36,27 @@ int main(void)
     us.emplace(key_type{5, 10.5});
     us.emplace(key_type{5, 10.5});
 
+    // These use the integer mixing function
+    std::unordered_set<long, bphash::StdHash<long>> us_long{1, 2, 3, 3, -1, -1};
+    std::unordered_set<double, bphash::StdHash<double>> us_dbl{1.0, 2.0, 2.0, 1.0e-12};
+    std::unordered_map<TestEnum, int, bphash::StdHash<TestEnum>> um_enum;
+    um_enum[TestEnum::Value1] = 1;
+    um_enum[TestEnum::Value3] = 3;
+    um_enum[TestEnum::Value3] = 4;
+
+    // While these go through the hasher
+    std::unordered_map<std::string, int, bphash::StdHash<std::string>> um_str;
+    um_str["String1"] = 1;
+    um_str["String2"] = 2;
+    um_str["String1"] = 3;
+
+    if(us.size() != 6 || us_long.size() != 4 || us_dbl.size() != 3 ||
+       um_enum.size() != 2 || um_str.size() != 2)
+    {
+        std::cout << "!!! Failed test: wrong number of elements in a container\n";
+        return 1;
+    }
+
     //! \todo Don't forget to test vector<bool>
 
     std::cout << "\n";
@@ -0,0 +1,244 @@
+/*! \file
+ * \brief Testing of the parallel tree hash
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests the tree hash against a serial implementation of
+ * its documented definition (using the smhasher reference code), with
+ * different numbers of threads and ways of splitting the input */
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+
+#include "bphash/Hasher.hpp"
+#include "bphash/HashBatch.hpp"
+#include "bphash/TreeHash.hpp"
+#include "bphash/types/vector.hpp"
+
+#include "MurmurHash3_reference.h" // in this directory
+
+using namespace bphash;
+
+static const size_t chunk_size = detail::TreeHash::chunk_size;
+
+
+static void random_fill(std::vector<uint8_t> & buffer)
+{
+    std::default_random_engine generator(12345);
+    std::uniform_int_distribution<int> dist(0, 255);
+
+    for(auto & it : buffer)
+        it = static_cast<uint8_t>(dist(generator));
+}
+
+
+// Reference 128-bit hash of data, followed by a tag byte
+static HashValue ref_hash(const uint8_t * data, size_t len, uint8_t tag)
+{
+    std::vector<uint8_t> buf(data, data + len);
+    buf.push_back(tag);
+
+    HashValue ret(16);
+    MurmurHash3_x64_128(buf.data(), static_cast<int>(buf.size()), 0, ret.data());
+    return ret;
+}
+
+
+// Serial implementation of the tree hash, as documented
+static HashValue ref_tree_hash(const uint8_t * data, size_t len)
+{
+    std::vector<HashValue> level;
+
+    for(size_t i = 0; i < len; i += chunk_size)
+        level.push_back(ref_hash(data + i, std::min(chunk_size, len - i), 0x00));
+
+    if(level.empty())
+        level.push_back(ref_hash(data, 0, 0x00));
+
+    while(level.size() > 1)
+    {
+        std::vector<HashValue> next;
+
+        for(size_t i = 0; i + 1 < level.size(); i += 2)
+        {
+            HashValue pair(level[i]);
+            pair.insert(pair.end(), level[i+1].begin(), level[i+1].end());
+            next.push_back(ref_hash(pair.data(), pair.size(), 0x01));
+        }
+
+        if(level.size() % 2 != 0)
+            next.push_back(level.back());
+
+        level = next;
+    }
+
+    HashValue root(level[0]);
+    for(size_t i = 0; i < 8; i++)
+        root.push_back(static_cast<uint8_t>(static_cast<uint64_t>(len) >> (i*8)));
+
+    return ref_hash(root.data(), root.size(), 0x02);
+}
+
+
+static void test_tree(const std::vector<uint8_t> & testdata, size_t len,
+                      size_t nthreads, size_t blocksize)
+{
+    std::cout << "Testing tree hash, " << len << " bytes, "
+              << nthreads << " threads, blocksize " << blocksize << " ... ";
+
+    const HashValue ref = ref_tree_hash(testdata.data(), len);
+
+    detail::ThreadPool pool(nthreads);
+    detail::TreeHash th(pool);
+
+    // Hash twice to make sure reset works
+    for(int i = 0; i < 2; i++)
+    {
+        th.reset();
+
+        for(size_t done = 0; done < len; done += blocksize)
+            th.update(testdata.data() + done, std::min(blocksize, len - done));
+
+        if(th.finalize() != ref)
+        {
+            std::cout << "FAILED\n";
+
+            std::stringstream ss;
+            ss << "Mismatch: tree hash, " << len << " bytes, "
+               << nthreads << " threads, blocksize " << blocksize;
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    std::cout << "OK\n";
+}
+
+
+// Hash from jobs running on the same pool, with every worker busy
+static void test_in_pool(const std::vector<uint8_t> & testdata)
+{
+    std::cout << "Testing tree hash from jobs on its pool ... ";
+
+    const HashValue ref = ref_tree_hash(testdata.data(), testdata.size());
+
+    detail::ThreadPool pool(2);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t npending = 2;
+    bool ok = true;
+
+    for(size_t j = 0; j < 2; j++)
+    {
+        pool.submit([&, j]
+        {
+            // Both full chunks from the caller's data and copied chunks
+            detail::TreeHash th(pool);
+            const size_t blocksize = j ? testdata.size() : 100003;
+            for(size_t done = 0; done < testdata.size(); done += blocksize)
+                th.update(testdata.data() + done, std::min(blocksize, testdata.size() - done));
+            const bool same = th.finalize() == ref;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ok = ok && same;
+            npending--;
+            cv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&npending] { return npending == 0; });
+
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error("Mismatch: tree hash from jobs on its pool");
+    }
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+
+    std::vector<uint8_t> testdata(7*chunk_size + 123);
+    random_fill(testdata);
+
+    std::cout << "\n";
+
+    for(size_t len : {size_t(0), size_t(1), chunk_size-1, chunk_size, chunk_size+1,
+                      2*chunk_size, 5*chunk_size+17, testdata.size()})
+    for(size_t nthreads : {0, 1, 3, 8})
+    {
+        test_tree(testdata, len, nthreads, std::max(len, size_t(1)));
+        test_tree(testdata, len, nthreads, 100003);
+        test_tree(testdata, len, nthreads, chunk_size + chunk_size/2);
+    }
+
+    test_in_pool(testdata);
+    std::cout << "\n";
+
+    // Through a Hasher, with the default pool. The vector
+    // is hashed as its data followed by its size
+    std::cout << "Testing tree hash via make_hash ... ";
+
+    std::vector<uint8_t> withsize(testdata);
+    const size_t testdata_size = testdata.size();
+    withsize.resize(testdata_size + sizeof(size_t));
+    std::memcpy(withsize.data() + testdata_size, &testdata_size, sizeof(size_t));
+
+    // (type tags would be added to the data with BPHASH_USE_TYPEID)
+    #ifndef BPHASH_USE_TYPEID
+    if(make_hash(HashType::Hash128_tree, testdata) != ref_tree_hash(withsize.data(), withsize.size()))
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error("Mismatch: tree hash via make_hash");
+    }
+    #endif
+
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing tree hash via hash_batch ... ";
+
+    std::vector<const void *> ptrs;
+    std::vector<size_t> lens;
+    for(size_t len : {size_t(0), size_t(10), chunk_size + 10})
+    {
+        ptrs.push_back(testdata.data() + 3);
+        lens.push_back(len);
+    }
+
+    std::vector<Digest128> digests(ptrs.size());
+    hash_batch(HashType::Hash128_tree, ptrs.data(), lens.data(), ptrs.size(), digests.data());
+
+    for(size_t i = 0; i < ptrs.size(); i++)
+    {
+        if(to_hash_value(digests[i]) != ref_tree_hash(testdata.data() + 3, lens[i]))
+        {
+            std::cout << "FAILED\n";
+            throw std::runtime_error("Mismatch: tree hash via hash_batch");
+        }
+    }
+
+    std::cout << "OK\n\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+/*! \file
+ * \brief Testing of the hashing of unordered containers
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests that equal unordered containers hash the same regardless
+ * of the order of their elements, and that hashing large containers on
+ * a thread pool gives the same result as hashing them serially */
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bphash/types/string.hpp"
+#include "bphash/types/unordered_map.hpp"
+#include "bphash/types/unordered_set.hpp"
+
+using namespace bphash;
+
+
+static void check(bool ok, const std::string & desc)
+{
+    if(!ok)
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error(desc);
+    }
+}
+
+
+static std::vector<std::string> make_keys(size_t n)
+{
+    std::vector<std::string> keys;
+    for(size_t i = 0; i < n; i++)
+        keys.push_back("key_" + std::to_string(i * 7919));
+    return keys;
+}
+
+
+static void test_order(HashType type)
+{
+    std::cout << "Testing insertion order (hash type " << static_cast<int>(type) << ") ... ";
+
+    auto keys = make_keys(1000);
+
+    std::unordered_map<std::string, int> m1;
+    std::unordered_set<std::string> s1;
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        m1[keys[i]] = static_cast<int>(i);
+        s1.insert(keys[i]);
+    }
+
+    // Different order and number of buckets
+    std::unordered_map<std::string, int> m2(7);
+    std::unordered_set<std::string> s2(100000);
+    for(size_t i = keys.size(); i > 0; i--)
+    {
+        m2[keys[i-1]] = static_cast<int>(i-1);
+        s2.insert(keys[i-1]);
+    }
+
+    check(!std::equal(m1.begin(), m1.end(), m2.begin()), "Test maps are in the same order");
+    check(make_hash(type, m1) == make_hash(type, m2), "Equal maps hash differently");
+    check(make_hash(type, s1) == make_hash(type, s2), "Equal sets hash differently");
+
+    // Changing, removing or adding an element changes the hash
+    m2[keys[10]] = -1;
+    check(make_hash(type, m1) != make_hash(type, m2), "Changed value gives the same hash");
+    m2.erase(keys[10]);
+    check(make_hash(type, m1) != make_hash(type, m2), "Removed element gives the same hash");
+    s2.insert("another");
+    check(make_hash(type, s1) != make_hash(type, s2), "Added element gives the same hash");
+
+    check(make_hash(type, std::unordered_set<int>()) != make_hash(type, std::unordered_set<int>{0}),
+          "Empty set hashes the same as a set with a zero");
+
+    std::cout << "OK\n";
+}
+
+
+static void test_basic_hasher(void)
+{
+    std::cout << "Testing with BasicHasher ... ";
+
+    std::unordered_set<int> s1, s2;
+    for(int i = 0; i < 500; i++)
+    {
+        s1.insert(i * 31);
+        s2.insert((499 - i) * 31);
+    }
+
+    BasicHasher<detail::MurmurHash3_128_x64> h1, h2;
+    h1(s1);
+    h2(s2);
+    check(h1.finalize() == h2.finalize(), "Equal sets hash differently");
+    check(h1.finalize() == make_hash(HashType::Hash128, s1), "Different from Hasher");
+
+    std::cout << "OK\n";
+}
+
+
+static void test_threads(void)
+{
+    std::cout << "Testing hashing on a thread pool ... ";
+
+    const auto keys = make_keys(3 * detail::unordered_parallel_min + 17);
+    std::unordered_map<std::string, size_t> m;
+    for(size_t i = 0; i < keys.size(); i++)
+        m[keys[i]] = i;
+
+    const detail::UnorderedSum serial = detail::sum_element_hashes(m.begin(), m.size());
+
+    detail::ThreadPool pool(4);
+    check(detail::sum_element_hashes(m, pool) == serial, "Different sum on a thread pool");
+
+    // Jobs that use the pool they are running on
+    detail::ThreadPool small_pool(2);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t npending = 2;
+    bool ok = true;
+
+    for(size_t j = 0; j < 2; j++)
+    {
+        small_pool.submit([&]
+        {
+            const bool same = detail::sum_element_hashes(m, small_pool) == serial;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ok = ok && same;
+            npending--;
+            cv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&npending] { return npending == 0; });
+    check(ok, "Different sum from a job on the pool");
+
+    // And through the default pool
+    std::unordered_map<std::string, size_t> m2(m.begin(), m.end());
+    m2.rehash(m.bucket_count() * 4);
+    check(make_hash(HashType::Hash128, m) == make_hash(HashType::Hash128, m2),
+          "Equal large maps hash differently");
+
+    std::cout << "OK\n";
+}
+
+
+// Element whose hash throws for some values
+struct Throwing
+{
+    int i;
+    int bad;
+
+    bool operator==(const Throwing & rhs) const { return i == rhs.i; }
+
+    template<typename HasherT>
+    void hash(HasherT & h) const
+    {
+        if(i % bad == 0)
+            throw std::runtime_error("Bad element");
+        h(i);
+    }
+};
+
+struct ThrowingStdHash
+{
+    size_t operator()(const Throwing & t) const { return std::hash<int>()(t.i); }
+};
+
+
+static void test_exceptions(void)
+{
+    std::cout << "Testing exceptions on a thread pool ... ";
+
+    detail::ThreadPool pool(4);
+
+    // Every element, one element, and no elements throw
+    for(int bad : { 1, 3 * static_cast<int>(detail::unordered_parallel_min) - 1, 1 << 30 })
+    {
+        std::unordered_set<Throwing, ThrowingStdHash> s;
+        for(int i = 1; i <= 3 * static_cast<int>(detail::unordered_parallel_min); i++)
+            s.insert(Throwing{i, bad});
+
+        bool threw = false;
+        try {
+            detail::sum_element_hashes(s, pool);
+        }
+        catch(const std::runtime_error &)
+        {
+            threw = true;
+        }
+
+        check(threw == (bad != (1 << 30)), "Wrong exception from hashing on a pool");
+    }
+
+    std::cout << "OK\n";
+}
+
+
+int main(void)
+{
+    try {
+        std::cout << "\n";
+        test_order(HashType::Hash128);
+        test_order(HashType::Hash64_xxh3);
+        test_order(HashType::CRC32C);
+        test_basic_hasher();
+        test_threads();
+        test_exceptions();
+        std::cout << "\n";
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}
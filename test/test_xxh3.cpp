@@ -0,0 +1,294 @@
+/*! \file
+ * \brief Testing of the XXH3 hash algorithms
+ */
+
+/* Copyright (c) 2016 Benjamin Pritchard <ben@bennyp.org>
+ * This file is part of the BPHash project, which is released
+ * under the BSD 3-clause license. See the LICENSE file for details
+ */
+
+/* This file tests the XXH3 algorithms against values obtained
+ * from the reference xxHash library (v0.8). The input is the
+ * same generated "sanity" buffer used by the xxHash test suite */
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+
+#include "bphash/Hasher.hpp"
+#include "bphash/HashBatch.hpp"
+#include "bphash/XXH3_64.hpp"
+#include "bphash/XXH3_128.hpp"
+
+// Size of the test set. Make it an odd number
+#define TEST_SIZE 1024*1024 + 7
+
+using namespace bphash;
+
+
+struct TestVector
+{
+    size_t len;
+    const char * xxh3_64;
+    const char * xxh3_128;
+};
+
+
+// Hashes of the first len bytes of the sanity buffer
+static const TestVector test_vectors[] = {
+    {       0, "2d06800538d394c2", "99aa06d3014798d86001c324468d497f" },
+    {       1, "c44bdff4074eecdb", "a6cd5e9392000f6ac44bdff4074eecdb" },
+    {       2, "7a9978044cb8a8bb", "76750c3c7bf956687a9978044cb8a8bb" },
+    {       3, "54247382a8d6b94d", "20efc49ff02422ea54247382a8d6b94d" },
+    {       4, "e5dc74bc51848a51", "970d585ac632bf8e2e7d8d6876a39fe9" },
+    {       5, "e4243f00720306bb", "62ed587687606b4e057c7ed2c01fa1d1" },
+    {       8, "24ccc9acaa9f65e4", "47a7f080d82bb45664c69cab4bb21dc5" },
+    {       9, "14d5001c15dd3f2b", "564ef6078950d457ed7ccbc501eb7501" },
+    {      15, "45556d4d6e1798bc", "c402609e57ee5772958955df1889e6bc" },
+    {      16, "981b17d36c7498c9", "c68c368ecf8a9c05562980258a998629" },
+    {      17, "796f5acd3a60f862", "955fa78643ed3669abbc12d11973d7db" },
+    {      32, "9feaddbdbf57eed3", "98fc6458710dc2e8278410a17595e3f9" },
+    {      33, "abfb2d081b400a10", "3103c192ceaa2dede593bc4e5914c9d1" },
+    {      64, "9cb48487720ec49d", "6d90e81a9b0fd622efdb6a44690721a9" },
+    {      65, "fd81aac4bebc3883", "6c074d65e54db85afe2f650fa500ec6e" },
+    {      96, "935a769a7f94776f", "d9d0b885f56c93f1e9324473ea9afebe" },
+    {      97, "ca4ca268fd3c3a6c", "09dff37faa6b284c7c87228ae9671ba7" },
+    {     128, "fcff24126754d861", "39992220e045260aebb15e34a7fb5ab1" },
+    {     129, "98f1b0a679a2ca29", "03815fc91f1b30b686c9e3bc8f0a3b5c" },
+    {     160, "9d03a319ed4cbd2b", "ba5d218964b622ad737126c8d7c09cee" },
+    {     239, "16ce2b9d3b28805d", "e59fc6554b5008bcf895e8b860b8a593" },
+    {     240, "81c3c2b67f568ccf", "aa4202daa2769dc85c9aae94c8ebe5a0" },
+    {     241, "c5a639ecd2030e5e", "99a80ecf0ecfc647c5a639ecd2030e5e" },
+    {     255, "e98f979f4ed8a197", "961375c87e09efbce98f979f4ed8a197" },
+    {     256, "55de574ad89d0ac5", "8b1c66091423d28855de574ad89d0ac5" },
+    {     257, "b17fd5a8ae75bb0b", "f15fee7f9f457599b17fd5a8ae75bb0b" },
+    {     320, "75620d350ff5c694", "2c6021659f44e8d375620d350ff5c694" },
+    {     511, "8089715b163e7fc0", "9f7619cb8d250f0d8089715b163e7fc0" },
+    {     512, "617e49599013cb6b", "18d2d110dcc9bca1617e49599013cb6b" },
+    {     513, "f7037d3b6722aeec", "f5c760ed98fd9e0af7037d3b6722aeec" },
+    {    1023, "87a8f7b2f2e22496", "e8083e4d83214c3c87a8f7b2f2e22496" },
+    {    1024, "dd85c9b5c1109c5c", "0d30d24071c64c57dd85c9b5c1109c5c" },
+    {    1025, "d870c0fa13211c6a", "fd3ee4fe7f2954c6d870c0fa13211c6a" },
+    {    1088, "cc1450ea6b52a8f4", "e0fa3b9e9fb69d83cc1450ea6b52a8f4" },
+    {    2047, "b36ece19fca2197f", "763a9143f0523d15b36ece19fca2197f" },
+    {    2048, "dd59e2c3a5f038e0", "f736557fd47073a5dd59e2c3a5f038e0" },
+    {    2049, "d3afa4329779b921", "4cd2bd192f2d70bdd3afa4329779b921" },
+    {    2240, "6e73a90539cf2948", "ccb134fbfa7ce49d6e73a90539cf2948" },
+    {    2367, "cb37aeb9e5d361ed", "e89c0f6ff369b427cb37aeb9e5d361ed" },
+    {    4096, "e91206429d1f48f9", "b9cfaea2ca5626a4e91206429d1f48f9" },
+    {    4097, "dac80d543e339451", "0c6a7a5f1d0bbb1adac80d543e339451" },
+    {   65539, "35329004945ea650", "08275b758f6701d035329004945ea650" },
+    { 1048583, "525a20edfb0de181", "c7cc1cb711f103c8525a20edfb0de181" }
+};
+
+
+// Generates the same buffer as the xxHash sanity tests
+static void sanity_fill(std::vector<uint8_t> & buffer)
+{
+    uint64_t byte_gen = 2654435761U;
+
+    for(auto & it : buffer)
+    {
+        it = static_cast<uint8_t>(byte_gen >> 56);
+        byte_gen *= 11400714785074694797ULL;
+    }
+}
+
+
+static void test_vector(detail::HashImpl & hasher, const std::vector<uint8_t> & testdata,
+                        size_t len, const std::string & reference,
+                        int hashsize, const char * kernel)
+{
+    std::cout << "Testing " << hashsize << "-bit XXH3, " << kernel << " kernel,"
+              << " length " << len << " ... ";
+
+    hasher.reset();
+    hasher.update(testdata.data(), len);
+    std::string calc = hash_to_string(hasher.finalize());
+
+    if(calc != reference)
+    {
+        std::cout << "FAILED\n";
+
+        std::stringstream ss;
+        ss << "Mismatch: " << hashsize << "-bit XXH3, " << kernel << " kernel,"
+           << " length " << len << ": " << calc << " vs. " << reference;
+
+        throw std::runtime_error(ss.str());
+    }
+    else
+        std::cout << "OK\n";
+}
+
+
+static void test_offset(detail::HashImpl & hasher,
+                        const std::vector<uint8_t> & testdata,
+                        size_t offset, size_t blocksize,
+                        const std::string & reference,
+                        int hashsize)
+{
+    std::cout << "Testing " << hashsize << "-bit XXH3,"
+              << " offset " << offset
+              << " blocksize " << blocksize << " ... ";
+
+    hasher.reset();
+
+    // do the first part
+    hasher.update(testdata.data(), offset);
+
+    // now do the rest by blocks
+    if(blocksize == 0)
+        blocksize = testdata.size() - offset;
+
+    size_t done = offset;
+    size_t todo = 0;
+
+    do {
+        todo = blocksize;
+        if( (done + todo) > testdata.size() )
+            todo = testdata.size() - done;
+
+        hasher.update(testdata.data() + done, todo);
+        done += todo;
+
+    } while(todo);
+
+    std::string calc = hash_to_string(hasher.finalize());
+
+    if(calc != reference)
+    {
+        std::cout << "FAILED\n";
+
+        std::stringstream ss;
+        ss << "Mismatch: " << hashsize << "-bit XXH3,"
+                           << " offset " << offset
+                           << " blocksize " << blocksize;
+
+        throw std::runtime_error(ss.str());
+    }
+    else
+        std::cout << "OK\n";
+}
+
+
+static void test_kernel(const detail::XXH3Kernel & kernel, const std::vector<uint8_t> & testdata)
+{
+    detail::XXH3_64 xxh64(kernel);
+    detail::XXH3_128 xxh128(kernel);
+
+    for(const auto & tv : test_vectors)
+    {
+        test_vector(xxh64, testdata, tv.len, tv.xxh3_64, 64, kernel.name);
+        test_vector(xxh128, testdata, tv.len, tv.xxh3_128, 128, kernel.name);
+    }
+
+    std::cout << "\n";
+}
+
+
+int main(void)
+{
+    std::vector<uint8_t> testdata(TEST_SIZE);
+    sanity_fill(testdata);
+
+    const size_t nvectors = sizeof(test_vectors) / sizeof(test_vectors[0]);
+    const TestVector & full = test_vectors[nvectors-1];
+
+    try {
+
+    if(full.len != testdata.size())
+        throw std::runtime_error("Last test vector must be for the full buffer");
+
+    std::cout << "\n";
+
+    // All kernels supported by this machine
+    test_kernel(detail::xxh3_kernel_scalar, testdata);
+
+#ifdef BPHASH_XXH3_HAVE_X86_KERNELS
+    test_kernel(detail::xxh3_kernel_sse2, testdata);
+
+#if defined(__GNUC__)
+    if(__builtin_cpu_supports("avx2"))
+        test_kernel(detail::xxh3_kernel_avx2, testdata);
+    else
+        std::cout << "Skipping AVX2 kernel (not supported by this CPU)\n\n";
+#endif
+#endif
+
+
+    // try with different offsets (to test progressive hashing)
+    detail::XXH3_64 xxh64;
+    detail::XXH3_128 xxh128;
+
+    for(size_t i = 0; i <= 300; i += 13)
+    for(size_t j = 0; j <= 1150; j += 23) // purposely odd numbers
+    {
+        test_offset(xxh64,  testdata, i, j, full.xxh3_64,  64);
+        test_offset(xxh128, testdata, i, j, full.xxh3_128, 128);
+    }
+
+    std::cout << "\n";
+
+
+    // Through the rest of the library. Raw bytes are passed
+    // to the hash algorithm when hashed via a pointer, followed by
+    // the number of elements.
+    std::cout << "Testing XXH3 via make_hash ... ";
+
+    std::vector<uint8_t> withsize(testdata.begin(), testdata.begin() + 1000);
+    const size_t n = 1000;
+    withsize.resize(n + sizeof(size_t));
+    std::memcpy(withsize.data() + n, &n, sizeof(size_t));
+
+    detail::XXH3_128 xxh_withsize;
+    xxh_withsize.update(withsize.data(), withsize.size());
+
+    #ifndef BPHASH_USE_TYPEID
+    if(make_hash(HashType::Hash128_xxh3, hash_pointer(testdata.data(), n)) != xxh_withsize.finalize())
+    {
+        std::cout << "FAILED\n";
+        throw std::runtime_error("Mismatch: XXH3 via make_hash");
+    }
+    #endif
+
+    std::cout << "OK\n";
+
+
+    std::cout << "Testing XXH3 via hash_batch ... ";
+
+    std::vector<const void *> ptrs;
+    std::vector<size_t> lens;
+    for(const auto & tv : test_vectors)
+    {
+        ptrs.push_back(testdata.data());
+        lens.push_back(tv.len);
+    }
+
+    std::vector<Digest64> digests64(nvectors);
+    std::vector<Digest128> digests128(nvectors);
+    hash_batch(HashType::Hash64_xxh3, ptrs.data(), lens.data(), nvectors, digests64.data());
+    hash_batch(HashType::Hash128_xxh3, ptrs.data(), lens.data(), nvectors, digests128.data());
+
+    for(size_t i = 0; i < nvectors; i++)
+    {
+        if(hash_to_string(digests64[i]) != test_vectors[i].xxh3_64 ||
+           hash_to_string(digests128[i]) != test_vectors[i].xxh3_128)
+        {
+            std::cout << "FAILED\n";
+            throw std::runtime_error("Mismatch: XXH3 via hash_batch");
+        }
+    }
+
+    std::cout << "OK\n\n";
+
+    }
+    catch(const std::exception & ex)
+    {
+        std::cout << "!!! Failed test: " << ex.what() << "\n\n";
+        return 1;
+    }
+
+    return 0;
+}